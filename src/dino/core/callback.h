@@ -4,9 +4,12 @@
 #pragma once
 
 #include <functional>
+#include <set>
+#include <string>
 #include <boost/signals2.hpp>
 
 #include "dino/core/command.h"
+#include "dino/core/changesummary.h"
 #include "dino/core/fwd.h"
 
 namespace dino {
@@ -19,8 +22,22 @@ enum class ListenerCallPoint {
   kNumCallPoint
 };
 
+// Narrows the commands delivered to a listener. Empty members match
+// everything.
+struct ListenerFilter {
+  // Bitwise or of kValueUpdateType, kBaseObjectUpdateType and
+  // kChildListUpdateType. kValueUpdateType covers kValuesUpdate as well.
+  unsigned int command_type_mask = 0;
+  // Keys of the value changes. Other commands aren't filtered by keys, and
+  // kValuesUpdate is delivered if any of its keys is in the set.
+  std::set<std::string> keys;
+  // Only the commands for this object and its descendants
+  DObjPath path_prefix;
+};
+
 using CommandStackListenerFunc = std::function<void ()>;
 using ObjectListenerFunc = std::function<void (const Command&)>;
+using SummaryListenerFunc = std::function<void (const ChangeSummary&)>;
 using PostCreateFunc = std::function<void (const DObjectSp&)>;
 
 }  // namespace core
@@ -0,0 +1,119 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#include "dino/core/changesummary.h"
+
+#include <algorithm>
+
+namespace dino {
+
+namespace core {
+
+ChangeSummary::ChangeSummary(const DObjPath& obj_path)
+    : obj_path_(obj_path) {
+}
+
+const DObjPath& ChangeSummary::ObjPath() const {
+  return obj_path_;
+}
+
+const std::vector<Command>& ChangeSummary::Commands() const {
+  return commands_;
+}
+
+size_t ChangeSummary::NumReceivedCommands() const {
+  return num_received_commands_;
+}
+
+bool ChangeSummary::Empty() const {
+  return commands_.empty();
+}
+
+bool ChangeSummary::HasValueChanges() const {
+  return !value_cmd_index_.empty();
+}
+
+bool ChangeSummary::HasChildListChanges() const {
+  return std::any_of(commands_.cbegin(), commands_.cend(),
+                     [](auto& cmd) { return cmd.IsChildListUpdate(); });
+}
+
+bool ChangeSummary::HasBaseObjectListChanges() const {
+  return std::any_of(commands_.cbegin(), commands_.cend(),
+                     [](auto& cmd) { return cmd.IsBaseObjectListUpdate(); });
+}
+
+void ChangeSummary::Add(const Command& cmd) {
+  ++ num_received_commands_;
+  switch (cmd.Type()) {
+    case CommandType::kValueAdd:
+      AddValueChange(cmd.ObjPath(), cmd.Key(),
+                     true, cmd.NewValue(), false, nil);
+      break;
+    case CommandType::kValueUpdate:
+      AddValueChange(cmd.ObjPath(), cmd.Key(),
+                     true, cmd.NewValue(), true, cmd.PrevValue());
+      break;
+    case CommandType::kValueDelete:
+      AddValueChange(cmd.ObjPath(), cmd.Key(),
+                     false, nil, true, cmd.PrevValue());
+      break;
+    case CommandType::kValuesUpdate:
+      for (auto& key : cmd.Keys()) {
+        auto new_itr = cmd.NewValues().find(key);
+        auto prev_itr = cmd.PrevValues().find(key);
+        auto has_new_value = new_itr != cmd.NewValues().cend();
+        auto has_prev_value = prev_itr != cmd.PrevValues().cend();
+        AddValueChange(cmd.ObjPath(), key,
+                       has_new_value, has_new_value ? new_itr->second : DValue(nil),
+                       has_prev_value, has_prev_value ? prev_itr->second : DValue(nil));
+      }
+      break;
+    default:
+      commands_.push_back(cmd);
+      break;
+  }
+}
+
+void ChangeSummary::AddValueChange(const DObjPath& obj_path,
+                                   const std::string& key,
+                                   bool has_new_value,
+                                   const DValue& new_value,
+                                   bool has_prev_value,
+                                   const DValue& prev_value) {
+  auto index_key = std::make_pair(obj_path.String(), key);
+  auto itr = value_cmd_index_.find(index_key);
+  if (itr == value_cmd_index_.end()) {
+    auto type = !has_prev_value ? CommandType::kValueAdd
+                : has_new_value ? CommandType::kValueUpdate
+                : CommandType::kValueDelete;
+    value_cmd_index_[index_key] = commands_.size();
+    commands_.emplace_back(type, obj_path, key, new_value, prev_value,
+                           DObjPath(), "", std::vector<DObjInfo>());
+    return;
+  }
+
+  auto index = itr->second;
+  auto& first_cmd = commands_[index];
+  auto had_value = first_cmd.Type() != CommandType::kValueAdd;
+  auto first_value = first_cmd.PrevValue();
+  if ((!had_value && !has_new_value)
+      || (had_value && has_new_value && first_value == new_value)) {
+    commands_.erase(commands_.begin() + index);
+    value_cmd_index_.erase(itr);
+    for (auto& kv : value_cmd_index_)
+      if (kv.second > index)
+        -- kv.second;
+    return;
+  }
+  auto type = !had_value ? CommandType::kValueAdd
+              : has_new_value ? CommandType::kValueUpdate
+              : CommandType::kValueDelete;
+  first_cmd = Command(type, obj_path, key,
+                      has_new_value ? new_value : DValue(nil), first_value,
+                      DObjPath(), "", std::vector<DObjInfo>());
+}
+
+}  // namespace core
+
+}  // namespace dino
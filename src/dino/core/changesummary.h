@@ -0,0 +1,56 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "dino/core/command.h"
+#include "dino/core/dobjpath.h"
+
+namespace dino {
+
+namespace core {
+
+// Changes notified to an object while notifications are deferred.
+// Value changes of the same key of the same object are merged into one
+// kValueAdd, kValueUpdate or kValueDelete command, and are dropped if
+// they cancel out. Other commands are kept in the order they were made.
+class ChangeSummary {
+ public:
+  ChangeSummary() = default;
+  explicit ChangeSummary(const DObjPath& obj_path);
+
+  // Path of the object the summary is delivered to. Commands may be for
+  // its descendants or bases as well.
+  const DObjPath& ObjPath() const;
+  const std::vector<Command>& Commands() const;
+  // Number of commands before merging
+  size_t NumReceivedCommands() const;
+  bool Empty() const;
+  bool HasValueChanges() const;
+  bool HasChildListChanges() const;
+  bool HasBaseObjectListChanges() const;
+
+  void Add(const Command& cmd);
+
+ private:
+  void AddValueChange(const DObjPath& obj_path,
+                      const std::string& key,
+                      bool has_new_value,
+                      const DValue& new_value,
+                      bool has_prev_value,
+                      const DValue& prev_value);
+
+  DObjPath obj_path_;
+  std::vector<Command> commands_;
+  std::map<std::pair<std::string, std::string>, size_t> value_cmd_index_;
+  size_t num_received_commands_ = 0;
+};
+
+}  // namespace core
+
+}  // namespace dino
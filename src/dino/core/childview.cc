@@ -0,0 +1,487 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#include "dino/core/childview.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "dino/core/dobject.h"
+
+namespace dino {
+
+namespace core {
+
+namespace {
+
+// Types are ordered by nil, bool, string, number and list
+class TypeOrder : public boost::static_visitor<int> {
+ public:
+  int operator()(DNilType) const { return 0; }
+  int operator()(bool) const { return 1; }
+  int operator()(const std::string&) const { return 2; }
+  int operator()(double) const { return 3; }
+  int operator()(int) const { return 3; }
+  int operator()(const DValueArray&) const { return 4; }
+};
+
+class ToNumber : public boost::static_visitor<double> {
+ public:
+  template <typename T>
+  double operator()(const T&) const { return 0.0; }
+  double operator()(double value) const { return value; }
+  double operator()(int value) const { return value; }
+};
+
+int CompareValues(const DValue& lhs, const DValue& rhs) {
+  auto lhs_order = boost::apply_visitor(TypeOrder(), lhs);
+  auto rhs_order = boost::apply_visitor(TypeOrder(), rhs);
+  if (lhs_order != rhs_order)
+    return lhs_order < rhs_order ? -1 : 1;
+  switch (lhs_order) {
+    case 1: {
+      auto lhs_value = boost::get<bool>(lhs);
+      auto rhs_value = boost::get<bool>(rhs);
+      return lhs_value == rhs_value ? 0 : (lhs_value ? 1 : -1);
+    }
+    case 2:
+      return boost::get<std::string>(lhs).compare(
+          boost::get<std::string>(rhs));
+    case 3: {
+      auto lhs_value = boost::apply_visitor(ToNumber(), lhs);
+      auto rhs_value = boost::apply_visitor(ToNumber(), rhs);
+      return lhs_value < rhs_value ? -1 : (rhs_value < lhs_value ? 1 : 0);
+    }
+    case 4: {
+      auto& lhs_values = boost::get<DValueArray>(lhs);
+      auto& rhs_values = boost::get<DValueArray>(rhs);
+      auto size = std::min(lhs_values.size(), rhs_values.size());
+      for (size_t idx = 0; idx < size; ++ idx) {
+        auto result = CompareValues(lhs_values[idx], rhs_values[idx]);
+        if (result != 0)
+          return result;
+      }
+      if (lhs_values.size() == rhs_values.size())
+        return 0;
+      return lhs_values.size() < rhs_values.size() ? -1 : 1;
+    }
+    default:
+      return 0;
+  }
+}
+
+}  // namespace
+
+const size_t ChildView::npos;
+
+class ChildView::Impl {
+ public:
+  struct Entry {
+    // Values of keys_
+    std::vector<DValue> values;
+    bool is_shown = false;
+  };
+  using EntryMap = std::unordered_map<std::string, Entry>;
+  using Row = const EntryMap::value_type*;
+
+  Impl(const DObjectSp& parent, const DObjectSp& listen_to)
+      : parent_(parent),
+        parent_path_(parent->Path()),
+        listen_target_(listen_to ? listen_to : parent) {}
+
+  void SetSortKeys(const std::vector<SortKey>& sort_keys);
+  void SetFilter(const std::vector<std::string>& keys,
+                 const FilterFunc& filter);
+  size_t RowOf(const std::string& name) const;
+  void Rebuild();
+  void Connect();
+
+  DObjectSp parent_;
+  DObjPath parent_path_;
+  DObjectSp listen_target_;
+  std::vector<SortKey> sort_keys_;
+  std::vector<size_t> sort_slots_;
+  std::vector<size_t> filter_slots_;
+  std::vector<std::string> filter_keys_;
+  FilterFunc filter_;
+  // Keys whose values are kept in the entries
+  std::vector<std::string> keys_;
+  std::unordered_map<std::string, size_t> key_slots_;
+  EntryMap entries_;
+  std::vector<Row> rows_;
+  boost::signals2::signal<void (const ChildViewChange&)> sig_;
+  boost::signals2::scoped_connection connection_;
+
+ private:
+  void UpdateKeys();
+  void LoadValues(const std::string& name, Entry& entry);
+  void LoadValues(const std::string& name, Entry& entry,
+                  const std::vector<size_t>& slots);
+  bool IsShown(const Entry& entry) const;
+  bool IsLess(Row lhs, Row rhs) const;
+  void SortRows();
+  void Notify(ChildViewChange::Type type, ListenerCallPoint call_point,
+              size_t row = 0, size_t dest_row = 0);
+  void ProcessCommand(const Command& cmd);
+  void AddChild(const std::string& name);
+  void RemoveChild(const std::string& name);
+  void UpdateChild(const std::string& name,
+                   const std::vector<std::string>& keys);
+};
+
+void ChildView::Impl::SetSortKeys(const std::vector<SortKey>& sort_keys) {
+  Notify(ChildViewChange::Type::kReset, ListenerCallPoint::kPre);
+  sort_keys_ = sort_keys;
+  UpdateKeys();
+  SortRows();
+  Notify(ChildViewChange::Type::kReset, ListenerCallPoint::kPost);
+}
+
+void ChildView::Impl::SetFilter(const std::vector<std::string>& keys,
+                                const FilterFunc& filter) {
+  Notify(ChildViewChange::Type::kReset, ListenerCallPoint::kPre);
+  filter_ = filter;
+  filter_keys_ = filter ? keys : std::vector<std::string>();
+  UpdateKeys();
+  SortRows();
+  Notify(ChildViewChange::Type::kReset, ListenerCallPoint::kPost);
+}
+
+size_t ChildView::Impl::RowOf(const std::string& name) const {
+  auto itr = entries_.find(name);
+  if (itr == entries_.end() || !itr->second.is_shown)
+    return npos;
+  Row row = &*itr;
+  auto row_itr = std::lower_bound(
+      rows_.cbegin(), rows_.cend(), row,
+      [this](auto lhs, auto rhs) { return IsLess(lhs, rhs); });
+  return static_cast<size_t>(std::distance(rows_.cbegin(), row_itr));
+}
+
+void ChildView::Impl::Rebuild() {
+  Notify(ChildViewChange::Type::kReset, ListenerCallPoint::kPre);
+  rows_.clear();
+  entries_.clear();
+  parent_->ForEachChild([this](auto& child_info) {
+      entries_[child_info.Name()];
+    });
+  if (!keys_.empty())
+    for (auto& name_entry : entries_)
+      LoadValues(name_entry.first, name_entry.second);
+  SortRows();
+  Notify(ChildViewChange::Type::kReset, ListenerCallPoint::kPost);
+}
+
+// The listener is connected again when the keys are changed, so that the
+// changes of the other keys don't reach the view
+void ChildView::Impl::Connect() {
+  ListenerFilter filter;
+  filter.path_prefix = parent_path_;
+  if (keys_.empty())
+    filter.command_type_mask =
+        static_cast<unsigned int>(CommandType::kBaseObjectUpdateType)
+        | static_cast<unsigned int>(CommandType::kChildListUpdateType);
+  else
+    filter.keys.insert(keys_.cbegin(), keys_.cend());
+  connection_ = listen_target_->AddListener([this](auto& cmd) {
+      ProcessCommand(cmd);
+    }, filter, ListenerCallPoint::kPost);
+}
+
+// keys_ is made of the sort keys and the filter keys. The values of the
+// keys still used are kept, and only the new ones are read.
+void ChildView::Impl::UpdateKeys() {
+  std::vector<std::string> keys;
+  std::unordered_map<std::string, size_t> key_slots;
+  auto slots_of = [&keys, &key_slots](auto& slot_keys) {
+    std::vector<size_t> slots;
+    for (auto& key : slot_keys) {
+      auto itr = key_slots.find(key);
+      if (itr == key_slots.end()) {
+        itr = key_slots.emplace(key, keys.size()).first;
+        keys.push_back(key);
+      }
+      slots.push_back(itr->second);
+    }
+    return slots;
+  };
+  std::vector<std::string> sort_keys;
+  for (auto& sort_key : sort_keys_)
+    sort_keys.push_back(sort_key.key);
+  sort_slots_ = slots_of(sort_keys);
+  filter_slots_ = slots_of(filter_keys_);
+  if (keys == keys_)
+    return;
+
+  // Slots in the current values, or npos for the new keys
+  std::vector<size_t> prev_slots;
+  std::vector<size_t> new_slots;
+  for (size_t slot = 0; slot < keys.size(); ++ slot) {
+    auto itr = key_slots_.find(keys[slot]);
+    if (itr == key_slots_.end()) {
+      prev_slots.push_back(npos);
+      new_slots.push_back(slot);
+    } else {
+      prev_slots.push_back(itr->second);
+    }
+  }
+  keys_.swap(keys);
+  key_slots_.swap(key_slots);
+  for (auto& name_entry : entries_) {
+    auto& entry = name_entry.second;
+    std::vector<DValue> values(keys_.size());
+    for (size_t slot = 0; slot < keys_.size(); ++ slot)
+      if (prev_slots[slot] != npos)
+        values[slot] = std::move(entry.values[prev_slots[slot]]);
+    entry.values.swap(values);
+    LoadValues(name_entry.first, entry, new_slots);
+  }
+  Connect();
+}
+
+void ChildView::Impl::LoadValues(const std::string& name, Entry& entry) {
+  std::vector<size_t> slots(keys_.size());
+  for (size_t slot = 0; slot < keys_.size(); ++ slot)
+    slots[slot] = slot;
+  entry.values.resize(keys_.size());
+  LoadValues(name, entry, slots);
+}
+
+void ChildView::Impl::LoadValues(const std::string& name, Entry& entry,
+                                 const std::vector<size_t>& slots) {
+  if (slots.empty())
+    return;
+  auto child = parent_->OpenChild(name);
+  for (auto slot : slots)
+    entry.values[slot] = child->Get(keys_[slot], nil);
+}
+
+bool ChildView::Impl::IsShown(const Entry& entry) const {
+  if (!filter_)
+    return true;
+  std::vector<DValue> values;
+  for (auto slot : filter_slots_)
+    values.push_back(entry.values[slot]);
+  return filter_(values);
+}
+
+bool ChildView::Impl::IsLess(Row lhs, Row rhs) const {
+  for (size_t idx = 0; idx < sort_slots_.size(); ++ idx) {
+    auto slot = sort_slots_[idx];
+    auto result = CompareValues(lhs->second.values[slot],
+                                rhs->second.values[slot]);
+    if (result != 0)
+      return sort_keys_[idx].ascending ? result < 0 : result > 0;
+  }
+  return lhs->first < rhs->first;
+}
+
+void ChildView::Impl::SortRows() {
+  rows_.clear();
+  for (auto& name_entry : entries_) {
+    name_entry.second.is_shown = IsShown(name_entry.second);
+    if (name_entry.second.is_shown)
+      rows_.push_back(&name_entry);
+  }
+  std::sort(rows_.begin(), rows_.end(),
+            [this](auto lhs, auto rhs) { return IsLess(lhs, rhs); });
+}
+
+void ChildView::Impl::Notify(ChildViewChange::Type type,
+                             ListenerCallPoint call_point,
+                             size_t row, size_t dest_row) {
+  ChildViewChange change;
+  change.type = type;
+  change.call_point = call_point;
+  change.row = row;
+  change.dest_row = dest_row;
+  sig_(change);
+}
+
+void ChildView::Impl::ProcessCommand(const Command& cmd) {
+  if (cmd.ObjPath() == parent_path_) {
+    switch (cmd.Type()) {
+      case CommandType::kAddChild:
+      case CommandType::kAddFlattenedChild:
+        AddChild(cmd.TargetObjectName());
+        break;
+      case CommandType::kDeleteChild:
+        RemoveChild(cmd.TargetObjectName());
+        break;
+      case CommandType::kAddBaseObject:
+      case CommandType::kRemoveBaseObject:
+        Rebuild();
+        break;
+      default:
+        break;
+    }
+    return;
+  }
+  if (cmd.ObjPath().ParentPath() != parent_path_)
+    return;
+  switch (cmd.Type()) {
+    case CommandType::kValueAdd:
+    case CommandType::kValueUpdate:
+    case CommandType::kValueDelete:
+      UpdateChild(cmd.ObjPath().LeafName(), {cmd.Key()});
+      break;
+    case CommandType::kValuesUpdate:
+      UpdateChild(cmd.ObjPath().LeafName(), cmd.Keys());
+      break;
+    case CommandType::kAddBaseObject:
+    case CommandType::kRemoveBaseObject:
+      UpdateChild(cmd.ObjPath().LeafName(), keys_);
+      break;
+    default:
+      break;
+  }
+}
+
+void ChildView::Impl::AddChild(const std::string& name) {
+  if (entries_.count(name)) {
+    UpdateChild(name, keys_);
+    return;
+  }
+  auto& name_entry = *entries_.emplace(name, Entry()).first;
+  auto& entry = name_entry.second;
+  if (!keys_.empty())
+    LoadValues(name, entry);
+  entry.is_shown = IsShown(entry);
+  if (!entry.is_shown)
+    return;
+  auto row = RowOf(name);
+  Notify(ChildViewChange::Type::kInsert, ListenerCallPoint::kPre, row);
+  rows_.insert(rows_.begin() + row, &name_entry);
+  Notify(ChildViewChange::Type::kInsert, ListenerCallPoint::kPost, row);
+}
+
+void ChildView::Impl::RemoveChild(const std::string& name) {
+  auto itr = entries_.find(name);
+  if (itr == entries_.end())
+    return;
+  auto row = RowOf(name);
+  if (row != npos) {
+    Notify(ChildViewChange::Type::kRemove, ListenerCallPoint::kPre, row);
+    rows_.erase(rows_.begin() + row);
+    entries_.erase(itr);
+    Notify(ChildViewChange::Type::kRemove, ListenerCallPoint::kPost, row);
+  } else {
+    entries_.erase(itr);
+  }
+}
+
+void ChildView::Impl::UpdateChild(const std::string& name,
+                                  const std::vector<std::string>& keys) {
+  auto itr = entries_.find(name);
+  if (itr == entries_.end())
+    return;
+  auto& entry = itr->second;
+  auto prev_row = RowOf(name);
+  auto child = parent_->OpenChild(name);
+  for (auto& key : keys) {
+    auto slot_itr = key_slots_.find(key);
+    if (slot_itr != key_slots_.end())
+      entry.values[slot_itr->second] = child->Get(key, nil);
+  }
+  entry.is_shown = IsShown(entry);
+  if (prev_row == npos) {
+    if (!entry.is_shown)
+      return;
+    auto row = RowOf(name);
+    Notify(ChildViewChange::Type::kInsert, ListenerCallPoint::kPre, row);
+    rows_.insert(rows_.begin() + row, &*itr);
+    Notify(ChildViewChange::Type::kInsert, ListenerCallPoint::kPost, row);
+    return;
+  }
+  if (!entry.is_shown) {
+    Notify(ChildViewChange::Type::kRemove, ListenerCallPoint::kPre, prev_row);
+    rows_.erase(rows_.begin() + prev_row);
+    Notify(ChildViewChange::Type::kRemove, ListenerCallPoint::kPost, prev_row);
+    return;
+  }
+
+  // Only the row of the child may be out of order, so the new row is
+  // searched before or after it
+  auto less = [this](auto lhs, auto rhs) { return IsLess(lhs, rhs); };
+  Row row = &*itr;
+  auto row_itr = rows_.begin() + prev_row;
+  auto new_row = prev_row;
+  if (prev_row > 0 && less(row, rows_[prev_row - 1]))
+    new_row = static_cast<size_t>(std::distance(
+        rows_.begin(), std::lower_bound(rows_.begin(), row_itr, row, less)));
+  else if (prev_row + 1 < rows_.size() && less(rows_[prev_row + 1], row))
+    new_row = static_cast<size_t>(std::distance(
+        rows_.begin(),
+        std::lower_bound(row_itr + 1, rows_.end(), row, less))) - 1;
+  if (new_row == prev_row) {
+    Notify(ChildViewChange::Type::kUpdate, ListenerCallPoint::kPost,
+           prev_row, prev_row);
+    return;
+  }
+  Notify(ChildViewChange::Type::kMove, ListenerCallPoint::kPre,
+         prev_row, new_row);
+  if (new_row < prev_row)
+    std::rotate(rows_.begin() + new_row, row_itr, row_itr + 1);
+  else
+    std::rotate(row_itr, row_itr + 1, rows_.begin() + new_row + 1);
+  Notify(ChildViewChange::Type::kMove, ListenerCallPoint::kPost,
+         prev_row, new_row);
+}
+
+ChildView::ChildView(const DObjectSp& parent, const DObjectSp& listen_to)
+    : impl_(std::make_unique<Impl>(parent, listen_to)) {
+  impl_->Rebuild();
+  impl_->Connect();
+}
+
+ChildView::~ChildView() = default;
+
+DObjectSp ChildView::Parent() const {
+  return impl_->parent_;
+}
+
+void ChildView::SetSortKeys(const std::vector<SortKey>& sort_keys) {
+  impl_->SetSortKeys(sort_keys);
+}
+
+std::vector<ChildView::SortKey> ChildView::SortKeys() const {
+  return impl_->sort_keys_;
+}
+
+void ChildView::SetFilter(const std::vector<std::string>& keys,
+                          const FilterFunc& filter) {
+  impl_->SetFilter(keys, filter);
+}
+
+void ChildView::ClearFilter() {
+  impl_->SetFilter({}, FilterFunc());
+}
+
+size_t ChildView::Size() const {
+  return impl_->rows_.size();
+}
+
+const std::string& ChildView::NameAt(size_t row) const {
+  return impl_->rows_.at(row)->first;
+}
+
+size_t ChildView::RowOf(const std::string& name) const {
+  return impl_->RowOf(name);
+}
+
+DObjectSp ChildView::ObjectAt(size_t row, OpenMode mode) const {
+  return impl_->parent_->OpenChild(NameAt(row), mode);
+}
+
+void ChildView::Refresh() {
+  impl_->Rebuild();
+}
+
+boost::signals2::connection ChildView::AddListener(
+    const ChildViewListenerFunc& listener) {
+  return impl_->sig_.connect(listener);
+}
+
+}  // namespace core
+
+}  // namespace dino
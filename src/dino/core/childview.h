@@ -0,0 +1,91 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/signals2.hpp>
+
+#include "dino/core/callback.h"
+#include "dino/core/dvalue.h"
+#include "dino/core/filetypes.h"
+#include "dino/core/fwd.h"
+
+namespace dino {
+
+namespace core {
+
+// Change of the rows of a ChildView. Notified before and after the rows
+// are changed, except kUpdate that is notified only after.
+struct ChildViewChange {
+  enum class Type {
+    kInsert,
+    kRemove,
+    // From row to dest_row, the row after the move
+    kMove,
+    kUpdate,
+    kReset
+  };
+  Type type;
+  ListenerCallPoint call_point;
+  size_t row = 0;
+  size_t dest_row = 0;
+};
+
+using ChildViewListenerFunc = std::function<void (const ChildViewChange&)>;
+
+// Sorted and filtered list of the children of an object. The values of
+// the sort and filter keys are read once per child and kept in the view,
+// and the rows are updated by the commands of the parent and its
+// children. The changes of the children are received only if the parent
+// or listen_to is the object with the command stack, the same as the
+// listeners of DObject.
+class ChildView {
+ public:
+  struct SortKey {
+    std::string key;
+    bool ascending = true;
+  };
+  // values are the ones of the filter keys in the same order, nil if not
+  // set in the child
+  using FilterFunc = std::function<bool (const std::vector<DValue>& values)>;
+
+  static const size_t npos = static_cast<size_t>(-1);
+
+  explicit ChildView(const DObjectSp& parent,
+                     const DObjectSp& listen_to = nullptr);
+  ~ChildView();
+  ChildView(const ChildView&) = delete;
+  ChildView& operator=(const ChildView&) = delete;
+
+  DObjectSp Parent() const;
+  // Rows having the same values are ordered by name. Values of different
+  // types are ordered by nil, bool, string, number and list.
+  void SetSortKeys(const std::vector<SortKey>& sort_keys);
+  std::vector<SortKey> SortKeys() const;
+  void SetFilter(const std::vector<std::string>& keys,
+                 const FilterFunc& filter);
+  void ClearFilter();
+
+  size_t Size() const;
+  const std::string& NameAt(size_t row) const;
+  // Returns npos if the child isn't shown
+  size_t RowOf(const std::string& name) const;
+  DObjectSp ObjectAt(size_t row, OpenMode mode = OpenMode::kReadOnly) const;
+  // Reads the values of all the children again
+  void Refresh();
+
+  boost::signals2::connection AddListener(
+      const ChildViewListenerFunc& listener);
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace core
+
+}  // namespace dino
@@ -35,7 +35,10 @@ enum class CommandType {
   kAddChild             = 0b00010001,
   kAddFlattenedChild    = 0b00010101,
   kDeleteChild          = 0b00010011,
-  kChildListUpdateType  = 0b00010000
+  kChildListUpdateType  = 0b00010000,
+
+  kValuesUpdate         = 0b00100110,
+  kMultiValueUpdateType = 0b00100000
 };
 
 inline std::string CommandTypeToString(CommandType type) {
@@ -53,6 +56,7 @@ inline std::string CommandTypeToString(CommandType type) {
     case CommandType::kAddChild:          result = "AddChild";          break;
     case CommandType::kAddFlattenedChild: result = "AddFlattenedChild"; break;
     case CommandType::kDeleteChild:       result = "DeleteChild";       break;
+    case CommandType::kValuesUpdate:      result = "ValuesUpdate";      break;
     default:
       result = fmt::format("UnknownCommandType({0})", static_cast<int>(type));
   }
@@ -76,6 +80,15 @@ class Command {
         target_object_path_(target_object_path),
         target_object_type_(target_object_type),
         prev_children_(prev_children) {}
+  // Changes of several keys at once. A key missing in prev_values was
+  // added, and a key missing in new_values was removed.
+  Command(CommandType type,
+          const DObjPath& path,
+          const std::vector<std::string>& keys,
+          const DValueDict& new_values,
+          const DValueDict& prev_values)
+      : type_(static_cast<int>(type)), obj_path_(path), keys_(keys),
+        new_values_(new_values), prev_values_(prev_values) {}
   const DObjPath& ObjPath() const {
     return obj_path_;
   }
@@ -89,6 +102,9 @@ class Command {
   bool IsValueUpdate() const {
     return type_ & static_cast<int>(CommandType::kValueUpdateType);
   }
+  bool IsMultiValueUpdate() const {
+    return type_ & static_cast<int>(CommandType::kMultiValueUpdateType);
+  }
   bool IsBaseObjectListUpdate() const {
     return type_ & static_cast<int>(CommandType::kBaseObjectUpdateType);
   }
@@ -107,6 +123,15 @@ class Command {
   const DValue& PrevValue() const {
     return prev_value_;
   }
+  const std::vector<std::string>& Keys() const {
+    return keys_;
+  }
+  const DValueDict& NewValues() const {
+    return new_values_;
+  }
+  const DValueDict& PrevValues() const {
+    return prev_values_;
+  }
   DObjPath TargetObjectPath() const {
     return target_object_path_;
   }
@@ -126,6 +151,9 @@ class Command {
   std::string key_;
   DValue new_value_;
   DValue prev_value_;
+  std::vector<std::string> keys_;
+  DValueDict new_values_;
+  DValueDict prev_values_;
   DObjPath target_object_path_;
   std::string target_object_type_;
   std::vector<DObjInfo> prev_children_;
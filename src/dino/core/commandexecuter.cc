@@ -19,16 +19,22 @@ void CommandExecuter::UpdateValue(CommandType type,
                                   const DValue& prev_value) {
   auto edit_type = static_cast<CommandType>(
       static_cast<int>(type) & static_cast<int>(CommandType::kEditTypeMask));
-  if (edit_type == CommandType::kAdd
-      || edit_type == CommandType::kUpdate) {
+  if (edit_type == CommandType::kAdd) {
+    data->ExecAddValue(key, new_value);
+  } else if (edit_type == CommandType::kUpdate) {
     data->ExecUpdateValue(key, new_value, prev_value);
   } else if (edit_type == CommandType::kDelete) {
     data->ExecRemoveValue(key, prev_value);
-  } else if (edit_type == CommandType::kAdd) {
-    data->ExecAddValue(key, new_value);
   }
 }
 
+void CommandExecuter::UpdateValues(detail::ObjectData* data,
+                                   const std::vector<std::string>& keys,
+                                   const DValueDict& new_values,
+                                   const DValueDict& prev_values) {
+  data->ExecUpdateValues(keys, new_values, prev_values);
+}
+
 void CommandExecuter::UpdateBaseObjectList(CommandType type,
                                            detail::ObjectData* data,
                                            const DObjectSp& base_obj) {
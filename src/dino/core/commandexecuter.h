@@ -32,6 +32,11 @@ class CommandExecuter {
       const std::string& key,
       const DValue& new_value,
       const DValue& prev_value);
+  virtual void UpdateValues(
+      detail::ObjectData* data,
+      const std::vector<std::string>& keys,
+      const DValueDict& new_values,
+      const DValueDict& prev_values);
   virtual void UpdateBaseObjectList(
       CommandType type,
       detail::ObjectData* data,
@@ -8,7 +8,9 @@
 #include "dino/core/commandstackexception.h"
 #include "dino/core/session.h"
 #include "dino/core/dobject.h"
+#include "dino/core/detail/binarycodec.h"
 #include "dino/core/detail/objectdata.h"
+#include "dino/core/detail/spillfile.h"
 
 namespace dino {
 
@@ -24,12 +26,184 @@ struct CommandStack::RemovedData {
   std::vector<RemovedDataSp> children;
   std::vector<DObjPath> base_objects;
   bool is_flattened;
+  // Set instead of the data above if the child was detached
+  detail::DetachedChildSp detached;
 };
 
+namespace {
+
+// Clean position that can't be reached any more
+const size_t kNoCleanPos = static_cast<size_t>(-1);
+// The spill file is rewritten when more than half of it isn't used and
+// it's larger than this
+const uint64_t kMinSpillCompactionSize = 1 << 20;
+
+// Sizes of the heap blocks owned by the objects. Paths are interned, and
+// don't own any.
+size_t HeapSize(const std::string& str) {
+  static const size_t kInlineCapacity = std::string().capacity();
+  return str.capacity() > kInlineCapacity ? str.capacity() + 1 : 0;
+}
+
+size_t HeapSize(const DValue& value);
+
+class HeapSizeVisitor : public boost::static_visitor<size_t> {
+ public:
+  template <typename T>
+  size_t operator()(const T&) const {
+    return 0;
+  }
+  size_t operator()(const std::string& str) const {
+    return HeapSize(str);
+  }
+  size_t operator()(const DValueArray& values) const {
+    auto size = values.capacity() * sizeof(DValue);
+    for (auto& v : values)
+      size += HeapSize(v);
+    return size;
+  }
+};
+
+size_t HeapSize(const DValue& value) {
+  return boost::apply_visitor(HeapSizeVisitor(), value);
+}
+
+size_t HeapSize(const DValueDict& values) {
+  // Each node holds the next pointer and the hash code
+  auto size = values.bucket_count() * sizeof(void*)
+              + values.size() * (sizeof(DValueDict::value_type)
+                                 + sizeof(void*) + sizeof(size_t));
+  for (auto& kv : values)
+    size += HeapSize(kv.first) + HeapSize(kv.second);
+  return size;
+}
+
+size_t HeapSize(const std::map<std::string, std::string>& values) {
+  // Each node holds the color and three pointers
+  auto size = values.size()
+              * (sizeof(std::map<std::string, std::string>::value_type)
+                 + sizeof(void*) * 4);
+  for (auto& kv : values)
+    size += HeapSize(kv.first) + HeapSize(kv.second);
+  return size;
+}
+
+// Values are encoded in the same way as the binary data files
+class HistoryWriter {
+ public:
+  void PutInt(uint64_t value) {
+    writer_.Append(value);
+  }
+  void PutString(const std::string& str) {
+    writer_.Append(static_cast<uint32_t>(str.size()));
+    writer_.Append(str.data(), str.size());
+  }
+  void PutPath(const DObjPath& path) {
+    PutString(path.String());
+  }
+  void PutValue(const DValue& value) {
+    detail::WriteBinaryValue(writer_, DCompactValue(value));
+  }
+  void PutDict(const DValueDict& values) {
+    PutInt(values.size());
+    for (auto& kv : values) {
+      PutString(kv.first);
+      PutValue(kv.second);
+    }
+  }
+  void PutDict(const std::map<std::string, std::string>& values) {
+    PutInt(values.size());
+    for (auto& kv : values) {
+      PutString(kv.first);
+      PutString(kv.second);
+    }
+  }
+  const std::vector<char>& Buffer() const {
+    return writer_.Buffer();
+  }
+ private:
+  detail::BinaryWriter writer_;
+};
+
+class HistoryReader {
+ public:
+  HistoryReader(const std::string& buf, const std::string& file_path)
+      : reader_(buf.data(), buf.data() + buf.size(), file_path) {}
+  uint64_t GetInt() {
+    return reader_.Read<uint64_t>();
+  }
+  std::string GetString() {
+    auto size = reader_.Read<uint32_t>();
+    return std::string(reader_.ReadBytes(size), size);
+  }
+  DObjPath GetPath() {
+    return DObjPath(GetString());
+  }
+  DValue GetValue() {
+    return detail::ReadBinaryValue(reader_).ToDValue();
+  }
+  DValueDict GetValueDict() {
+    DValueDict values;
+    for (auto count = GetInt(); count > 0; -- count) {
+      auto key = GetString();
+      values[key] = GetValue();
+    }
+    return values;
+  }
+  std::map<std::string, std::string> GetStringDict() {
+    std::map<std::string, std::string> values;
+    for (auto count = GetInt(); count > 0; -- count) {
+      auto key = GetString();
+      values[key] = GetString();
+    }
+    return values;
+  }
+ private:
+  detail::BinaryReader reader_;
+};
+
+template <typename RemovedDataT>
+void PutRemovedData(HistoryWriter& writer, const RemovedDataT& data) {
+  writer.PutString(data.name);
+  writer.PutString(data.type);
+  writer.PutDict(data.values);
+  writer.PutDict(data.attrs);
+  writer.PutDict(data.temp_attrs);
+  writer.PutInt(data.base_objects.size());
+  for (auto& path : data.base_objects)
+    writer.PutPath(path);
+  writer.PutInt(data.is_flattened ? 1 : 0);
+  writer.PutInt(data.children.size());
+  for (auto& child : data.children)
+    PutRemovedData(writer, *child);
+}
+
+template <typename RemovedDataT>
+std::shared_ptr<RemovedDataT> GetRemovedData(HistoryReader& reader) {
+  auto data = std::make_shared<RemovedDataT>();
+  data->name = reader.GetString();
+  data->type = reader.GetString();
+  data->values = reader.GetValueDict();
+  data->attrs = reader.GetStringDict();
+  data->temp_attrs = reader.GetStringDict();
+  data->base_objects.resize(reader.GetInt());
+  for (auto& path : data->base_objects)
+    path = reader.GetPath();
+  data->is_flattened = reader.GetInt() != 0;
+  data->children.resize(reader.GetInt());
+  for (auto& child : data->children)
+    child = GetRemovedData<RemovedDataT>(reader);
+  return data;
+}
+
+}  // namespace
+
 CommandStack::CommandStack(Session* session, detail::ObjectData* root_data)
     : CommandExecuter(session, root_data) {
 }
 
+CommandStack::~CommandStack() = default;
+
 void CommandStack::StartBatch(const std::string& description) {
   if (in_batch_)
     BOOST_THROW_EXCEPTION(
@@ -64,6 +238,10 @@ void CommandStack::CancelBatch() {
 void CommandStack::Clear() {
   stack_.clear();
   current_pos_ = clean_pos_ = 0;
+  byte_size_ = 0;
+  spill_block_bytes_ = 0;
+  if (spill_file_)
+    spill_file_->Clear();
   sig_();
 }
 
@@ -85,11 +263,14 @@ void CommandStack::Redo() {
     BOOST_THROW_EXCEPTION(
         CommandStackException(kErrNoRedoEntry)
         << ExpInfo1(RootObjPath().String()));
+  auto& entry = stack_[current_pos_];
+  LoadEntry(entry);
   in_command_ = true;
-  for (auto& cmd : stack_[current_pos_].second)
+  for (auto& cmd : entry.batch)
     ExecRedo(cmd);
   current_pos_ ++;
   in_command_ = false;
+  TrimHistory();
   sig_();
 }
 
@@ -102,11 +283,14 @@ void CommandStack::Undo() {
     BOOST_THROW_EXCEPTION(
         CommandStackException(kErrNoUndoEntry)
         << ExpInfo1(RootObjPath().String()));
+  auto& entry = stack_[current_pos_ - 1];
+  LoadEntry(entry);
   in_command_ = true;
-  for (auto& cmd : stack_[current_pos_-1].second | boost::adaptors::reversed)
+  for (auto& cmd : entry.batch | boost::adaptors::reversed)
     ExecUndo(cmd);
   current_pos_ --;
   in_command_ = false;
+  TrimHistory();
   sig_();
 }
 
@@ -128,13 +312,335 @@ void CommandStack::PushBatchCommand(const std::string& description,
                                     bool emit_signal) {
   if (batch_data.empty())
     return;
-  stack_.resize(current_pos_);
-  stack_.emplace_back(description, batch_data);
+  EraseEntriesFrom(current_pos_);
+  HistoryEntry entry;
+  entry.description = description;
+  entry.batch = batch_data;
+  entry.byte_size = sizeof(HistoryEntry) + HeapSize(entry.description)
+                    + (entry.batch.capacity() - entry.batch.size())
+                    * sizeof(CommandData);
+  for (auto& cmd_data : entry.batch)
+    entry.byte_size += EstimateSize(cmd_data);
+  byte_size_ += entry.byte_size;
+  stack_.push_back(std::move(entry));
   current_pos_ ++;
+  TrimHistory();
   if (emit_signal)
     sig_();
 }
 
+void CommandStack::SetMaxEntries(size_t max_entries) {
+  max_entries_ = max_entries;
+  TrimHistory();
+}
+
+size_t CommandStack::MaxEntries() const {
+  return max_entries_;
+}
+
+void CommandStack::SetMaxBytes(size_t max_bytes) {
+  max_bytes_ = max_bytes;
+  TrimHistory();
+}
+
+size_t CommandStack::MaxBytes() const {
+  return max_bytes_;
+}
+
+size_t CommandStack::EntryCount() const {
+  return stack_.size();
+}
+
+size_t CommandStack::ByteSize() const {
+  return byte_size_;
+}
+
+void CommandStack::EnableSpill(bool enable, const FsPath& dir_path) {
+  if (spill_file_ && (!enable || dir_path != spill_dir_path_)) {
+    for (auto& entry : stack_) {
+      LoadEntry(entry);
+      entry.has_spill_block = false;
+    }
+    spill_block_bytes_ = 0;
+    spill_file_.reset();
+  }
+  spill_enabled_ = enable;
+  spill_dir_path_ = dir_path;
+  TrimHistory();
+}
+
+bool CommandStack::IsSpillEnabled() const {
+  return spill_enabled_;
+}
+
+void CommandStack::EnableDetachOnDelete(bool enable) {
+  detach_on_delete_ = enable;
+}
+
+bool CommandStack::IsDetachOnDeleteEnabled() const {
+  return detach_on_delete_;
+}
+
+void CommandStack::TrimHistory() {
+  // The oldest undo entries go first, and then the newest redo entries.
+  // The latest undo entry and the next redo entry are kept.
+  while (max_entries_ > 0 && stack_.size() > max_entries_) {
+    if (current_pos_ > 1)
+      DropOldestEntry();
+    else if (stack_.size() > current_pos_ + 1)
+      DropNewestEntry();
+    else
+      break;
+  }
+  if (max_bytes_ > 0 && spill_enabled_) {
+    for (size_t pos = 0;
+         byte_size_ > max_bytes_ && pos + 1 < current_pos_; ++ pos)
+      SpillEntry(stack_[pos]);
+    for (auto pos = stack_.size();
+         byte_size_ > max_bytes_ && pos > current_pos_ + 1; -- pos)
+      SpillEntry(stack_[pos - 1]);
+  }
+  // The entries still in memory are dropped with the ones beyond them
+  if (max_bytes_ > 0) {
+    size_t undo_end = 0;
+    for (size_t pos = 0; pos + 1 < current_pos_; ++ pos) {
+      if (!stack_[pos].is_spilled)
+        undo_end = pos + 1;
+    }
+    for (; byte_size_ > max_bytes_ && undo_end > 0; -- undo_end)
+      DropOldestEntry();
+    auto redo_begin = stack_.size();
+    for (auto pos = stack_.size(); pos > current_pos_ + 1; -- pos) {
+      if (!stack_[pos - 1].is_spilled)
+        redo_begin = pos - 1;
+    }
+    while (byte_size_ > max_bytes_ && stack_.size() > redo_begin)
+      DropNewestEntry();
+  }
+  CompactSpillFile();
+}
+
+void CommandStack::DropOldestEntry() {
+  ForgetEntry(stack_.front());
+  stack_.pop_front();
+  current_pos_ --;
+  if (clean_pos_ == 0)
+    clean_pos_ = kNoCleanPos;
+  else if (clean_pos_ != kNoCleanPos)
+    clean_pos_ --;
+}
+
+void CommandStack::DropNewestEntry() {
+  ForgetEntry(stack_.back());
+  stack_.pop_back();
+  if (clean_pos_ != kNoCleanPos && clean_pos_ > stack_.size())
+    clean_pos_ = kNoCleanPos;
+}
+
+void CommandStack::EraseEntriesFrom(size_t pos) {
+  while (stack_.size() > pos)
+    DropNewestEntry();
+  CompactSpillFile();
+}
+
+void CommandStack::ForgetEntry(const HistoryEntry& entry) {
+  if (!entry.is_spilled)
+    byte_size_ -= entry.byte_size;
+  if (entry.has_spill_block)
+    spill_block_bytes_ -= entry.spill_size;
+}
+
+void CommandStack::SpillEntry(HistoryEntry& entry) {
+  if (entry.is_spilled)
+    return;
+  // An entry read back keeps its block, since the batch isn't changed
+  if (!entry.has_spill_block) {
+    for (auto& cmd_data : entry.batch) {
+      auto& removed_data = std::get<RemovedDataSp>(cmd_data);
+      if (std::get<PostCreateFunc>(cmd_data)
+          || (removed_data && removed_data->detached))
+        return;
+    }
+    if (!spill_file_)
+      spill_file_ = std::make_unique<detail::SpillFile>(spill_dir_path_);
+    auto buf = EncodeBatch(entry.batch);
+    entry.spill_offset = spill_file_->Write(buf.data(), buf.size());
+    entry.spill_size = buf.size();
+    entry.has_spill_block = true;
+    spill_block_bytes_ += entry.spill_size;
+  }
+  entry.is_spilled = true;
+  BatchCommandData().swap(entry.batch);
+  byte_size_ -= entry.byte_size;
+}
+
+void CommandStack::LoadEntry(HistoryEntry& entry) {
+  if (!entry.is_spilled)
+    return;
+  try {
+    entry.batch = DecodeBatch(
+        spill_file_->Read(entry.spill_offset, entry.spill_size),
+        spill_file_->Path().string());
+  } catch (const detail::BinaryException&) {
+    BOOST_THROW_EXCEPTION(
+        CommandStackException(kErrHistorySpillError)
+        << ExpInfo1(spill_file_->Path().string())
+        << ExpInfo2("broken history data"));
+  }
+  entry.is_spilled = false;
+  byte_size_ += entry.byte_size;
+}
+
+void CommandStack::CompactSpillFile() {
+  if (!spill_file_)
+    return;
+  if (spill_block_bytes_ == 0) {
+    if (spill_file_->Size() > 0)
+      spill_file_->Clear();
+    return;
+  }
+  auto file_size = spill_file_->Size();
+  if (file_size < kMinSpillCompactionSize
+      || file_size <= spill_block_bytes_ * 2)
+    return;
+  // The entries are updated after all the blocks are copied, so that the
+  // history is kept as it is if the copy fails
+  auto new_file = std::make_unique<detail::SpillFile>(spill_dir_path_);
+  std::vector<uint64_t> new_offsets;
+  for (auto& entry : stack_) {
+    if (!entry.has_spill_block)
+      continue;
+    auto buf = spill_file_->Read(entry.spill_offset, entry.spill_size);
+    new_offsets.push_back(new_file->Write(buf.data(), buf.size()));
+  }
+  auto new_offset = new_offsets.begin();
+  for (auto& entry : stack_) {
+    if (entry.has_spill_block)
+      entry.spill_offset = *new_offset ++;
+  }
+  spill_file_ = std::move(new_file);
+}
+
+size_t CommandStack::EstimateSize(const CommandData& cmd_data) {
+  auto& cmd = std::get<Command>(cmd_data);
+  auto size = sizeof(CommandData)
+              + HeapSize(cmd.Description()) + HeapSize(cmd.Key())
+              + HeapSize(cmd.NewValue()) + HeapSize(cmd.PrevValue())
+              + HeapSize(cmd.TargetObjectType())
+              + cmd.PrevChildren().capacity() * sizeof(DObjInfo)
+              + cmd.Keys().capacity() * sizeof(std::string)
+              + HeapSize(cmd.NewValues()) + HeapSize(cmd.PrevValues());
+  for (auto& child : cmd.PrevChildren())
+    size += HeapSize(child.Type());
+  for (auto& key : cmd.Keys())
+    size += HeapSize(key);
+  auto& removed_data = std::get<RemovedDataSp>(cmd_data);
+  if (removed_data)
+    size += EstimateSize(*removed_data);
+  return size;
+}
+
+size_t CommandStack::EstimateSize(const RemovedData& data) {
+  // The control block of make_shared is counted as two counters
+  auto size = sizeof(RemovedData) + sizeof(long) * 2
+              + HeapSize(data.name) + HeapSize(data.type)
+              + HeapSize(data.values)
+              + HeapSize(data.attrs) + HeapSize(data.temp_attrs)
+              + data.children.capacity() * sizeof(RemovedDataSp)
+              + data.base_objects.capacity() * sizeof(DObjPath);
+  for (auto& child : data.children)
+    size += EstimateSize(*child);
+  if (data.detached)
+    size += EstimateSize(*data.detached);
+  return size;
+}
+
+size_t CommandStack::EstimateSize(const detail::DetachedChild& detached) {
+  // The values, the attributes and the children lists of the objects are
+  // counted in the same way as the removed data
+  auto size = sizeof(detail::DetachedChild) + sizeof(long) * 2
+              + detached.DataList().capacity() * sizeof(detail::DataSp);
+  for (auto& data : detached.DataList()) {
+    size += sizeof(detail::ObjectData) + HeapSize(data->Attrs());
+    for (auto& key : data->Keys(true))
+      size += sizeof(DValueDict::value_type) + sizeof(void*) * 2
+              + HeapSize(key) + HeapSize(data->Get(key));
+    data->ForEachListedChild([&size](const DObjInfo& child_info) {
+        size += sizeof(DObjInfo) + HeapSize(child_info.Type());
+      });
+  }
+  return size;
+}
+
+std::vector<char> CommandStack::EncodeBatch(const BatchCommandData& batch) {
+  HistoryWriter writer;
+  writer.PutInt(batch.size());
+  for (auto& cmd_data : batch) {
+    auto& cmd = std::get<Command>(cmd_data);
+    writer.PutInt(static_cast<uint64_t>(cmd.Type()));
+    writer.PutPath(cmd.ObjPath());
+    writer.PutString(cmd.Key());
+    writer.PutValue(cmd.NewValue());
+    writer.PutValue(cmd.PrevValue());
+    writer.PutPath(cmd.TargetObjectPath());
+    writer.PutString(cmd.TargetObjectType());
+    writer.PutInt(cmd.PrevChildren().size());
+    for (auto& child : cmd.PrevChildren()) {
+      writer.PutPath(child.Path());
+      writer.PutString(child.Type());
+      writer.PutInt(child.IsActual() ? 1 : 0);
+    }
+    writer.PutInt(cmd.Keys().size());
+    for (auto& key : cmd.Keys())
+      writer.PutString(key);
+    writer.PutDict(cmd.NewValues());
+    writer.PutDict(cmd.PrevValues());
+    auto& removed_data = std::get<RemovedDataSp>(cmd_data);
+    writer.PutInt(removed_data ? 1 : 0);
+    if (removed_data)
+      PutRemovedData(writer, *removed_data);
+  }
+  return writer.Buffer();
+}
+
+CommandStack::BatchCommandData CommandStack::DecodeBatch(
+    const std::string& buf, const std::string& file_path) {
+  HistoryReader reader(buf, file_path);
+  BatchCommandData batch(reader.GetInt());
+  for (auto& cmd_data : batch) {
+    auto type = static_cast<CommandType>(reader.GetInt());
+    auto obj_path = reader.GetPath();
+    auto key = reader.GetString();
+    auto new_value = reader.GetValue();
+    auto prev_value = reader.GetValue();
+    auto target_path = reader.GetPath();
+    auto target_type = reader.GetString();
+    std::vector<DObjInfo> prev_children(reader.GetInt());
+    for (auto& child : prev_children) {
+      auto path = reader.GetPath();
+      auto child_type = reader.GetString();
+      child = DObjInfo(path, child_type, reader.GetInt() != 0);
+    }
+    std::vector<std::string> keys(reader.GetInt());
+    for (auto& key : keys)
+      key = reader.GetString();
+    auto new_values = reader.GetValueDict();
+    auto prev_values = reader.GetValueDict();
+    if (static_cast<int>(type)
+        & static_cast<int>(CommandType::kMultiValueUpdateType))
+      std::get<Command>(cmd_data) = Command(
+          type, obj_path, keys, new_values, prev_values);
+    else
+      std::get<Command>(cmd_data) = Command(
+          type, obj_path, key, new_value, prev_value,
+          target_path, target_type, prev_children);
+    if (reader.GetInt() != 0)
+      std::get<RemovedDataSp>(cmd_data) =
+          GetRemovedData<RemovedData>(reader);
+  }
+  return batch;
+}
+
 void CommandStack::UpdateValue(CommandType type,
                                detail::ObjectData* data,
                                const std::string& key,
@@ -154,6 +660,21 @@ void CommandStack::UpdateValue(CommandType type,
   in_command_ = false;
 }
 
+void CommandStack::UpdateValues(detail::ObjectData* data,
+                                const std::vector<std::string>& keys,
+                                const DValueDict& new_values,
+                                const DValueDict& prev_values) {
+  if (in_command_) {
+    CommandExecuter::UpdateValues(data, keys, new_values, prev_values);
+    return;
+  }
+  in_command_ = true;
+  Command cmd(CommandType::kValuesUpdate, data->Path(),
+              keys, new_values, prev_values);
+  PushCommand(cmd);
+  in_command_ = false;
+}
+
 void CommandStack::UpdateBaseObjectList(CommandType type,
                                         detail::ObjectData* data,
                                         const DObjectSp& base_obj) {
@@ -213,6 +734,9 @@ void CommandStack::ExecRedo(CommandData& cmd_data) {
     case CommandType::kValueDelete:
       obj->ExecRemoveValue(cmd.Key(), cmd.PrevValue());
       break;
+    case CommandType::kValuesUpdate:
+      obj->ExecUpdateValues(cmd.Keys(), cmd.NewValues(), cmd.PrevValues());
+      break;
     case CommandType::kAddBaseObject:
       obj->ExecAddBase(
           session_->OpenObject(cmd.TargetObjectPath(), OpenMode::kReadOnly));
@@ -233,14 +757,25 @@ void CommandStack::ExecRedo(CommandData& cmd_data) {
                            true, true,
                            std::get<PostCreateFunc>(cmd_data));
       break;
-    case CommandType::kDeleteChild:
-      if (!std::get<RemovedDataSp>(cmd_data)) {
-        auto& removed_data = std::get<RemovedDataSp>(cmd_data);
+    case CommandType::kDeleteChild: {
+      auto& removed_data = std::get<RemovedDataSp>(cmd_data);
+      auto try_detach =
+          removed_data ? removed_data->detached != nullptr : detach_on_delete_;
+      if (try_detach) {
+        auto detached = obj->ExecDetachChild(cmd.TargetObjectName());
+        if (detached) {
+          removed_data = std::make_shared<RemovedData>();
+          removed_data->detached = detached;
+          break;
+        }
+      }
+      if (!removed_data || removed_data->detached) {
         removed_data = std::make_shared<RemovedData>();
         StoreChildData(obj, cmd.TargetObjectName(), removed_data);
       }
       obj->ExecDeleteChild(cmd.TargetObjectName());
       break;
+    }
     default:
       BOOST_THROW_EXCEPTION(
           CommandStackException(kErrInvalidCommandTypeError)
@@ -262,6 +797,9 @@ void CommandStack::ExecUndo(CommandData& cmd_data) {
     case CommandType::kValueDelete:
       obj->ExecAddValue(cmd.Key(), cmd.PrevValue());
       break;
+    case CommandType::kValuesUpdate:
+      obj->ExecUpdateValues(cmd.Keys(), cmd.PrevValues(), cmd.NewValues());
+      break;
     case CommandType::kAddBaseObject:
       obj->ExecRemoveBase(
           session_->OpenObject(cmd.TargetObjectPath(), OpenMode::kReadOnly));
@@ -274,9 +812,14 @@ void CommandStack::ExecUndo(CommandData& cmd_data) {
     case CommandType::kAddFlattenedChild:
       obj->ExecDeleteChild(cmd.TargetObjectName());
       break;
-    case CommandType::kDeleteChild:
-      RestoreChildData(obj, std::get<RemovedDataSp>(cmd_data), true);
+    case CommandType::kDeleteChild: {
+      auto& removed_data = std::get<RemovedDataSp>(cmd_data);
+      if (removed_data->detached)
+        obj->ExecAttachChild(removed_data->detached);
+      else
+        RestoreChildData(obj, removed_data, true);
       break;
+    }
     default:
       BOOST_THROW_EXCEPTION(
           CommandStackException(kErrInvalidCommandTypeError)
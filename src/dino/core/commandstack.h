@@ -3,21 +3,31 @@
 
 #pragma once
 
+#include <cstdint>
 #include <deque>
+#include <memory>
 #include <vector>
 #include <string>
 #include <utility>
 
 #include "dino/core/commandexecuter.h"
 #include "dino/core/callback.h"
+#include "dino/core/fspath.h"
 
 namespace dino {
 
 namespace core {
 
+namespace detail {
+
+class DetachedChild;
+class SpillFile;
+
+}  // namespace detail
+
 class CommandStack : public CommandExecuter {
  public:
-  ~CommandStack() = default;
+  ~CommandStack();
   void StartBatch(const std::string& description);
   void EndBatch();
   void CancelBatch();
@@ -29,6 +39,31 @@ class CommandStack : public CommandExecuter {
   bool CanUndo() const;
   void Undo();
   void AddListener(const CommandStackListenerFunc& listener);
+  // Limits of the history. 0 means no limit. The oldest undo entries are
+  // dropped first, and then the newest redo entries. The latest undo
+  // entry and the next redo entry are always kept.
+  void SetMaxEntries(size_t max_entries);
+  size_t MaxEntries() const;
+  void SetMaxBytes(size_t max_bytes);
+  size_t MaxBytes() const;
+  size_t EntryCount() const;
+  // Estimated memory used by the entries held in memory
+  size_t ByteSize() const;
+  // With spilling, the entries exceeding MaxBytes are written to a
+  // temporary file in dir_path instead of being dropped, and are read
+  // back when they're undone or redone. An empty dir_path uses the temporary
+  // directory of the system. Entries holding a post create function of
+  // a new child can't be spilled, and are dropped if MaxBytes is still
+  // exceeded.
+  void EnableSpill(bool enable = true, const FsPath& dir_path = FsPath());
+  bool IsSpillEnabled() const;
+  // With detaching, a deleted child keeps its opened data and its
+  // directory, which is moved to a trash directory in the top level
+  // directory, and undo puts them back without copying the subtree.
+  // Flattened children are copied as before. The detached data is counted
+  // in ByteSize, and the entries holding it can't be spilled.
+  void EnableDetachOnDelete(bool enable = true);
+  bool IsDetachOnDeleteEnabled() const;
   
  private:
   CommandStack(Session* session, detail::ObjectData* root_data);
@@ -39,6 +74,11 @@ class CommandStack : public CommandExecuter {
       const std::string& key,
       const DValue& new_value,
       const DValue& prev_value) override;
+  virtual void UpdateValues(
+      detail::ObjectData* data,
+      const std::vector<std::string>& keys,
+      const DValueDict& new_values,
+      const DValueDict& prev_values) override;
   virtual void UpdateBaseObjectList(
       CommandType type,
       detail::ObjectData* data,
@@ -56,6 +96,18 @@ class CommandStack : public CommandExecuter {
   using CommandData = std::tuple<Command, RemovedDataSp, PostCreateFunc>;
   using BatchCommandData = std::vector<CommandData>;
 
+  struct HistoryEntry {
+    std::string description;
+    BatchCommandData batch;
+    size_t byte_size = 0;  // estimated, while in memory
+    // The batch is only in the spill file
+    bool is_spilled = false;
+    // The batch has been written to the spill file
+    bool has_spill_block = false;
+    uint64_t spill_offset = 0;
+    size_t spill_size = 0;
+  };
+
   void PushCommand(const Command& cmd,
                    const PostCreateFunc& post_func = PostCreateFunc());
   void ExecRedo(CommandData& cmd_data);
@@ -71,8 +123,22 @@ class CommandStack : public CommandExecuter {
   void PushBatchCommand(const std::string& description,
                         const BatchCommandData& batch_data,
                         bool emit_signal = true);
+  void TrimHistory();
+  void DropOldestEntry();
+  void DropNewestEntry();
+  void EraseEntriesFrom(size_t pos);
+  void ForgetEntry(const HistoryEntry& entry);
+  void SpillEntry(HistoryEntry& entry);
+  void LoadEntry(HistoryEntry& entry);
+  void CompactSpillFile();
+  static size_t EstimateSize(const CommandData& cmd_data);
+  static size_t EstimateSize(const RemovedData& data);
+  static size_t EstimateSize(const detail::DetachedChild& detached);
+  static std::vector<char> EncodeBatch(const BatchCommandData& batch);
+  static BatchCommandData DecodeBatch(const std::string& buf,
+                                      const std::string& file_path);
 
-  std::deque<std::pair<std::string, BatchCommandData>> stack_;
+  std::deque<HistoryEntry> stack_;
   boost::signals2::signal<void()> sig_;
   std::string batch_description_;
   BatchCommandData batch_;
@@ -80,6 +146,15 @@ class CommandStack : public CommandExecuter {
   size_t clean_pos_ = 0;
   bool in_batch_ = false;
   bool in_command_ = false;
+  size_t max_entries_ = 0;
+  size_t max_bytes_ = 0;
+  size_t byte_size_ = 0;
+  // Bytes of the blocks in the spill file used by the entries
+  uint64_t spill_block_bytes_ = 0;
+  bool spill_enabled_ = false;
+  bool detach_on_delete_ = false;
+  FsPath spill_dir_path_;
+  std::unique_ptr<detail::SpillFile> spill_file_;
   friend class DObject;
   friend class detail::ObjectData;
 };
@@ -0,0 +1,293 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#include "dino/core/dcompactvalue.h"
+
+#include <atomic>
+
+namespace dino {
+
+namespace core {
+
+struct DCompactValue::StringBlock {
+  StringBlock(const char* v, size_t size) : value(v, size) {}
+  mutable std::atomic<size_t> ref_count{1};
+  const std::string value;
+};
+
+struct DCompactValue::ArrayBlock {
+  ArrayBlock(std::vector<DCompactValue>&& v) : values(std::move(v)) {}
+  mutable std::atomic<size_t> ref_count{1};
+  const std::vector<DCompactValue> values;
+};
+
+namespace {
+
+class ToCompactValue : public boost::static_visitor<DCompactValue> {
+ public:
+  DCompactValue operator()(DNilType) const {
+    return DCompactValue();
+  }
+  DCompactValue operator()(bool v) const {
+    return DCompactValue(v);
+  }
+  DCompactValue operator()(const std::string& v) const {
+    return DCompactValue(v);
+  }
+  DCompactValue operator()(double v) const {
+    return DCompactValue(v);
+  }
+  DCompactValue operator()(int v) const {
+    return DCompactValue(v);
+  }
+  DCompactValue operator()(const DValueArray& values) const {
+    std::vector<DCompactValue> compact_values;
+    compact_values.reserve(values.size());
+    for (auto& v : values)
+      compact_values.emplace_back(boost::apply_visitor(*this, v));
+    return DCompactValue(std::move(compact_values));
+  }
+};
+
+class EqualToCompactValue : public boost::static_visitor<bool> {
+ public:
+  EqualToCompactValue(const DCompactValue& value) : value_(value) {}
+  bool operator()(DNilType) const {
+    return value_.IsNil();
+  }
+  bool operator()(bool v) const {
+    return value_.Type() == DCompactValue::ValueType::kBool
+        && value_.AsBool() == v;
+  }
+  bool operator()(const std::string& v) const {
+    return value_.Type() == DCompactValue::ValueType::kString
+        && value_.StringSize() == v.size()
+        && std::memcmp(value_.StringData(), v.data(), v.size()) == 0;
+  }
+  bool operator()(double v) const {
+    return value_.Type() == DCompactValue::ValueType::kDouble
+        && value_.AsDouble() == v;
+  }
+  bool operator()(int v) const {
+    return value_.Type() == DCompactValue::ValueType::kInt
+        && value_.AsInt() == v;
+  }
+  bool operator()(const DValueArray& values) const {
+    if (!value_.IsArray() || value_.ArraySize() != values.size())
+      return false;
+    for (size_t idx = 0; idx < values.size(); ++ idx)
+      if (!value_.ArrayAt(idx).Equals(values[idx]))
+        return false;
+    return true;
+  }
+ private:
+  const DCompactValue& value_;
+};
+
+}  // namespace
+
+static_assert(sizeof(DCompactValue) == 16, "Unexpected DCompactValue size");
+
+DCompactValue::DCompactValue() {
+}
+
+DCompactValue::DCompactValue(DNilType) {
+}
+
+DCompactValue::DCompactValue(bool value) : type_(ValueType::kBool) {
+  Store(value);
+}
+
+DCompactValue::DCompactValue(int value) : type_(ValueType::kInt) {
+  Store(value);
+}
+
+DCompactValue::DCompactValue(double value) : type_(ValueType::kDouble) {
+  Store(value);
+}
+
+DCompactValue::DCompactValue(const char* value) {
+  InitString(value, std::strlen(value));
+}
+
+DCompactValue::DCompactValue(const std::string& value) {
+  InitString(value.data(), value.size());
+}
+
+DCompactValue::DCompactValue(const char* value, size_t size) {
+  InitString(value, size);
+}
+
+DCompactValue::DCompactValue(std::vector<DCompactValue>&& values)
+    : type_(ValueType::kArray) {
+  Store(new ArrayBlock(std::move(values)));
+}
+
+DCompactValue::DCompactValue(const DValue& value)
+    : DCompactValue(boost::apply_visitor(ToCompactValue(), value)) {
+}
+
+DCompactValue::DCompactValue(const DCompactValue& other)
+    : type_(other.type_), inline_size_(other.inline_size_) {
+  std::memcpy(storage_, other.storage_, sizeof(storage_));
+  AddRef();
+}
+
+DCompactValue::DCompactValue(DCompactValue&& other) noexcept
+    : type_(other.type_), inline_size_(other.inline_size_) {
+  std::memcpy(storage_, other.storage_, sizeof(storage_));
+  other.type_ = ValueType::kNil;
+}
+
+DCompactValue::~DCompactValue() {
+  Release();
+}
+
+DCompactValue& DCompactValue::operator=(const DCompactValue& other) {
+  if (this == &other)
+    return *this;
+  other.AddRef();
+  Release();
+  std::memcpy(storage_, other.storage_, sizeof(storage_));
+  type_ = other.type_;
+  inline_size_ = other.inline_size_;
+  return *this;
+}
+
+DCompactValue& DCompactValue::operator=(DCompactValue&& other) noexcept {
+  if (this == &other)
+    return *this;
+  Release();
+  std::memcpy(storage_, other.storage_, sizeof(storage_));
+  type_ = other.type_;
+  inline_size_ = other.inline_size_;
+  other.type_ = ValueType::kNil;
+  return *this;
+}
+
+bool DCompactValue::AsBool() const {
+  return Load<bool>();
+}
+
+int DCompactValue::AsInt() const {
+  return Load<int>();
+}
+
+double DCompactValue::AsDouble() const {
+  return Load<double>();
+}
+
+const char* DCompactValue::StringData() const {
+  if (inline_size_ <= kInlineCapacity)
+    return storage_;
+  return Load<StringBlock*>()->value.data();
+}
+
+size_t DCompactValue::StringSize() const {
+  if (inline_size_ <= kInlineCapacity)
+    return inline_size_;
+  return Load<StringBlock*>()->value.size();
+}
+
+std::string DCompactValue::AsString() const {
+  return std::string(StringData(), StringSize());
+}
+
+size_t DCompactValue::ArraySize() const {
+  return Load<ArrayBlock*>()->values.size();
+}
+
+const DCompactValue& DCompactValue::ArrayAt(size_t index) const {
+  return Load<ArrayBlock*>()->values[index];
+}
+
+DValue DCompactValue::ToDValue() const {
+  switch (type_) {
+    case ValueType::kBool:
+      return AsBool();
+    case ValueType::kInt:
+      return AsInt();
+    case ValueType::kDouble:
+      return AsDouble();
+    case ValueType::kString:
+      return AsString();
+    case ValueType::kArray: {
+      auto& values = Load<ArrayBlock*>()->values;
+      DValueArray result;
+      result.reserve(values.size());
+      for (auto& v : values)
+        result.emplace_back(v.ToDValue());
+      return result;
+    }
+    case ValueType::kNil:
+    default:
+      return nil;
+  }
+}
+
+bool DCompactValue::Equals(const DValue& value) const {
+  return boost::apply_visitor(EqualToCompactValue(*this), value);
+}
+
+bool DCompactValue::operator==(const DCompactValue& rhs) const {
+  if (type_ != rhs.type_)
+    return false;
+  switch (type_) {
+    case ValueType::kBool:
+      return AsBool() == rhs.AsBool();
+    case ValueType::kInt:
+      return AsInt() == rhs.AsInt();
+    case ValueType::kDouble:
+      return AsDouble() == rhs.AsDouble();
+    case ValueType::kString:
+      return StringSize() == rhs.StringSize()
+          && std::memcmp(StringData(), rhs.StringData(), StringSize()) == 0;
+    case ValueType::kArray: {
+      auto lhs_block = Load<ArrayBlock*>();
+      auto rhs_block = rhs.Load<ArrayBlock*>();
+      return lhs_block == rhs_block || lhs_block->values == rhs_block->values;
+    }
+    case ValueType::kNil:
+    default:
+      return true;
+  }
+}
+
+bool DCompactValue::operator!=(const DCompactValue& rhs) const {
+  return !(*this == rhs);
+}
+
+void DCompactValue::InitString(const char* value, size_t size) {
+  type_ = ValueType::kString;
+  if (size <= kInlineCapacity) {
+    std::memcpy(storage_, value, size);
+    inline_size_ = static_cast<uint8_t>(size);
+  } else {
+    Store(new StringBlock(value, size));
+    inline_size_ = kInlineCapacity + 1;
+  }
+}
+
+void DCompactValue::AddRef() const {
+  if (type_ == ValueType::kArray)
+    ++ Load<ArrayBlock*>()->ref_count;
+  else if (type_ == ValueType::kString && inline_size_ > kInlineCapacity)
+    ++ Load<StringBlock*>()->ref_count;
+}
+
+void DCompactValue::Release() {
+  if (type_ == ValueType::kArray) {
+    auto block = Load<ArrayBlock*>();
+    if (-- block->ref_count == 0)
+      delete block;
+  } else if (type_ == ValueType::kString && inline_size_ > kInlineCapacity) {
+    auto block = Load<StringBlock*>();
+    if (-- block->ref_count == 0)
+      delete block;
+  }
+  type_ = ValueType::kNil;
+}
+
+}  // namespace core
+
+}  // namespace dino
@@ -0,0 +1,90 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "dino/core/dvalue.h"
+
+namespace dino {
+
+namespace core {
+
+// Storage representation of DValue. A value takes 16 bytes. Strings up to
+// 14 bytes are stored inline, and longer strings and arrays are immutable
+// shared blocks, so copying a value never copies them. Integers are 32 bits,
+// the same as the int of DValue.
+class DCompactValue {
+ public:
+  enum class ValueType : uint8_t {
+    kNil, kBool, kInt, kDouble, kString, kArray
+  };
+
+  DCompactValue();
+  DCompactValue(DNilType);
+  DCompactValue(bool value);
+  DCompactValue(int value);
+  DCompactValue(double value);
+  DCompactValue(const char* value);
+  DCompactValue(const std::string& value);
+  DCompactValue(const char* value, size_t size);
+  DCompactValue(std::vector<DCompactValue>&& values);
+  explicit DCompactValue(const DValue& value);
+  DCompactValue(const DCompactValue& other);
+  DCompactValue(DCompactValue&& other) noexcept;
+  ~DCompactValue();
+  DCompactValue& operator=(const DCompactValue& other);
+  DCompactValue& operator=(DCompactValue&& other) noexcept;
+
+  ValueType Type() const { return type_; }
+  bool IsNil() const { return type_ == ValueType::kNil; }
+  bool IsArray() const { return type_ == ValueType::kArray; }
+
+  bool AsBool() const;
+  int AsInt() const;
+  double AsDouble() const;
+  const char* StringData() const;
+  size_t StringSize() const;
+  std::string AsString() const;
+  size_t ArraySize() const;
+  const DCompactValue& ArrayAt(size_t index) const;
+
+  DValue ToDValue() const;
+  bool Equals(const DValue& value) const;
+  bool operator==(const DCompactValue& rhs) const;
+  bool operator!=(const DCompactValue& rhs) const;
+
+ private:
+  struct StringBlock;
+  struct ArrayBlock;
+  static const size_t kInlineCapacity = 14;
+
+  template<typename T>
+  T Load() const {
+    T value;
+    std::memcpy(&value, storage_, sizeof(T));
+    return value;
+  }
+  template<typename T>
+  void Store(T value) {
+    std::memcpy(storage_, &value, sizeof(T));
+  }
+  void InitString(const char* value, size_t size);
+  void AddRef() const;
+  void Release();
+
+  alignas(8) char storage_[kInlineCapacity];
+  ValueType type_ = ValueType::kNil;
+  uint8_t inline_size_ = 0;
+};
+
+using DCompactValueDict = std::unordered_map<std::string, DCompactValue>;
+
+}  // namespace core
+
+}  // namespace dino
@@ -0,0 +1,103 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#include "dino/core/detail/binarycodec.h"
+
+#include <limits>
+
+namespace dino {
+
+namespace core {
+
+namespace detail {
+
+namespace {
+
+enum class ValueTag : uint8_t {
+  kNil = 0,
+  kFalse,
+  kTrue,
+  kInt,
+  kDouble,
+  kString,
+  kArray
+};
+
+}  // namespace
+
+void WriteBinaryValue(BinaryWriter& writer, const DCompactValue& value) {
+  switch (value.Type()) {
+    case DCompactValue::ValueType::kBool:
+      writer.Append(static_cast<uint8_t>(
+          value.AsBool() ? ValueTag::kTrue : ValueTag::kFalse));
+      break;
+    case DCompactValue::ValueType::kInt:
+      writer.Append(static_cast<uint8_t>(ValueTag::kInt));
+      writer.Append(static_cast<int64_t>(value.AsInt()));
+      break;
+    case DCompactValue::ValueType::kDouble:
+      writer.Append(static_cast<uint8_t>(ValueTag::kDouble));
+      writer.Append(value.AsDouble());
+      break;
+    case DCompactValue::ValueType::kString:
+      writer.Append(static_cast<uint8_t>(ValueTag::kString));
+      writer.Append(static_cast<uint32_t>(value.StringSize()));
+      writer.Append(value.StringData(), value.StringSize());
+      break;
+    case DCompactValue::ValueType::kArray:
+      writer.Append(static_cast<uint8_t>(ValueTag::kArray));
+      writer.Append(static_cast<uint32_t>(value.ArraySize()));
+      for (size_t idx = 0; idx < value.ArraySize(); ++ idx)
+        WriteBinaryValue(writer, value.ArrayAt(idx));
+      break;
+    case DCompactValue::ValueType::kNil:
+    default:
+      writer.Append(static_cast<uint8_t>(ValueTag::kNil));
+      break;
+  }
+}
+
+DCompactValue ReadBinaryValue(BinaryReader& reader) {
+  auto tag = static_cast<ValueTag>(reader.Read<uint8_t>());
+  switch (tag) {
+    case ValueTag::kNil:
+      return DCompactValue();
+    case ValueTag::kFalse:
+      return DCompactValue(false);
+    case ValueTag::kTrue:
+      return DCompactValue(true);
+    case ValueTag::kInt: {
+      auto value = reader.Read<int64_t>();
+      if (value < std::numeric_limits<int>::min()
+          || value > std::numeric_limits<int>::max())
+        BOOST_THROW_EXCEPTION(
+            BinaryException(kErrBinaryInvalidFormat)
+            << ExpInfo1(reader.FilePath()));
+      return DCompactValue(static_cast<int>(value));
+    }
+    case ValueTag::kDouble:
+      return DCompactValue(reader.Read<double>());
+    case ValueTag::kString: {
+      auto size = reader.Read<uint32_t>();
+      return DCompactValue(reader.ReadBytes(size), size);
+    }
+    case ValueTag::kArray: {
+      auto size = reader.Read<uint32_t>();
+      std::vector<DCompactValue> values;
+      values.reserve(size);
+      for (uint32_t idx = 0; idx < size; ++ idx)
+        values.emplace_back(ReadBinaryValue(reader));
+      return DCompactValue(std::move(values));
+    }
+    default:
+      BOOST_THROW_EXCEPTION(
+          BinaryException(kErrBinaryInvalidFormat)
+          << ExpInfo1(reader.FilePath()));
+  }
+}
+
+}  // namespace detail
+
+}  // namespace core
+
+}  // namespace dino
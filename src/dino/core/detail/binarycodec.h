@@ -0,0 +1,96 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "dino/core/dcompactvalue.h"
+#include "dino/core/dexception.h"
+#include "dino/core/detail/binaryexception.h"
+
+namespace dino {
+
+namespace core {
+
+namespace detail {
+
+// Encoding of the binary data files, also used for the command history
+// written to a spill file. Numbers are stored in native byte order.
+class BinaryWriter {
+ public:
+  template<typename T>
+  void Append(T value) {
+    auto pos = buf_.size();
+    buf_.resize(pos + sizeof(T));
+    std::memcpy(&buf_[pos], &value, sizeof(T));
+  }
+  void Append(const char* data, size_t size) {
+    buf_.insert(buf_.end(), data, data + size);
+  }
+  template<typename T>
+  void Patch(size_t pos, T value) {
+    std::memcpy(&buf_[pos], &value, sizeof(T));
+  }
+  size_t Size() const { return buf_.size(); }
+  const std::vector<char>& Buffer() const { return buf_; }
+
+ private:
+  std::vector<char> buf_;
+};
+
+// Throws BinaryException with file_path if the data is shorter than read
+class BinaryReader {
+ public:
+  BinaryReader() : pos_(nullptr), end_(nullptr), file_path_(&EmptyPath()) {}
+  BinaryReader(const char* begin, const char* end,
+               const std::string& file_path)
+      : pos_(begin), end_(end), file_path_(&file_path) {}
+  template<typename T>
+  T Read() {
+    Check(sizeof(T));
+    T value;
+    std::memcpy(&value, pos_, sizeof(T));
+    pos_ += sizeof(T);
+    return value;
+  }
+  const char* ReadBytes(size_t size) {
+    Check(size);
+    auto data = pos_;
+    pos_ += size;
+    return data;
+  }
+  BinaryReader SubReader(size_t size) {
+    auto data = ReadBytes(size);
+    return BinaryReader(data, data + size, *file_path_);
+  }
+  bool AtEnd() const { return pos_ == end_; }
+  void Check(size_t size) const {
+    if (static_cast<size_t>(end_ - pos_) < size)
+      BOOST_THROW_EXCEPTION(
+          BinaryException(kErrBinaryInvalidFormat) << ExpInfo1(*file_path_));
+  }
+  const std::string& FilePath() const { return *file_path_; }
+
+ private:
+  static const std::string& EmptyPath() {
+    static const std::string empty_path;
+    return empty_path;
+  }
+
+  const char* pos_;
+  const char* end_;
+  const std::string* file_path_;
+};
+
+void WriteBinaryValue(BinaryWriter& writer, const DCompactValue& value);
+DCompactValue ReadBinaryValue(BinaryReader& reader);
+
+}  // namespace detail
+
+}  // namespace core
+
+}  // namespace dino
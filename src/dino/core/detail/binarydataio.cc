@@ -0,0 +1,374 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#include "dino/core/detail/binarydataio.h"
+
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/classification.hpp>
+
+#include "dino/core/dexception.h"
+#include "dino/core/dobjpath.h"
+#include "dino/core/detail/binarycodec.h"
+#include "dino/core/detail/binaryexception.h"
+
+namespace dino {
+
+namespace core {
+
+namespace detail {
+
+namespace ipc = boost::interprocess;
+
+namespace {
+
+const std::string kBinaryFileSuffix = "dbin";
+
+const char kMagic[8] = {'D', 'I', 'N', 'O', 'B', 'I', 'N', '\0'};
+const uint32_t kFormatVersion = 1;
+const uint32_t kByteOrderMark = 0x01020304;
+const size_t kHeaderSize =
+    sizeof(kMagic) + sizeof(uint32_t) * 2 + sizeof(uint64_t);
+const size_t kStringTableOffsetPos = sizeof(kMagic) + sizeof(uint32_t) * 2;
+const uint32_t kNoName = 0xffffffff;
+
+enum class SectionTag : uint8_t {
+  kData = 1,
+  kAttribute,
+  kChildren,
+  kChild,
+  kNamed
+};
+
+struct Section {
+  SectionTag tag;
+  uint32_t name_idx;
+  BinaryReader payload;
+};
+
+Section NextSection(BinaryReader& reader) {
+  Section section;
+  section.tag = static_cast<SectionTag>(reader.Read<uint8_t>());
+  section.name_idx = reader.Read<uint32_t>();
+  section.payload = reader.SubReader(reader.Read<uint64_t>());
+  return section;
+}
+
+// Read only mapping of a binary data file. The header is validated and
+// the string table is indexed when it's opened.
+class MappedFile {
+ public:
+  MappedFile(const std::string& file_path) : file_path_(file_path) {
+    try {
+      mapping_ = ipc::file_mapping(file_path.c_str(), ipc::read_only);
+      region_ = ipc::mapped_region(mapping_, ipc::read_only);
+    } catch (const ipc::interprocess_exception&) {
+      BOOST_THROW_EXCEPTION(
+          BinaryException(kErrBinaryFileOpen)
+          << ExpInfo1(file_path) << ExpInfo2("reading"));
+    }
+    auto begin = static_cast<const char*>(region_.get_address());
+    auto end = begin + region_.get_size();
+    BinaryReader header(begin, end, file_path_);
+    if (std::memcmp(header.ReadBytes(sizeof(kMagic)), kMagic, sizeof(kMagic)))
+      BOOST_THROW_EXCEPTION(
+          BinaryException(kErrBinaryInvalidFormat) << ExpInfo1(file_path_));
+    auto version = header.Read<uint32_t>();
+    if (version > kFormatVersion)
+      BOOST_THROW_EXCEPTION(
+          BinaryException(kErrBinaryUnsupportedVersion)
+          << ExpInfo1(file_path_) << ExpInfo2(version));
+    if (header.Read<uint32_t>() != kByteOrderMark)
+      BOOST_THROW_EXCEPTION(
+          BinaryException(kErrBinaryInvalidFormat) << ExpInfo1(file_path_));
+    auto string_table_offset = header.Read<uint64_t>();
+    if (string_table_offset < kHeaderSize
+        || string_table_offset > region_.get_size())
+      BOOST_THROW_EXCEPTION(
+          BinaryException(kErrBinaryInvalidFormat) << ExpInfo1(file_path_));
+    body_ = BinaryReader(begin + kHeaderSize, begin + string_table_offset,
+                   file_path_);
+    BinaryReader table_reader(begin + string_table_offset, end, file_path_);
+    auto count = table_reader.Read<uint32_t>();
+    strings_.reserve(count);
+    for (uint32_t idx = 0; idx < count; ++ idx) {
+      auto size = table_reader.Read<uint32_t>();
+      strings_.emplace_back(table_reader.ReadBytes(size), size);
+    }
+  }
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const BinaryReader& Body() const { return body_; }
+  std::string StringAt(uint32_t idx) const {
+    if (idx >= strings_.size())
+      BOOST_THROW_EXCEPTION(
+          BinaryException(kErrBinaryInvalidFormat) << ExpInfo1(file_path_));
+    return std::string(strings_[idx].first, strings_[idx].second);
+  }
+
+ private:
+  std::string file_path_;
+  ipc::file_mapping mapping_;
+  ipc::mapped_region region_;
+  BinaryReader body_;
+  std::vector<std::pair<const char*, uint32_t>> strings_;
+};
+
+void ReadValues(BinaryReader reader, const MappedFile& file,
+                DCompactValueDict* values) {
+  while (!reader.AtEnd()) {
+    auto key = file.StringAt(reader.Read<uint32_t>());
+    (*values)[key] = ReadBinaryValue(reader);
+  }
+}
+
+void ReadAttrs(BinaryReader reader, const MappedFile& file, DValueDict* attrs) {
+  while (!reader.AtEnd()) {
+    auto key = file.StringAt(reader.Read<uint32_t>());
+    (*attrs)[key] = ReadBinaryValue(reader).ToDValue();
+  }
+}
+
+void ReadObject(BinaryReader reader, const MappedFile& file,
+                const ReadDataArgPtr& arg) {
+  while (!reader.AtEnd()) {
+    auto section = NextSection(reader);
+    switch (section.tag) {
+      case SectionTag::kData:
+        ReadValues(section.payload, file, arg->values);
+        break;
+      case SectionTag::kAttribute:
+        ReadAttrs(section.payload, file, arg->attrs);
+        break;
+      case SectionTag::kChildren:
+        ReadObject(section.payload, file, arg);
+        break;
+      case SectionTag::kChild: {
+        auto child_arg = arg->create_child(
+            DObjInfo::FromString(file.StringAt(section.name_idx)));
+        ReadObject(section.payload, file, child_arg);
+        break;
+      }
+      case SectionTag::kNamed:
+      default:
+        break;
+    }
+  }
+}
+
+class BinaryLazySource : public LazyDataSource {
+ public:
+  BinaryLazySource(const std::shared_ptr<MappedFile>& file, BinaryReader reader)
+      : file_(file) {
+    while (!reader.AtEnd()) {
+      auto section = NextSection(reader);
+      if (section.tag == SectionTag::kData) {
+        values_ = section.payload;
+      } else if (section.tag == SectionTag::kAttribute) {
+        attrs_ = section.payload;
+      } else if (section.tag == SectionTag::kChildren) {
+        while (!section.payload.AtEnd()) {
+          auto child = NextSection(section.payload);
+          if (child.tag != SectionTag::kChild)
+            continue;
+          child_info_list_.emplace_back(
+              DObjInfo::FromString(file_->StringAt(child.name_idx)));
+          children_.emplace_back(child.payload);
+        }
+      }
+    }
+  }
+  void ReadValues(DCompactValueDict* values) const override {
+    detail::ReadValues(values_, *file_, values);
+  }
+  void ReadAttrs(DValueDict* attrs) const override {
+    detail::ReadAttrs(attrs_, *file_, attrs);
+  }
+  std::vector<DObjInfo> ChildInfoList() const override {
+    return child_info_list_;
+  }
+  LazyDataSourcePtr Child(size_t index) const override {
+    return std::make_shared<BinaryLazySource>(file_, children_.at(index));
+  }
+
+ private:
+  std::shared_ptr<MappedFile> file_;
+  BinaryReader values_;
+  BinaryReader attrs_;
+  std::vector<DObjInfo> child_info_list_;
+  std::vector<BinaryReader> children_;
+};
+
+}  // namespace
+
+namespace fs = boost::filesystem;
+
+class BinaryDataIO::Impl {
+ public:
+  Impl(const std::string& file_path) : file_path(file_path) {}
+  ~Impl() = default;
+  void Init() {
+    working_path = file_path + ".writing";
+    f = std::fopen(working_path.c_str(), "wb");
+    std::FILE* test_f = std::fopen(file_path.c_str(), "ab");
+    if (!f || !test_f) {
+      if (test_f)
+        std::fclose(test_f);
+      if (f)
+        std::fclose(f);
+      BOOST_THROW_EXCEPTION(
+          BinaryException(kErrBinaryFileOpen)
+          << ExpInfo1(file_path) << ExpInfo2("writing"));
+    }
+    std::fclose(test_f);
+    writer.Append(kMagic, sizeof(kMagic));
+    writer.Append(kFormatVersion);
+    writer.Append(kByteOrderMark);
+    writer.Append(static_cast<uint64_t>(0));
+  }
+  uint32_t StringIndex(const std::string& str) {
+    auto itr = string_index.find(str);
+    if (itr != string_index.end())
+      return itr->second;
+    auto idx = static_cast<uint32_t>(strings.size());
+    strings.push_back(str);
+    string_index.emplace(str, idx);
+    return idx;
+  }
+  void OpenSection(SectionTag tag, uint32_t name_idx) {
+    writer.Append(static_cast<uint8_t>(tag));
+    writer.Append(name_idx);
+    writer.Append(static_cast<uint64_t>(0));
+    section_stack.push_back(writer.Size());
+  }
+  void CloseSection() {
+    auto payload_pos = section_stack.back();
+    section_stack.pop_back();
+    writer.Patch(payload_pos - sizeof(uint64_t),
+                 static_cast<uint64_t>(writer.Size() - payload_pos));
+  }
+  void WriteStringTable() {
+    writer.Patch(kStringTableOffsetPos, static_cast<uint64_t>(writer.Size()));
+    writer.Append(static_cast<uint32_t>(strings.size()));
+    for (auto& str : strings) {
+      writer.Append(static_cast<uint32_t>(str.size()));
+      writer.Append(str.data(), str.size());
+    }
+  }
+
+  std::string file_path;
+  std::string working_path;
+  std::FILE* f = nullptr;
+  BinaryWriter writer;
+  std::vector<size_t> section_stack;
+  std::vector<std::string> strings;
+  std::unordered_map<std::string, uint32_t> string_index;
+};
+
+BinaryDataIO::BinaryDataIO() = default;
+
+BinaryDataIO::~BinaryDataIO() = default;
+
+void BinaryDataIO::OpenForWrite(const FsPath& file_path) {
+  impl_ = std::make_unique<BinaryDataIO::Impl>(file_path.string());
+  impl_->Init();
+}
+
+void BinaryDataIO::ToDataSection() {
+  impl_->OpenSection(SectionTag::kData, kNoName);
+}
+
+void BinaryDataIO::ToAttributeSection() {
+  impl_->OpenSection(SectionTag::kAttribute, kNoName);
+}
+
+void BinaryDataIO::ToChildrenSection() {
+  impl_->OpenSection(SectionTag::kChildren, kNoName);
+}
+
+void BinaryDataIO::ToSection(const std::string& section_name) {
+  if (!DObjPath::IsValidName(section_name))
+    BOOST_THROW_EXCEPTION(
+        BinaryException(kErrBinaryInvalidSectionName)
+        << ExpInfo1(section_name));
+  impl_->OpenSection(SectionTag::kNamed, impl_->StringIndex(section_name));
+}
+
+void BinaryDataIO::ToSection(const DObjInfo& obj_info) {
+  impl_->OpenSection(SectionTag::kChild,
+                     impl_->StringIndex(obj_info.ToString(true)));
+}
+
+void BinaryDataIO::ToSectionUp() {
+  if (impl_->section_stack.empty())
+    BOOST_THROW_EXCEPTION(
+        BinaryException(kErrBinaryFailedToChangeSection) << ExpInfo1(".."));
+  impl_->CloseSection();
+}
+
+void BinaryDataIO::WriteDict(const DValueDict& values) {
+  for (auto& kv : values) {
+    impl_->writer.Append(impl_->StringIndex(kv.first));
+    WriteBinaryValue(impl_->writer, DCompactValue(kv.second));
+  }
+}
+
+void BinaryDataIO::WriteDict(const DCompactValueDict& values) {
+  for (auto& kv : values) {
+    impl_->writer.Append(impl_->StringIndex(kv.first));
+    WriteBinaryValue(impl_->writer, kv.second);
+  }
+}
+
+void BinaryDataIO::CloseForWrite() {
+  while (!impl_->section_stack.empty())
+    impl_->CloseSection();
+  impl_->WriteStringTable();
+  auto& buf = impl_->writer.Buffer();
+  auto written = std::fwrite(buf.data(), 1, buf.size(), impl_->f);
+  std::fclose(impl_->f);
+  if (written != buf.size())
+    BOOST_THROW_EXCEPTION(
+        BinaryException(kErrBinaryFileOpen)
+        << ExpInfo1(impl_->file_path) << ExpInfo2("writing"));
+  fs::rename(impl_->working_path, impl_->file_path);
+}
+
+void BinaryDataIO::Load(const FsPath& file_path,
+                        const ReadDataArgPtr& arg) {
+  MappedFile file(file_path.string());
+  ReadObject(file.Body(), file, arg);
+}
+
+LazyDataSourcePtr BinaryDataIO::OpenLazy(const FsPath& file_path) {
+  auto file = std::make_shared<MappedFile>(file_path.string());
+  return std::make_shared<BinaryLazySource>(file, file->Body());
+}
+
+std::string BinaryDataIO::FileName(const std::string& type) {
+  return type + "." + kBinaryFileSuffix;
+}
+
+DObjFileInfo BinaryDataIO::GetDataFileInfo(const FsPath& path) {
+  if (fs::is_directory(path))
+    return DObjFileInfo();
+  std::string file_name = path.filename().string();
+  std::vector<std::string> elems;
+  boost::split(elems, file_name, boost::is_any_of("."));
+  if (elems.back() != kBinaryFileSuffix)
+    return DObjFileInfo();
+  return DObjFileInfo(elems[0], path, FileFormat::kBinary);
+}
+
+}  // namespace detail
+
+}  // namespace core
+
+}  // namespace dino
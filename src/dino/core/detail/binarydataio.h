@@ -0,0 +1,51 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <memory>
+
+#include "dino/core/detail/dataio.h"
+#include "dino/core/dvalue.h"
+#include "dino/core/dobjinfo.h"
+#include "dino/core/dobjfileinfo.h"
+
+namespace dino {
+
+namespace core {
+
+namespace detail {
+
+// Binary data file. The file starts with a versioned header, followed by
+// length-prefixed sections and a string table that holds keys and section
+// names. Numbers are stored in native byte order.
+class BinaryDataIO : public DataIO {
+ public:
+  BinaryDataIO();
+  ~BinaryDataIO();
+  virtual void OpenForWrite(const FsPath& file_path) override;
+  virtual void ToDataSection() override;
+  virtual void ToAttributeSection() override;
+  virtual void ToChildrenSection() override;
+  virtual void ToSection(const std::string& section_name) override;
+  virtual void ToSection(const DObjInfo& obj_info) override;
+  virtual void ToSectionUp() override;
+  virtual void WriteDict(const DValueDict& values) override;
+  virtual void WriteDict(const DCompactValueDict& values) override;
+  virtual void CloseForWrite() override;
+  virtual void Load(const FsPath& file_path,
+                    const ReadDataArgPtr& arg) override;
+  virtual LazyDataSourcePtr OpenLazy(const FsPath& file_path) override;
+  static std::string FileName(const std::string& type);
+  static DObjFileInfo GetDataFileInfo(const FsPath& path);
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace detail
+
+}  // namespace core
+
+}  // namespace dino
@@ -0,0 +1,32 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include "dino/core/dexception.h"
+
+namespace dino {
+
+namespace core {
+
+namespace detail {
+
+class BinaryException : public DException {
+ public:
+  BinaryException(int error_id)
+      : DException(error_id) {}
+  BinaryException(const DException& e)
+      : DException(e) {}
+};
+
+extern const int kErrBinaryFileOpen;
+extern const int kErrBinaryInvalidSectionName;
+extern const int kErrBinaryFailedToChangeSection;
+extern const int kErrBinaryInvalidFormat;
+extern const int kErrBinaryUnsupportedVersion;
+
+}  // namespace detail
+
+}  // namespace core
+
+}  // namespace dino
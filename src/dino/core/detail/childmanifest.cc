@@ -0,0 +1,231 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#include "dino/core/detail/childmanifest.h"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace dino {
+
+namespace core {
+
+namespace detail {
+
+namespace {
+
+const std::string kManifestFileName = ".dino_children";
+const std::string kManifestMagic = "dino_children";
+const int kManifestVersion = 1;
+
+struct Header {
+  bool is_sorted = false;
+  uint64_t dir_mtime = 0;
+  size_t count = 0;
+};
+
+FsPath ManifestPath(const FsPath& dir_path) {
+  return dir_path / kManifestFileName;
+}
+
+// The header has a fixed length to be able to be rewritten in place
+std::string HeaderLine(const Header& header) {
+  char buf[128];
+  std::snprintf(buf, sizeof(buf), "%s %d %d %020" PRIu64 " %012zu\n",
+                kManifestMagic.c_str(), kManifestVersion,
+                header.is_sorted ? 1 : 0, header.dir_mtime, header.count);
+  return buf;
+}
+
+bool ReadHeader(std::istream& is, Header* header) {
+  std::string line;
+  if (!std::getline(is, line))
+    return false;
+  std::istringstream line_stream(line);
+  std::string magic;
+  int version = 0;
+  int is_sorted = 0;
+  if (!(line_stream >> magic >> version >> is_sorted
+        >> header->dir_mtime >> header->count))
+    return false;
+  header->is_sorted = is_sorted != 0;
+  return magic == kManifestMagic && version == kManifestVersion;
+}
+
+void WriteHeader(const FsPath& dir_path, const Header& header) {
+  std::fstream f(ManifestPath(dir_path).string(),
+                 std::ios_base::in | std::ios_base::out);
+  if (!f)
+    return;
+  f << HeaderLine(header);
+}
+
+void WriteManifest(const FsPath& dir_path, const Header& header,
+                   const std::vector<ChildManifest::Entry>& entries) {
+  std::ofstream f(ManifestPath(dir_path).string(), std::ios_base::trunc);
+  if (!f)
+    return;
+  f << HeaderLine(header);
+  for (auto& entry : entries)
+    f << entry.name << ' ' << entry.type << '\n';
+}
+
+// flock, since a POSIX record lock would be released when any stream of
+// the manifest is closed in this process. Returns -1 if there's no
+// manifest.
+int LockManifest(const FsPath& dir_path) {
+  auto fd = ::open(ManifestPath(dir_path).string().c_str(), O_RDWR);
+  if (fd < 0)
+    return -1;
+  while (::flock(fd, LOCK_EX) != 0) {
+    if (errno != EINTR) {
+      ::close(fd);
+      return -1;
+    }
+  }
+  return fd;
+}
+
+void UnlockManifest(int fd) {
+  if (fd >= 0)
+    ::close(fd);
+}
+
+bool ReadFreshHeader(const FsPath& dir_path, Header* header) {
+  std::ifstream f(ManifestPath(dir_path).string());
+  if (!f || !ReadHeader(f, header))
+    return false;
+  auto dir_mtime = ChildManifest::DirModifiedTime(dir_path);
+  return dir_mtime != 0 && dir_mtime == header->dir_mtime;
+}
+
+// Returns false if the manifest was rewritten after dir_mtime was checked
+bool ReadUnchangedHeader(const FsPath& dir_path, uint64_t dir_mtime,
+                         Header* header) {
+  if (dir_mtime == 0)
+    return false;
+  std::ifstream f(ManifestPath(dir_path).string());
+  return f && ReadHeader(f, header) && header->dir_mtime == dir_mtime;
+}
+
+}  // namespace
+
+bool ChildManifest::Read(const FsPath& dir_path,
+                         std::vector<Entry>* entries,
+                         bool* is_sorted) {
+  std::ifstream f(ManifestPath(dir_path).string());
+  Header header;
+  if (!f || !ReadHeader(f, &header))
+    return false;
+  auto dir_mtime = DirModifiedTime(dir_path);
+  if (dir_mtime == 0 || dir_mtime != header.dir_mtime)
+    return false;
+  entries->clear();
+  entries->reserve(header.count);
+  Entry entry;
+  while (entries->size() < header.count && f >> entry.name >> entry.type)
+    entries->emplace_back(entry);
+  *is_sorted = header.is_sorted;
+  return entries->size() == header.count;
+}
+
+ChildManifest::Update::Update(const FsPath& dir_path) : dir_path_(dir_path) {
+  if (dir_path_.empty())
+    return;
+  fd_ = LockManifest(dir_path_);
+  Header header;
+  if (fd_ >= 0 && ReadFreshHeader(dir_path_, &header))
+    dir_mtime_ = header.dir_mtime;
+}
+
+ChildManifest::Update::~Update() {
+  UnlockManifest(fd_);
+}
+
+void ChildManifest::Update::Restamp() {
+  Header header;
+  if (!ReadUnchangedHeader(dir_path_, dir_mtime_, &header))
+    return;
+  header.dir_mtime = DirModifiedTime(dir_path_);
+  WriteHeader(dir_path_, header);
+  dir_mtime_ = header.dir_mtime;
+}
+
+void ChildManifest::Update::Append(const Entry& entry) {
+  Header header;
+  if (!ReadUnchangedHeader(dir_path_, dir_mtime_, &header))
+    return;
+  {
+    std::ofstream out(ManifestPath(dir_path_).string(), std::ios_base::app);
+    if (!out)
+      return;
+    out << entry.name << ' ' << entry.type << '\n';
+  }
+  header.is_sorted = false;
+  header.dir_mtime = DirModifiedTime(dir_path_);
+  ++ header.count;
+  WriteHeader(dir_path_, header);
+  dir_mtime_ = header.dir_mtime;
+}
+
+void ChildManifest::Update::Write(const std::vector<Entry>& entries) {
+  Header header;
+  if (!ReadUnchangedHeader(dir_path_, dir_mtime_, &header))
+    return;
+  header.is_sorted = true;
+  header.dir_mtime = DirModifiedTime(dir_path_);
+  header.count = entries.size();
+  WriteManifest(dir_path_, header, entries);
+  dir_mtime_ = header.dir_mtime;
+}
+
+void ChildManifest::Write(const FsPath& dir_path,
+                          const std::vector<Entry>& entries,
+                          uint64_t dir_mtime) {
+  auto fd = LockManifest(dir_path);
+  if (fd < 0) {
+    // Creating the manifest changes the directory. The new time is
+    // recorded if nothing was changed after the entries were listed.
+    if (DirModifiedTime(dir_path) != dir_mtime)
+      return;
+    if (!std::ofstream(ManifestPath(dir_path).string()))
+      return;
+    dir_mtime = DirModifiedTime(dir_path);
+  }
+  Header header;
+  header.is_sorted = true;
+  header.dir_mtime = dir_mtime;
+  header.count = entries.size();
+  WriteManifest(dir_path, header, entries);
+  UnlockManifest(fd);
+}
+
+bool ChildManifest::IsFresh(const FsPath& dir_path) {
+  Header header;
+  return ReadFreshHeader(dir_path, &header);
+}
+
+uint64_t ChildManifest::DirModifiedTime(const FsPath& dir_path) {
+  struct stat st;
+  if (::stat(dir_path.string().c_str(), &st) != 0)
+    return 0;
+  return static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000
+      + static_cast<uint64_t>(st.st_mtim.tv_nsec);
+}
+
+bool ChildManifest::IsManifestFile(const FsPath& path) {
+  return path.filename().string() == kManifestFileName;
+}
+
+}  // namespace detail
+
+}  // namespace core
+
+}  // namespace dino
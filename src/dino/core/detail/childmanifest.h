@@ -0,0 +1,77 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "dino/core/fspath.h"
+
+namespace dino {
+
+namespace core {
+
+namespace detail {
+
+// List of the child directories saved in an object directory, so that
+// the children can be listed without scanning the directory. The list
+// is valid while the modification time of the directory is the one
+// recorded in the manifest. Changes made within the timestamp resolution
+// of the file system after the manifest is written can't be detected.
+class ChildManifest {
+ public:
+  struct Entry {
+    std::string name;
+    std::string type;
+  };
+
+  // Exclusive lock of the manifest, held while this process changes the
+  // children of the directory. The manifest is updated only if it was
+  // fresh when the lock was taken and hasn't been rewritten since then, so
+  // a change made by others before the lock is never hidden. Does nothing
+  // if dir_path is empty or has no manifest.
+  class Update {
+   public:
+    explicit Update(const FsPath& dir_path);
+    ~Update();
+    Update(const Update&) = delete;
+    Update& operator=(const Update&) = delete;
+
+    bool WasFresh() const { return dir_mtime_ != 0; }
+    // Records the current modification time after a change that doesn't
+    // add or remove children
+    void Restamp();
+    // Adds a child created after the lock was taken
+    void Append(const Entry& entry);
+    // Replaces the entries after children were removed
+    void Write(const std::vector<Entry>& entries);
+
+   private:
+    FsPath dir_path_;
+    int fd_ = -1;
+    // Modification time checked when the lock was taken, 0 if not fresh
+    uint64_t dir_mtime_ = 0;
+  };
+
+  // Returns false if dir_path doesn't have a valid manifest
+  static bool Read(const FsPath& dir_path,
+                   std::vector<Entry>* entries,
+                   bool* is_sorted);
+  // dir_mtime is the modification time of the directory when the entries
+  // were listed
+  static void Write(const FsPath& dir_path,
+                    const std::vector<Entry>& entries,
+                    uint64_t dir_mtime);
+  static bool IsFresh(const FsPath& dir_path);
+  // Returns 0 if the time can't be retrieved
+  static uint64_t DirModifiedTime(const FsPath& dir_path);
+  static bool IsManifestFile(const FsPath& path);
+};
+
+}  // namespace detail
+
+}  // namespace core
+
+}  // namespace dino
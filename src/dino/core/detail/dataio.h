@@ -7,10 +7,12 @@
 #include <memory>
 #include <map>
 #include <functional>
+#include <vector>
 
 #include "dino/core/dobjinfo.h"
 #include "dino/core/fspath.h"
 #include "dino/core/dvalue.h"
+#include "dino/core/dcompactvalue.h"
 
 namespace dino {
 
@@ -24,16 +26,33 @@ using ReadDataArgPtr = std::shared_ptr<ReadDataArg>;
 using CreateChildFunc = std::function<ReadDataArgPtr(const DObjInfo& obj_info)>;
 
 struct ReadDataArg {
-  ReadDataArg(DValueDict* v, DValueDict* a, const CreateChildFunc& f)
+  ReadDataArg(DCompactValueDict* v, DValueDict* a, const CreateChildFunc& f)
       : values(v), attrs(a), create_child(f) {}
-  DValueDict* values;
+  DCompactValueDict* values;
   DValueDict* attrs;
   CreateChildFunc create_child;
 };
 
+class LazyDataSource;
+using LazyDataSourcePtr = std::shared_ptr<LazyDataSource>;
+
+// Index of the sections of one object in a data file. Nothing is decoded
+// until it's requested, and child sources are indexed only when opened.
+class LazyDataSource {
+ public:
+  virtual ~LazyDataSource() = default;
+  virtual void ReadValues(DCompactValueDict* values) const = 0;
+  virtual void ReadAttrs(DValueDict* attrs) const = 0;
+  virtual std::vector<DObjInfo> ChildInfoList() const = 0;
+  virtual LazyDataSourcePtr Child(size_t index) const = 0;
+};
+
 class DataIO {
  public:
   virtual ~DataIO() = default;
+  // Called before OpenForWrite if CloseForWrite may run in another thread.
+  // The file may be written at CloseForWrite then.
+  virtual void DeferFileWrite() {}
   virtual void OpenForWrite(const FsPath& file_path) = 0;
   virtual void ToDataSection() = 0;
   virtual void ToAttributeSection() = 0;
@@ -42,9 +61,14 @@ class DataIO {
   virtual void ToSection(const DObjInfo& obj_info) = 0;
   virtual void ToSectionUp() = 0;
   virtual void WriteDict(const DValueDict& values) = 0;
+  virtual void WriteDict(const DCompactValueDict& values) = 0;
   virtual void CloseForWrite() = 0;
   virtual void Load(const FsPath& file_path,
                     const ReadDataArgPtr& arg) = 0;
+  // Returns nullptr if the format can't be loaded lazily
+  virtual LazyDataSourcePtr OpenLazy(const FsPath& /*file_path*/) {
+    return nullptr;
+  }
 };
 
 using DataIOPtr = std::unique_ptr<DataIO>;
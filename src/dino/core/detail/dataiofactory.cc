@@ -9,6 +9,7 @@
 #include <fmt/format.h>
 
 #include "dino/core/detail/jsondataio.h"
+#include "dino/core/detail/binarydataio.h"
 #include "dino/core/detail/dataioexception.h"
 
 namespace dino {
@@ -21,7 +22,8 @@ namespace detail {
 
 namespace {
 
-const std::vector<FileFormat> kSupportedFileFormats = {FileFormat::kJson};
+const std::vector<FileFormat> kSupportedFileFormats = {
+  FileFormat::kJson, FileFormat::kBinary};
 
 }
 
@@ -33,6 +35,8 @@ DataIOPtr DataIOFactory::Create(FileFormat file_format) {
   switch (file_format) {
     case FileFormat::kJson:
       return std::make_unique<JsonDataIO>();
+    case FileFormat::kBinary:
+      return std::make_unique<BinaryDataIO>();
     case FileFormat::kUnknown:
     default:
       BOOST_THROW_EXCEPTION(
@@ -44,6 +48,9 @@ DataIOPtr DataIOFactory::Create(FileFormat file_format) {
 DObjFileInfo DataIOFactory::GetDataFileInfo(const FsPath& path) {
   DObjFileInfo info;
   info = JsonDataIO::GetDataFileInfo(path);
+  if (info.IsValid())
+    return info;
+  info = BinaryDataIO::GetDataFileInfo(path);
   if (info.IsValid())
     return info;
   return info;
@@ -56,6 +63,9 @@ std::string DataIOFactory::DataFileName(const std::string& type,
     case FileFormat::kJson:
       file_name = JsonDataIO::FileName(type);
       break;
+    case FileFormat::kBinary:
+      file_name = BinaryDataIO::FileName(type);
+      break;
     case FileFormat::kUnknown:
     default:
       file_name = fmt::format(
@@ -44,6 +44,10 @@ extern const int kErrAttrDoesNotExist = RegisterErrorCode(
     314, "The object '{}' does not have attribute '{}'.", 2);
 extern const int kErrReservedAttrCantBeUsed = RegisterErrorCode(
     315, "The attr '{}' is reserved by system.", 1);
+extern const int kErrFailedToSaveObjects = RegisterErrorCode(
+    316, "Failed to save {} object(s) -> {}", 2);
+extern const int kErrFailedToMoveDirectory = RegisterErrorCode(
+    317, "Failed to move the directory '{}' -> {}", 2);
 
 extern const int kErrUnknownFileFormat = RegisterErrorCode(
     400, "Unknown file format number '{}'", 1);
@@ -59,6 +63,17 @@ extern const int kErrJsonFailedToChangeSection = RegisterErrorCode(
 extern const int kErrJsonInvalidFileReadState = RegisterErrorCode(
     1004, "Invalid state at json data file reading", 0);
 
+extern const int kErrBinaryFileOpen = RegisterErrorCode(
+    1100, "Can't open the data file '{}' for {}", 2);
+extern const int kErrBinaryInvalidSectionName = RegisterErrorCode(
+    1101, "Invalid section name '{}'", 1);
+extern const int kErrBinaryFailedToChangeSection = RegisterErrorCode(
+    1102, "Failed to change section '{}'", 1);
+extern const int kErrBinaryInvalidFormat = RegisterErrorCode(
+    1103, "The file '{}' is not a valid binary data file", 1);
+extern const int kErrBinaryUnsupportedVersion = RegisterErrorCode(
+    1104, "The file '{}' has unsupported format version {}", 2);
+
 }  // namespace detail
 
 }  // namespace core
@@ -0,0 +1,127 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#include "dino/core/detail/dirwatcher.h"
+
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "dino/core/dexception.h"
+#include "dino/core/sessionexception.h"
+
+namespace dino {
+
+namespace core {
+
+namespace detail {
+
+#ifdef __linux__
+
+namespace {
+
+const uint32_t kWatchMask =
+    IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE
+    | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+unsigned int ToEventType(uint32_t mask) {
+  unsigned int type = 0;
+  if (mask & IN_Q_OVERFLOW)
+    type |= DirWatcher::kOverflow;
+  if (mask & IN_IGNORED)
+    type |= DirWatcher::kWatchRemoved;
+  if (mask & IN_ISDIR) {
+    if (mask & (IN_CREATE | IN_MOVED_TO))
+      type |= DirWatcher::kChildDirAdded;
+    if (mask & (IN_DELETE | IN_MOVED_FROM))
+      type |= DirWatcher::kChildDirRemoved;
+  } else if (mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+    type |= DirWatcher::kFileWritten;
+  }
+  return type;
+}
+
+}  // namespace
+
+DirWatcher::DirWatcher() {
+  fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd_ < 0)
+    BOOST_THROW_EXCEPTION(
+        SessionException(kErrFailedToStartWatcher)
+        << ExpInfo1(std::strerror(errno)));
+}
+
+DirWatcher::~DirWatcher() {
+  if (fd_ >= 0)
+    close(fd_);
+}
+
+int DirWatcher::Watch(const FsPath& dir_path) {
+  return inotify_add_watch(fd_, dir_path.string().c_str(), kWatchMask);
+}
+
+void DirWatcher::Unwatch(int watch_id) {
+  inotify_rm_watch(fd_, watch_id);
+}
+
+std::vector<DirWatcher::Event> DirWatcher::ReadEvents() {
+  std::vector<Event> events;
+  alignas(struct inotify_event) char buf[8192];
+  while (true) {
+    auto len = read(fd_, buf, sizeof(buf));
+    if (len <= 0)
+      break;
+    for (char* ptr = buf; ptr < buf + len; ) {
+      auto event = reinterpret_cast<const struct inotify_event*>(ptr);
+      auto type = ToEventType(event->mask);
+      if (type != 0)
+        events.emplace_back(Event{
+            event->wd, type, event->len > 0 ? event->name : ""});
+      ptr += sizeof(struct inotify_event) + event->len;
+    }
+  }
+  return events;
+}
+
+bool DirWatcher::IsSupported() {
+  return true;
+}
+
+#else
+
+DirWatcher::DirWatcher() {
+}
+
+DirWatcher::~DirWatcher() {
+}
+
+int DirWatcher::Watch(const FsPath&) {
+  return -1;
+}
+
+void DirWatcher::Unwatch(int) {
+}
+
+std::vector<DirWatcher::Event> DirWatcher::ReadEvents() {
+  return std::vector<Event>();
+}
+
+bool DirWatcher::IsSupported() {
+  return false;
+}
+
+#endif
+
+int DirWatcher::FileDescriptor() const {
+  return fd_;
+}
+
+}  // namespace detail
+
+}  // namespace core
+
+}  // namespace dino
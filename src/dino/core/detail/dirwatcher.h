@@ -0,0 +1,60 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "dino/core/fspath.h"
+
+namespace dino {
+
+namespace core {
+
+namespace detail {
+
+// Thin wrapper of inotify. On other platforms, nothing can be watched.
+class DirWatcher {
+ public:
+  enum EventType {
+    kChildDirAdded   = 0x01,
+    kChildDirRemoved = 0x02,
+    kFileWritten     = 0x04,
+    kWatchRemoved    = 0x08,
+    kOverflow        = 0x10
+  };
+
+  struct Event {
+    int watch_id;
+    unsigned int type;  // EventType flags
+    std::string name;
+  };
+
+  // Throws SessionException if the inotify instance can't be created. On
+  // other platforms, nothing is created and Watch always returns -1.
+  DirWatcher();
+  ~DirWatcher();
+  DirWatcher(const DirWatcher&) = delete;
+  DirWatcher& operator=(const DirWatcher&) = delete;
+
+  // Returns -1 if the directory can't be watched
+  int Watch(const FsPath& dir_path);
+  void Unwatch(int watch_id);
+  // Readable while events are pending. -1 if not supported.
+  int FileDescriptor() const;
+  // Doesn't block
+  std::vector<Event> ReadEvents();
+
+  static bool IsSupported();
+
+ private:
+  int fd_ = -1;
+};
+
+}  // namespace detail
+
+}  // namespace core
+
+}  // namespace dino
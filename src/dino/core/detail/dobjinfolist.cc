@@ -0,0 +1,178 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#include "dino/core/detail/dobjinfolist.h"
+
+#include <algorithm>
+
+namespace dino {
+
+namespace core {
+
+namespace detail {
+
+DObjInfoList::DObjInfoList() = default;
+
+DObjInfoList::DObjInfoList(const std::vector<DObjInfo>& obj_list) {
+  for (auto& obj_info : obj_list)
+    Append(obj_info);
+}
+
+DObjInfoList::DObjInfoList(const DObjInfoList& other) {
+  *this = other;
+}
+
+DObjInfoList::DObjInfoList(DObjInfoList&& other) = default;
+
+DObjInfoList::~DObjInfoList() = default;
+
+DObjInfoList& DObjInfoList::operator=(const DObjInfoList& other) {
+  if (this == &other)
+    return *this;
+  Clear();
+  info_map_.reserve(other.Size());
+  order_.reserve(other.Size());
+  for (auto& obj_info : other)
+    Append(obj_info);
+  comp_ = other.comp_;
+  is_sorted_ = other.is_sorted_;
+  return *this;
+}
+
+DObjInfoList& DObjInfoList::operator=(DObjInfoList&& other) {
+  auto generation = std::max(generation_, other.generation_) + 1;
+  info_map_ = std::move(other.info_map_);
+  order_ = std::move(other.order_);
+  comp_ = std::move(other.comp_);
+  is_sorted_ = other.is_sorted_;
+  generation_ = generation;
+  other.Clear();
+  return *this;
+}
+
+size_t DObjInfoList::IndexOf(const std::string& name) const {
+  auto obj_info = Find(name);
+  if (!obj_info)
+    return Size();
+  return std::distance(order_.cbegin(), FindInOrder(obj_info));
+}
+
+bool DObjInfoList::Has(const std::string& name) const {
+  return info_map_.find(name) != info_map_.cend();
+}
+
+const DObjInfo* DObjInfoList::Find(const std::string& name) const {
+  auto itr = info_map_.find(name);
+  if (itr == info_map_.cend())
+    return nullptr;
+  return &itr->second;
+}
+
+DObjInfo* DObjInfoList::Find(const std::string& name) {
+  auto itr = info_map_.find(name);
+  if (itr == info_map_.end())
+    return nullptr;
+  return &itr->second;
+}
+
+void DObjInfoList::Append(const DObjInfo& obj_info) {
+  Erase(obj_info.Name());
+  auto& info = info_map_[obj_info.Name()] = obj_info;
+  order_.push_back(&info);
+  is_sorted_ = false;
+  ++ generation_;
+}
+
+void DObjInfoList::Insert(const DObjInfo& obj_info,
+                          const DObjCompareFunc& comp) {
+  Erase(obj_info.Name());
+  // Entries added by Append are put in order first
+  if (!is_sorted_)
+    Sort(comp);
+  auto& info = info_map_[obj_info.Name()] = obj_info;
+  auto itr = std::upper_bound(
+      order_.begin(), order_.end(), &info,
+      [&comp](const DObjInfo* lhs, const DObjInfo* rhs) {
+        return comp(*lhs, *rhs); });
+  order_.insert(itr, &info);
+  ++ generation_;
+}
+
+bool DObjInfoList::Erase(const std::string& name) {
+  auto itr = info_map_.find(name);
+  if (itr == info_map_.end())
+    return false;
+  order_.erase(FindInOrder(&itr->second));
+  info_map_.erase(itr);
+  ++ generation_;
+  return true;
+}
+
+void DObjInfoList::EraseIf(
+    const std::function<bool (const DObjInfo&)>& pred) {
+  order_.erase(
+      std::remove_if(order_.begin(), order_.end(),
+                     [&pred](const DObjInfo* info) { return pred(*info); }),
+      order_.end());
+  if (order_.size() == info_map_.size())
+    return;
+  ++ generation_;
+  for (auto itr = info_map_.begin(); itr != info_map_.end();) {
+    if (pred(itr->second))
+      itr = info_map_.erase(itr);
+    else
+      ++ itr;
+  }
+}
+
+void DObjInfoList::Clear() {
+  order_.clear();
+  info_map_.clear();
+  ++ generation_;
+}
+
+void DObjInfoList::Sort(const DObjCompareFunc& comp) {
+  std::sort(order_.begin(), order_.end(),
+            [&comp](const DObjInfo* lhs, const DObjInfo* rhs) {
+              return comp(*lhs, *rhs); });
+  comp_ = comp;
+  is_sorted_ = true;
+  ++ generation_;
+}
+
+std::vector<DObjInfo> DObjInfoList::ToVector() const {
+  return std::vector<DObjInfo>(begin(), end());
+}
+
+bool DObjInfoList::operator==(const DObjInfoList& rhs) const {
+  return Size() == rhs.Size() && std::equal(begin(), end(), rhs.begin());
+}
+
+bool DObjInfoList::operator!=(const DObjInfoList& rhs) const {
+  return !(*this == rhs);
+}
+
+std::vector<DObjInfo*>::const_iterator DObjInfoList::FindInOrder(
+    const DObjInfo* obj_info) const {
+  if (is_sorted_) {
+    auto comp = [this](const DObjInfo* lhs, const DObjInfo* rhs) {
+      return comp_(*lhs, *rhs); };
+    auto range = std::equal_range(
+        order_.cbegin(), order_.cend(), obj_info, comp);
+    auto itr = std::find(range.first, range.second, obj_info);
+    if (itr != range.second)
+      return itr;
+    // The sort keys of the entry may have been changed after it was
+    // inserted. Falls back to the scan below.
+  }
+  // Scanning pointers from the back, since recently added entries are
+  // the most likely ones to be removed.
+  auto ritr = std::find(order_.rbegin(), order_.rend(), obj_info);
+  return std::prev(ritr.base());
+}
+
+}  // namespace detail
+
+}  // namespace core
+
+}  // namespace dino
@@ -0,0 +1,83 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <boost/iterator/indirect_iterator.hpp>
+
+#include "dino/core/dobjinfo.h"
+
+namespace dino {
+
+namespace core {
+
+namespace detail {
+
+using DObjCompareFunc = std::function<
+  bool (const DObjInfo& lhs, const DObjInfo& rhs)>;
+
+// Ordered list of DObjInfo indexed by object name. Lookup by name is O(1).
+// The order is a vector of pointers, so Insert and Erase find the position
+// with O(log N) comparisons but move O(N) pointers. The list keeps the
+// comparator given to Insert or Sort, and finds the position of an entry
+// by binary search until Append breaks the order.
+class DObjInfoList {
+ public:
+  using const_iterator = boost::indirect_iterator<
+    std::vector<DObjInfo*>::const_iterator, const DObjInfo>;
+
+  DObjInfoList();
+  DObjInfoList(const std::vector<DObjInfo>& obj_list);
+  DObjInfoList(const DObjInfoList& other);
+  DObjInfoList(DObjInfoList&& other);
+  ~DObjInfoList();
+  DObjInfoList& operator=(const DObjInfoList& other);
+  DObjInfoList& operator=(DObjInfoList&& other);
+
+  const_iterator begin() const { return const_iterator(order_.cbegin()); }
+  const_iterator end() const { return const_iterator(order_.cend()); }
+  size_t Size() const { return order_.size(); }
+  bool Empty() const { return order_.empty(); }
+  const DObjInfo& At(size_t index) const { return *order_[index]; }
+  size_t IndexOf(const std::string& name) const;
+  // Incremented whenever the entries or their order change
+  size_t Generation() const { return generation_; }
+
+  bool Has(const std::string& name) const;
+  const DObjInfo* Find(const std::string& name) const;
+  DObjInfo* Find(const std::string& name);
+
+  // Add to the end. An entry with the same name is replaced.
+  void Append(const DObjInfo& obj_info);
+  // Add at the sorted position. The list is sorted by comp first if
+  // entries were appended after the last Insert or Sort.
+  void Insert(const DObjInfo& obj_info, const DObjCompareFunc& comp);
+  bool Erase(const std::string& name);
+  void EraseIf(const std::function<bool (const DObjInfo&)>& pred);
+  void Clear();
+  void Sort(const DObjCompareFunc& comp);
+
+  std::vector<DObjInfo> ToVector() const;
+  bool operator==(const DObjInfoList& rhs) const;
+  bool operator!=(const DObjInfoList& rhs) const;
+
+ private:
+  std::vector<DObjInfo*>::const_iterator FindInOrder(
+      const DObjInfo* obj_info) const;
+
+  std::unordered_map<std::string, DObjInfo> info_map_;
+  std::vector<DObjInfo*> order_;
+  DObjCompareFunc comp_;
+  bool is_sorted_ = false;
+  size_t generation_ = 0;
+};
+
+}  // namespace detail
+
+}  // namespace core
+
+}  // namespace dino
@@ -16,6 +16,7 @@
 #include "rapidjson/prettywriter.h"
 #include "rapidjson/filereadstream.h"
 #include "rapidjson/filewritestream.h"
+#include "rapidjson/stringbuffer.h"
 
 namespace dino {
 
@@ -44,10 +45,12 @@ class ReadData : public BaseReaderHandler<UTF8<>, ReadData> {
   }
   template<typename T>
   bool StoreValue(T value) {
-    if (cxt->current_array_stack.empty())
-      (*(cxt->current_dict))[cxt->current_key] = value;
-    else
+    if (!cxt->current_array_stack.empty())
       cxt->current_array_stack.back()->emplace_back(value);
+    else if (cxt->current_values)
+      (*(cxt->current_values))[cxt->current_key] = DCompactValue(value);
+    else
+      (*(cxt->current_dict))[cxt->current_key] = std::move(value);
     return true;
   }
   bool Null() {
@@ -79,7 +82,7 @@ class ReadData : public BaseReaderHandler<UTF8<>, ReadData> {
       auto arg = cxt->arg->create_child(DObjInfo::FromString(key));
       PushNewStack(arg);
     } else if (key == kDataSectionName) {
-      cxt->current_dict = cxt->arg->values;
+      cxt->current_values = cxt->arg->values;
     } else if (key == kAttributeSectionName) {
       cxt->current_dict = cxt->arg->attrs;
     } else if (key == kChildrenSectionName) {
@@ -88,7 +91,7 @@ class ReadData : public BaseReaderHandler<UTF8<>, ReadData> {
     return true;
   }
   bool StartObject() {
-    if (cxt->current_dict)
+    if (cxt->current_dict || cxt->current_values)
       cxt->reading_dict = true;
     return true;
   }
@@ -96,6 +99,7 @@ class ReadData : public BaseReaderHandler<UTF8<>, ReadData> {
     if (cxt->reading_dict) {
       cxt->reading_dict = false;
       cxt->current_dict = nullptr;
+      cxt->current_values = nullptr;
     } else if (cxt->in_child_section) {
       cxt->in_child_section = false;
     } else {
@@ -106,18 +110,20 @@ class ReadData : public BaseReaderHandler<UTF8<>, ReadData> {
   bool StartArray() {
     DValueArray* new_array;
     if (cxt->current_array_stack.empty()) {
-      (*(cxt->current_dict))[cxt->current_key] = DValueArray();
-      new_array = &boost::get<DValueArray&>(
-          (*(cxt->current_dict))[cxt->current_key]);
+      cxt->current_array.clear();
+      new_array = &cxt->current_array;
     } else {
-      cxt->current_array_stack.back()->push_back(DValueArray());
-      new_array = cxt->current_array_stack.back();
+      auto parent_array = cxt->current_array_stack.back();
+      parent_array->push_back(DValueArray());
+      new_array = &boost::get<DValueArray&>(parent_array->back());
     }
     cxt->current_array_stack.push_back(new_array);
     return true;
   }
   bool EndArray(SizeType) {
     cxt->current_array_stack.pop_back();
+    if (cxt->current_array_stack.empty())
+      StoreValue(DValue(std::move(cxt->current_array)));
     return true;
   }
   void PushNewStack(const ReadDataArgPtr& arg) {
@@ -140,6 +146,8 @@ class ReadData : public BaseReaderHandler<UTF8<>, ReadData> {
     bool in_child_section = false;
     std::string current_key;
     DValueDict* current_dict = nullptr;
+    DCompactValueDict* current_values = nullptr;
+    DValueArray current_array;
     std::vector<DValueArray*> current_array_stack;
     ReadDataArgPtr arg;
   };
@@ -147,9 +155,36 @@ class ReadData : public BaseReaderHandler<UTF8<>, ReadData> {
   ReadContext* cxt;
 };
 
+namespace {
+
+// Writes to the file, or to the buffer if the file is written later
+class OutputStream {
+ public:
+  typedef char Ch;
+  OutputStream(FileWriteStream* file_stream, StringBuffer* buf)
+      : file_stream_(file_stream), buf_(buf) {}
+  void Put(Ch c) {
+    if (file_stream_)
+      file_stream_->Put(c);
+    else
+      buf_->Put(c);
+  }
+  void Flush() {
+    if (file_stream_)
+      file_stream_->Flush();
+  }
+
+ private:
+  FileWriteStream* file_stream_;
+  StringBuffer* buf_;
+};
+
+}  // namespace
+
 class JsonDataIO::Impl {
  public:
-  Impl(const std::string& file_path) : file_path(file_path) {}
+  Impl(const std::string& file_path, bool buffered)
+      : file_path(file_path), buffered(buffered) {}
   ~Impl() = default;
   void Init() {
     working_path = file_path + ".writing";
@@ -165,28 +200,57 @@ class JsonDataIO::Impl {
           << ExpInfo1(file_path) << ExpInfo2("writing"));
     }
     std::fclose(test_f);
-    fs = std::make_unique<FileWriteStream>(f, buf, sizeof(buf));
-    writer = std::make_unique<PrettyWriter<FileWriteStream>>(*fs);
+    if (!buffered) {
+      file_buf = std::make_unique<char[]>(kDataFileIOBufSize);
+      fs = std::make_unique<FileWriteStream>(
+          f, file_buf.get(), kDataFileIOBufSize);
+    }
+    os = std::make_unique<OutputStream>(fs.get(), &buf);
+    writer = std::make_unique<PrettyWriter<OutputStream>>(*os);
     writer->SetIndent(' ', 2);
     data_writer = std::make_unique<
-      WriteData<PrettyWriter<FileWriteStream>>>(*writer);
+      WriteData<PrettyWriter<OutputStream>>>(*writer);
+  }
+  void WriteFile() {
+    auto failed = false;
+    if (buffered) {
+      auto size = buf.GetSize();
+      failed = std::fwrite(buf.GetString(), 1, size, f) != size;
+    } else {
+      failed = std::ferror(f) != 0;
+    }
+    std::fclose(f);
+    if (failed)
+      BOOST_THROW_EXCEPTION(
+          JsonException(kErrJsonFileOpen)
+          << ExpInfo1(file_path) << ExpInfo2("writing"));
   }
   std::string file_path;
   std::string working_path;
   std::FILE* f;
-  char buf[kDataFileIOBufSize];
-  std::vector<std::string> current_path;
+  // If buffered, the whole file is written at CloseForWrite so that the
+  // file access can be done apart from the serialization
+  bool buffered;
+  StringBuffer buf;
+  std::unique_ptr<char[]> file_buf;
   std::unique_ptr<FileWriteStream> fs;
-  std::unique_ptr<PrettyWriter<FileWriteStream>> writer;
-  std::unique_ptr<WriteData<PrettyWriter<FileWriteStream>>> data_writer;
+  std::unique_ptr<OutputStream> os;
+  std::vector<std::string> current_path;
+  std::unique_ptr<PrettyWriter<OutputStream>> writer;
+  std::unique_ptr<WriteData<PrettyWriter<OutputStream>>> data_writer;
 };
 
 JsonDataIO::JsonDataIO() = default;
 
 JsonDataIO::~JsonDataIO() = default;
 
+void JsonDataIO::DeferFileWrite() {
+  defer_file_write_ = true;
+}
+
 void JsonDataIO::OpenForWrite(const FsPath& file_path) {
-  impl_ = std::make_unique<JsonDataIO::Impl>(file_path.string());
+  impl_ = std::make_unique<JsonDataIO::Impl>(
+      file_path.string(), defer_file_write_);
   impl_->Init();
   impl_->writer->StartObject();
 }
@@ -234,6 +298,42 @@ void JsonDataIO::WriteDict(const DValueDict& values) {
   }
 }
 
+void JsonDataIO::WriteDict(const DCompactValueDict& values) {
+  for (auto& kv : values) {
+    impl_->writer->Key(kv.first.c_str());
+    WriteValue(kv.second);
+  }
+}
+
+void JsonDataIO::WriteValue(const DCompactValue& value) {
+  auto& writer = impl_->writer;
+  switch (value.Type()) {
+    case DCompactValue::ValueType::kBool:
+      writer->Bool(value.AsBool());
+      break;
+    case DCompactValue::ValueType::kInt:
+      writer->Int(value.AsInt());
+      break;
+    case DCompactValue::ValueType::kDouble:
+      writer->Double(value.AsDouble());
+      break;
+    case DCompactValue::ValueType::kString:
+      writer->String(value.StringData(),
+                     static_cast<SizeType>(value.StringSize()));
+      break;
+    case DCompactValue::ValueType::kArray:
+      writer->StartArray();
+      for (size_t idx = 0; idx < value.ArraySize(); ++ idx)
+        WriteValue(value.ArrayAt(idx));
+      writer->EndArray();
+      break;
+    case DCompactValue::ValueType::kNil:
+    default:
+      writer->Null();
+      break;
+  }
+}
+
 void JsonDataIO::WriteValue(const DValue& value) {
   if (IsArrayValue(value)) {
     impl_->writer->StartArray();
@@ -249,7 +349,7 @@ void JsonDataIO::CloseForWrite() {
   for (auto v : impl_->current_path)
     impl_->writer->EndObject();
   impl_->writer->EndObject();
-  std::fclose(impl_->f);
+  impl_->WriteFile();
   fs::rename(impl_->working_path, impl_->file_path);
 }
 
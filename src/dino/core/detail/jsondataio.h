@@ -20,6 +20,7 @@ class JsonDataIO : public DataIO {
  public:
   JsonDataIO();
   ~JsonDataIO();
+  virtual void DeferFileWrite() override;
   virtual void OpenForWrite(const FsPath& file_path) override;
   virtual void ToDataSection() override;
   virtual void ToAttributeSection() override;
@@ -28,7 +29,9 @@ class JsonDataIO : public DataIO {
   virtual void ToSection(const DObjInfo& obj_info) override;
   virtual void ToSectionUp() override;
   virtual void WriteDict(const DValueDict& values) override;
+  virtual void WriteDict(const DCompactValueDict& values) override;
   void WriteValue(const DValue& value);
+  void WriteValue(const DCompactValue& value);
   virtual void CloseForWrite() override;
   virtual void Load(const FsPath& file_path,
                     const ReadDataArgPtr& arg) override;
@@ -38,6 +41,7 @@ class JsonDataIO : public DataIO {
  private:
   class Impl;
   std::unique_ptr<Impl> impl_;
+  bool defer_file_write_ = false;
 };
 
 }  // namespace detail
@@ -0,0 +1,155 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#include "dino/core/detail/listenerrouter.h"
+
+#include <algorithm>
+
+namespace dino {
+
+namespace core {
+
+namespace detail {
+
+namespace {
+
+const size_t kMinEntriesToRemove = 16;
+
+class DispatchDepthGuard {
+ public:
+  explicit DispatchDepthGuard(size_t& depth) : depth_(depth) { ++ depth_; }
+  ~DispatchDepthGuard() { -- depth_; }
+
+ private:
+  size_t& depth_;
+};
+
+unsigned int ToBits(CommandType type) {
+  return static_cast<unsigned int>(type);
+}
+
+}  // namespace
+
+boost::signals2::connection ListenerRouter::Connect(
+    const ObjectListenerFunc& listener, const ListenerFilter& filter) {
+  if (dispatch_depth_ == 0
+      && num_entries_ >= num_entries_after_removal_ * 2 + kMinEntriesToRemove)
+    RemoveDisconnected();
+
+  auto route = std::make_shared<Route>();
+  route->path_prefix = filter.path_prefix;
+  auto connection = route->sig.connect(listener);
+
+  auto mask = filter.command_type_mask;
+  auto value_bits =
+      ToBits(CommandType::kValueUpdateType)
+      | ToBits(CommandType::kMultiValueUpdateType);
+  bool group_matched[kNumGroups] = {
+    mask == 0 || (mask & value_bits),
+    mask == 0 || (mask & ToBits(CommandType::kBaseObjectUpdateType)),
+    mask == 0 || (mask & ToBits(CommandType::kChildListUpdateType))
+  };
+  for (int group = 0; group < kNumGroups; ++ group) {
+    if (!group_matched[group])
+      continue;
+    auto& table = tables_[group];
+    if (group == kValueGroup && !filter.keys.empty()) {
+      for (auto& key : filter.keys)
+        table.key_routes[key].push_back(route);
+      num_entries_ += filter.keys.size();
+    } else {
+      table.any_key_routes.push_back(route);
+      ++ num_entries_;
+    }
+  }
+  return connection;
+}
+
+void ListenerRouter::Dispatch(const Command& cmd) {
+  if (num_entries_ == 0)
+    return;
+  auto group = GroupOf(cmd.Type());
+  if (group < 0)
+    return;
+  auto& table = tables_[group];
+  DispatchDepthGuard guard(dispatch_depth_);
+  Call(table.any_key_routes, cmd);
+  if (group != kValueGroup || table.key_routes.empty())
+    return;
+  if (!cmd.IsMultiValueUpdate()) {
+    auto it = table.key_routes.find(cmd.Key());
+    if (it != table.key_routes.end())
+      Call(it->second, cmd);
+    return;
+  }
+  // A listener of several keys is called once
+  RouteList routes;
+  for (auto& key : cmd.Keys()) {
+    auto it = table.key_routes.find(key);
+    if (it != table.key_routes.end())
+      routes.insert(routes.end(), it->second.cbegin(), it->second.cend());
+  }
+  std::sort(routes.begin(), routes.end());
+  routes.erase(std::unique(routes.begin(), routes.end()), routes.end());
+  Call(routes, cmd);
+}
+
+int ListenerRouter::GroupOf(CommandType type) {
+  // Child list bits have to be checked first since kAddFlattenedChild has
+  // the bit of kValueUpdateType
+  auto bits = ToBits(type);
+  if (bits & ToBits(CommandType::kChildListUpdateType))
+    return kChildListGroup;
+  if (bits & ToBits(CommandType::kBaseObjectUpdateType))
+    return kBaseObjectGroup;
+  if (bits & (ToBits(CommandType::kValueUpdateType)
+              | ToBits(CommandType::kMultiValueUpdateType)))
+    return kValueGroup;
+  return -1;
+}
+
+void ListenerRouter::Call(const RouteList& routes, const Command& cmd) {
+  // The list may grow while the listeners are called
+  for (size_t idx = 0; idx < routes.size(); ++ idx) {
+    auto route = routes[idx];
+    Call(route, cmd);
+  }
+}
+
+void ListenerRouter::Call(const RouteSp& route, const Command& cmd) {
+  if (route->sig.empty())
+    return;
+  if (!route->path_prefix.Empty()
+      && !cmd.ObjPath().IsDescendantOf(route->path_prefix, true))
+    return;
+  route->sig(cmd);
+}
+
+void ListenerRouter::RemoveDisconnected() {
+  auto is_disconnected = [](auto& route) { return route->sig.empty(); };
+  auto remove_from = [&is_disconnected](RouteList& routes) {
+    routes.erase(
+        std::remove_if(routes.begin(), routes.end(), is_disconnected),
+        routes.end());
+    return routes.size();
+  };
+  num_entries_ = 0;
+  for (auto& table : tables_) {
+    num_entries_ += remove_from(table.any_key_routes);
+    for (auto it = table.key_routes.begin(); it != table.key_routes.end();) {
+      auto size = remove_from(it->second);
+      num_entries_ += size;
+      if (size == 0)
+        it = table.key_routes.erase(it);
+      else
+        ++ it;
+    }
+  }
+  num_entries_after_removal_ = num_entries_;
+}
+
+}  // namespace detail
+
+}  // namespace core
+
+}  // namespace dino
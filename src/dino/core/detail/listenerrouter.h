@@ -0,0 +1,59 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <array>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "dino/core/callback.h"
+
+namespace dino {
+
+namespace core {
+
+namespace detail {
+
+// Listeners with filters. The listeners are registered by command type
+// group and key when connected, so that a command reaches only the
+// listeners of its group and keys, plus the ones not filtered by keys.
+class ListenerRouter {
+ public:
+  boost::signals2::connection Connect(const ObjectListenerFunc& listener,
+                                      const ListenerFilter& filter);
+  void Dispatch(const Command& cmd);
+
+ private:
+  struct Route {
+    boost::signals2::signal<void (const Command&)> sig;
+    DObjPath path_prefix;
+  };
+  using RouteSp = std::shared_ptr<Route>;
+  using RouteList = std::vector<RouteSp>;
+  struct Table {
+    RouteList any_key_routes;
+    std::unordered_map<std::string, RouteList> key_routes;
+  };
+  enum { kValueGroup, kBaseObjectGroup, kChildListGroup, kNumGroups };
+
+  static int GroupOf(CommandType type);
+  static void Call(const RouteList& routes, const Command& cmd);
+  static void Call(const RouteSp& route, const Command& cmd);
+  void RemoveDisconnected();
+
+  std::array<Table, kNumGroups> tables_;
+  // Number of the entries in the tables, which may include disconnected
+  // routes until they are removed
+  size_t num_entries_ = 0;
+  size_t num_entries_after_removal_ = 0;
+  size_t dispatch_depth_ = 0;
+};
+
+}  // namespace detail
+
+}  // namespace core
+
+}  // namespace dino
@@ -0,0 +1,147 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#include "dino/core/detail/lockmanager.h"
+
+#include <string>
+#include <vector>
+
+#include "dino/core/detail/locktable.h"
+
+namespace dino {
+
+namespace core {
+
+namespace detail {
+
+namespace {
+
+// Entries under path in a container keyed by the path strings. '0'
+// follows '/' in ASCII.
+template<typename Container>
+auto DescendantRange(Container& container, const std::string& path) {
+  return std::make_pair(container.lower_bound(path + '/'),
+                        container.lower_bound(path + '0'));
+}
+
+}  // namespace
+
+LockManager::LockManager() = default;
+
+LockManager::~LockManager() {
+  for (auto& root : roots_) {
+    auto table = Table(root);
+    if (table)
+      table->Unlock(root, this);
+  }
+}
+
+std::string LockManager::FindRoot(const std::string& path) const {
+  for (auto len = path.size(); len != std::string::npos && len > 0;
+       len = path.rfind('/', len - 1)) {
+    auto itr = roots_.find(path.substr(0, len));
+    if (itr != roots_.cend())
+      return *itr;
+  }
+  return std::string();
+}
+
+std::shared_ptr<LockTable> LockManager::Table(const std::string& path) const {
+  auto itr = tables_.find(path.substr(0, path.find('/')));
+  return itr == tables_.cend() ? nullptr : itr->second;
+}
+
+bool LockManager::IsCovered(const DObjPath& obj_path) const {
+  return !FindRoot(obj_path.String()).empty();
+}
+
+bool LockManager::Acquire(const DObjPath& obj_path,
+                          const FsPath& top_dir_path) {
+  auto path = obj_path.String();
+  auto itr = acquired_.find(path);
+  if (itr != acquired_.end()) {
+    ++ itr->second;
+    return true;
+  }
+  if (FindRoot(path).empty()) {
+    auto table = Table(path);
+    if (!table) {
+      table = LockTable::Open(top_dir_path);
+      if (!table)
+        return false;
+      tables_[obj_path.TopName()] = table;
+    }
+    if (!table->Lock(path, this))
+      return false;
+    // The locks of the descendants are covered by the new one
+    auto range = DescendantRange(roots_, path);
+    for (auto root_itr = range.first; root_itr != range.second; ++ root_itr)
+      table->Unlock(*root_itr, this);
+    roots_.erase(range.first, range.second);
+    auto kept_range = DescendantRange(kept_roots_, path);
+    kept_roots_.erase(kept_range.first, kept_range.second);
+    roots_.insert(path);
+  }
+  acquired_.emplace(path, 1);
+  return true;
+}
+
+bool LockManager::Release(const DObjPath& obj_path) {
+  auto path = obj_path.String();
+  auto itr = acquired_.find(path);
+  if (itr == acquired_.end())
+    return true;
+  if (-- itr->second > 0)
+    return true;
+  acquired_.erase(itr);
+
+  // Roots not acquired any more are this one and the ones kept by failed
+  // releases
+  std::vector<std::string> released_roots(kept_roots_.cbegin(),
+                                          kept_roots_.cend());
+  kept_roots_.clear();
+  if (roots_.find(path) != roots_.cend())
+    released_roots.emplace_back(path);
+  auto result = true;
+  for (auto& root : released_roots)
+    if (roots_.find(root) != roots_.cend()
+        && acquired_.find(root) == acquired_.cend()
+        && !ReleaseRoot(root))
+      result = false;
+  return result;
+}
+
+bool LockManager::ReleaseRoot(const std::string& root) {
+  // The descendants still acquired become the new roots. Nobody else can
+  // hold them while the subtree is locked. Ancestors are sorted before
+  // their descendants, so the covered ones are skipped.
+  auto table = Table(root);
+  roots_.erase(root);
+  std::vector<std::string> new_roots;
+  auto range = DescendantRange(acquired_, root);
+  for (auto itr = range.first; itr != range.second; ++ itr) {
+    auto& descendant = itr->first;
+    if (!FindRoot(descendant).empty())
+      continue;
+    if (!table->Lock(descendant, this)) {
+      // Keep the root so that the descendants stay locked
+      for (auto& new_root : new_roots) {
+        table->Unlock(new_root, this);
+        roots_.erase(new_root);
+      }
+      roots_.insert(root);
+      kept_roots_.insert(root);
+      return false;
+    }
+    roots_.insert(descendant);
+    new_roots.emplace_back(descendant);
+  }
+  table->Unlock(root, this);
+  return true;
+}
+
+}  // namespace detail
+
+}  // namespace core
+
+}  // namespace dino
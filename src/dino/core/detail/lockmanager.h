@@ -0,0 +1,59 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+#include "dino/core/dobjpath.h"
+#include "dino/core/fspath.h"
+
+namespace dino {
+
+namespace core {
+
+namespace detail {
+
+class LockTable;
+
+// Write locks of one session. A lock covers the subtree of the object, so
+// objects opened under a locked ancestor don't touch the lock table.
+class LockManager {
+ public:
+  LockManager();
+  ~LockManager();
+
+  // Returns false if the object is locked by others. top_dir_path is the
+  // directory of the top level object of obj_path.
+  bool Acquire(const DObjPath& obj_path, const FsPath& top_dir_path);
+  // Returns false if a lock in the table is kept since the descendants
+  // still acquired couldn't be locked. Kept locks are retried by the
+  // later releases.
+  bool Release(const DObjPath& obj_path);
+  // True if obj_path or its ancestor has been locked by this manager
+  bool IsCovered(const DObjPath& obj_path) const;
+
+ private:
+  // Paths are keyed by their strings, so that the descendants of a path
+  // follow it in the ordered containers
+  std::string FindRoot(const std::string& path) const;
+  bool ReleaseRoot(const std::string& root);
+  std::shared_ptr<LockTable> Table(const std::string& path) const;
+
+  std::unordered_map<std::string, std::shared_ptr<LockTable>> tables_;
+  std::map<std::string, size_t> acquired_;
+  // Paths locked in the tables
+  std::set<std::string> roots_;
+  // Roots kept by failed releases
+  std::set<std::string> kept_roots_;
+};
+
+}  // namespace detail
+
+}  // namespace core
+
+}  // namespace dino
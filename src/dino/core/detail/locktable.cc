@@ -0,0 +1,303 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#include "dino/core/detail/locktable.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+namespace dino {
+
+namespace core {
+
+namespace detail {
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+const std::string kLockTableFileName = ".dino_locks";
+// Byte 0 guards updates of the table. Slot n starts at (n + 1) * kSlotSize.
+// An entry is a head slot having the length and the beginning of the path,
+// followed by continuation slots for the rest of a long path. The first
+// byte of a slot is its tag, and the record lock is taken on the first
+// byte of the head.
+const size_t kSlotSize = 256;
+const char kFreeTag = '\0';
+const char kHeadTag = 'H';
+const char kContinuationTag = 'C';
+const size_t kHeadPayloadSize = kSlotSize - 1 - sizeof(uint32_t);
+const size_t kContinuationPayloadSize = kSlotSize - 1;
+
+size_t NumSlots(size_t path_size) {
+  if (path_size <= kHeadPayloadSize)
+    return 1;
+  return 1 + (path_size - kHeadPayloadSize + kContinuationPayloadSize - 1)
+      / kContinuationPayloadSize;
+}
+
+std::vector<char> EncodeEntry(const std::string& path) {
+  std::vector<char> data(NumSlots(path.size()) * kSlotSize, '\0');
+  auto size = static_cast<uint32_t>(path.size());
+  data[0] = kHeadTag;
+  std::memcpy(&data[1], &size, sizeof(size));
+  auto len = std::min(path.size(), kHeadPayloadSize);
+  std::memcpy(&data[1 + sizeof(size)], path.data(), len);
+  for (size_t pos = len, slot = 1; pos < path.size(); ++ slot) {
+    len = std::min(path.size() - pos, kContinuationPayloadSize);
+    data[slot * kSlotSize] = kContinuationTag;
+    std::memcpy(&data[slot * kSlotSize + 1], path.data() + pos, len);
+    pos += len;
+  }
+  return data;
+}
+
+// Returns the number of slots of the entry whose head is at slot, or 0 if
+// the entry is broken
+size_t DecodeEntry(const std::vector<char>& buf, size_t slot,
+                   std::string* path) {
+  auto num_slots = buf.size() / kSlotSize;
+  auto head = &buf[slot * kSlotSize];
+  uint32_t size;
+  std::memcpy(&size, head + 1, sizeof(size));
+  auto entry_slots = NumSlots(size);
+  if (slot + entry_slots > num_slots)
+    return 0;
+  path->assign(head + 1 + sizeof(size), std::min<size_t>(size, kHeadPayloadSize));
+  for (size_t idx = 1; idx < entry_slots; ++ idx) {
+    auto data = &buf[(slot + idx) * kSlotSize];
+    if (data[0] != kContinuationTag)
+      return 0;
+    path->append(data + 1, std::min(size - path->size(),
+                                    kContinuationPayloadSize));
+  }
+  return entry_slots;
+}
+
+bool IsConflicting(const std::string& path1, const std::string& path2) {
+  auto& shorter = path1.size() < path2.size() ? path1 : path2;
+  auto& longer = path1.size() < path2.size() ? path2 : path1;
+  if (longer.compare(0, shorter.size(), shorter) != 0)
+    return false;
+  return longer.size() == shorter.size() || longer[shorter.size()] == '/';
+}
+
+off_t SlotOffset(size_t slot) {
+  return static_cast<off_t>((slot + 1) * kSlotSize);
+}
+
+std::mutex& TablesMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+std::unordered_map<std::string, std::weak_ptr<LockTable>>& Tables() {
+  static std::unordered_map<std::string, std::weak_ptr<LockTable>> tables;
+  return tables;
+}
+
+}  // namespace
+
+LockTable::LockTable(int fd) : fd_(fd) {
+}
+
+LockTable::~LockTable() {
+  // Closing the file releases all the record locks of this process
+  close(fd_);
+}
+
+bool LockTable::LockRange(int cmd, short type, off_t start, off_t len) const {
+  struct flock fl;
+  std::memset(&fl, 0, sizeof(fl));
+  fl.l_type = type;
+  fl.l_whence = SEEK_SET;
+  fl.l_start = start;
+  fl.l_len = len;
+  while (fcntl(fd_, cmd, &fl) == -1)
+    if (errno != EINTR)
+      return false;
+  return true;
+}
+
+bool LockTable::IsSlotHeldByOtherProcess(size_t slot) const {
+  struct flock fl;
+  std::memset(&fl, 0, sizeof(fl));
+  fl.l_type = F_WRLCK;
+  fl.l_whence = SEEK_SET;
+  fl.l_start = SlotOffset(slot);
+  fl.l_len = 1;
+  if (fcntl(fd_, F_GETLK, &fl) == -1)
+    return true;
+  return fl.l_type != F_UNLCK;
+}
+
+bool LockTable::IsLockedByOtherOwner(const std::string& path,
+                                     const void* owner) const {
+  auto is_other = [owner](auto& entry) { return entry.second.owner != owner; };
+  // The path and its ancestors
+  for (auto len = path.size(); len != std::string::npos && len > 0;
+       len = path.rfind('/', len - 1)) {
+    auto range = entries_.equal_range(path.substr(0, len));
+    if (std::any_of(range.first, range.second, is_other))
+      return true;
+  }
+  // The descendants are sorted right after "path/"
+  for (auto itr = entries_.lower_bound(path + '/');
+       itr != entries_.cend() && IsConflicting(path, itr->first); ++ itr)
+    if (is_other(*itr))
+      return true;
+  return false;
+}
+
+bool LockTable::Lock(const std::string& path, const void* owner) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (IsLockedByOtherOwner(path, owner))
+    return false;
+
+  if (!LockRange(F_SETLKW, F_WRLCK, 0, 1))
+    return false;
+  struct stat st;
+  size_t num_slots = 0;
+  if (fstat(fd_, &st) == 0 && static_cast<size_t>(st.st_size) > kSlotSize)
+    num_slots = (st.st_size - kSlotSize) / kSlotSize;
+  auto entry_data = EncodeEntry(path);
+  auto entry_slots = entry_data.size() / kSlotSize;
+  // The first free range long enough, possibly extending the table
+  size_t free_slot = 0;
+  size_t free_len = 0;
+  auto found = false;
+  auto result = true;
+  std::vector<char> buf;
+  std::string slot_path;
+  auto own_itr = own_slots_.cbegin();
+  for (size_t slot = 0; slot < num_slots && result;) {
+    if (own_itr != own_slots_.cend() && own_itr->first == slot) {
+      slot += own_itr->second;
+      ++ own_itr;
+      if (!found) {
+        free_slot = slot;
+        free_len = 0;
+      }
+      continue;
+    }
+    // The slots up to the next entry of this process
+    auto gap_end = own_itr != own_slots_.cend()
+        ? std::min(own_itr->first, num_slots) : num_slots;
+    buf.resize((gap_end - slot) * kSlotSize);
+    auto len = pread(fd_, buf.data(), buf.size(), SlotOffset(slot));
+    buf.resize(len > 0 ? (len / kSlotSize) * kSlotSize : 0);
+    auto gap_slots = buf.size() / kSlotSize;
+    if (gap_slots < gap_end - slot)
+      num_slots = slot + gap_slots;
+    for (size_t idx = 0; idx < gap_slots && result;) {
+      size_t used_slots = 0;
+      if (buf[idx * kSlotSize] == kHeadTag) {
+        used_slots = DecodeEntry(buf, idx, &slot_path);
+        // Only the conflicting entries need to be alive
+        if (used_slots > 0 && IsConflicting(path, slot_path)) {
+          if (IsSlotHeldByOtherProcess(slot + idx))
+            result = false;
+          else
+            used_slots = 0;
+        }
+      }
+      if (used_slots == 0) {
+        if (!found && ++ free_len == entry_slots)
+          found = true;
+        ++ idx;
+        continue;
+      }
+      idx += used_slots;
+      if (!found) {
+        free_slot = slot + idx;
+        free_len = 0;
+      }
+    }
+    slot += gap_slots;
+  }
+  if (result) {
+    result = pwrite(fd_, entry_data.data(), entry_data.size(),
+                    SlotOffset(free_slot))
+        == static_cast<ssize_t>(entry_data.size())
+        && LockRange(F_SETLK, F_WRLCK, SlotOffset(free_slot), 1);
+    if (result) {
+      entries_.emplace(path, Entry{owner, free_slot, entry_slots});
+      own_slots_[free_slot] = entry_slots;
+    }
+  }
+  LockRange(F_SETLK, F_UNLCK, 0, 1);
+  return result;
+}
+
+void LockTable::Unlock(const std::string& path, const void* owner) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto range = entries_.equal_range(path);
+  for (auto itr = range.first; itr != range.second; ++ itr) {
+    if (itr->second.owner != owner)
+      continue;
+    auto slot = itr->second.slot;
+    std::vector<char> empty(itr->second.num_slots * kSlotSize, kFreeTag);
+    entries_.erase(itr);
+    own_slots_.erase(slot);
+    LockRange(F_SETLKW, F_WRLCK, 0, 1);
+    pwrite(fd_, empty.data(), empty.size(), SlotOffset(slot));
+    LockRange(F_SETLK, F_UNLCK, SlotOffset(slot), 1);
+    LockRange(F_SETLK, F_UNLCK, 0, 1);
+    return;
+  }
+}
+
+void LockTable::ReclaimStaleEntries() {
+  if (!LockRange(F_SETLKW, F_WRLCK, 0, 1))
+    return;
+  struct stat st;
+  std::vector<char> buf;
+  if (fstat(fd_, &st) == 0 && static_cast<size_t>(st.st_size) > kSlotSize) {
+    buf.resize(st.st_size - kSlotSize);
+    auto len = pread(fd_, buf.data(), buf.size(), kSlotSize);
+    buf.resize(len > 0 ? (len / kSlotSize) * kSlotSize : 0);
+  }
+  // The continuation slots of a freed head are free as well
+  for (size_t slot = 0; slot < buf.size() / kSlotSize; ++ slot)
+    if (buf[slot * kSlotSize] == kHeadTag && !IsSlotHeldByOtherProcess(slot))
+      pwrite(fd_, &kFreeTag, 1, SlotOffset(slot));
+  LockRange(F_SETLK, F_UNLCK, 0, 1);
+}
+
+std::shared_ptr<LockTable> LockTable::Open(const FsPath& dir_path) {
+  auto file_path = (fs::absolute(dir_path) / kLockTableFileName).string();
+  std::lock_guard<std::mutex> lock(TablesMutex());
+  auto& tables = Tables();
+  auto itr = tables.find(file_path);
+  if (itr != tables.end()) {
+    auto table = itr->second.lock();
+    if (table)
+      return table;
+  }
+  auto fd = open(file_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+  if (fd < 0)
+    return nullptr;
+  auto table = std::shared_ptr<LockTable>(new LockTable(fd));
+  table->ReclaimStaleEntries();
+  tables[file_path] = table;
+  return table;
+}
+
+std::string LockTable::FileName() {
+  return kLockTableFileName;
+}
+
+}  // namespace detail
+
+}  // namespace core
+
+}  // namespace dino
@@ -0,0 +1,66 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "dino/core/fspath.h"
+
+namespace dino {
+
+namespace core {
+
+namespace detail {
+
+// Table of the locked object paths under one top level directory, stored
+// in a single file. Each entry takes one or more slots and is held by a
+// POSIX record lock on its first slot, so entries of crashed processes are
+// reused. A path conflicts with itself, its ancestors and its descendants.
+// Tables are shared in a process. The entries of the process are kept in
+// memory, and only the slots of the other processes are read from the
+// file.
+class LockTable {
+ public:
+  ~LockTable();
+  LockTable(const LockTable&) = delete;
+  LockTable& operator=(const LockTable&) = delete;
+
+  // Returns false if a conflicting path is locked by another owner
+  bool Lock(const std::string& path, const void* owner);
+  void Unlock(const std::string& path, const void* owner);
+
+  // Returns nullptr if the table file can't be opened
+  static std::shared_ptr<LockTable> Open(const FsPath& dir_path);
+  static std::string FileName();
+
+ private:
+  explicit LockTable(int fd);
+
+  struct Entry {
+    const void* owner;
+    size_t slot;
+    size_t num_slots;
+  };
+
+  bool LockRange(int cmd, short type, off_t start, off_t len) const;
+  bool IsSlotHeldByOtherProcess(size_t slot) const;
+  bool IsLockedByOtherOwner(const std::string& path, const void* owner) const;
+  // Frees the entries left by the processes that have exited
+  void ReclaimStaleEntries();
+
+  int fd_;
+  std::mutex mutex_;
+  std::multimap<std::string, Entry> entries_;
+  // First slot to the number of slots of the entries in entries_
+  std::map<size_t, size_t> own_slots_;
+};
+
+}  // namespace detail
+
+}  // namespace core
+
+}  // namespace dino
@@ -0,0 +1,49 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#include "dino/core/detail/memorydatasource.h"
+
+namespace dino {
+
+namespace core {
+
+namespace detail {
+
+void MemoryDataSource::ReadValues(DCompactValueDict* values) const {
+  *values = values_;
+}
+
+void MemoryDataSource::ReadAttrs(DValueDict* attrs) const {
+  *attrs = attrs_;
+}
+
+std::vector<DObjInfo> MemoryDataSource::ChildInfoList() const {
+  return child_info_list_;
+}
+
+LazyDataSourcePtr MemoryDataSource::Child(size_t index) const {
+  return children_.at(index);
+}
+
+LazyDataSourcePtr MemoryDataSource::Load(DataIO* io,
+                                         const FsPath& file_path) {
+  auto source = std::make_shared<MemoryDataSource>();
+  io->Load(file_path, source->CreateReadDataArg());
+  return source;
+}
+
+ReadDataArgPtr MemoryDataSource::CreateReadDataArg() {
+  CreateChildFunc f = [this](const DObjInfo& obj_info) {
+    auto child = std::make_shared<MemoryDataSource>();
+    child_info_list_.emplace_back(obj_info);
+    children_.emplace_back(child);
+    return child->CreateReadDataArg();
+  };
+  return std::make_shared<ReadDataArg>(&values_, &attrs_, f);
+}
+
+}  // namespace detail
+
+}  // namespace core
+
+}  // namespace dino
@@ -0,0 +1,43 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "dino/core/fspath.h"
+#include "dino/core/detail/dataio.h"
+
+namespace dino {
+
+namespace core {
+
+namespace detail {
+
+// Data file fully decoded into memory. Loading doesn't touch any object
+// data, so files can be parsed apart from the thread owning the session.
+class MemoryDataSource : public LazyDataSource {
+ public:
+  MemoryDataSource() = default;
+  virtual void ReadValues(DCompactValueDict* values) const override;
+  virtual void ReadAttrs(DValueDict* attrs) const override;
+  virtual std::vector<DObjInfo> ChildInfoList() const override;
+  virtual LazyDataSourcePtr Child(size_t index) const override;
+
+  static LazyDataSourcePtr Load(DataIO* io, const FsPath& file_path);
+
+ private:
+  ReadDataArgPtr CreateReadDataArg();
+
+  DCompactValueDict values_;
+  DValueDict attrs_;
+  std::vector<DObjInfo> child_info_list_;
+  std::vector<std::shared_ptr<MemoryDataSource>> children_;
+};
+
+}  // namespace detail
+
+}  // namespace core
+
+}  // namespace dino
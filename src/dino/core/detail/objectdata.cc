@@ -3,20 +3,26 @@
 
 #include "dino/core/detail/objectdata.h"
 
+#include <sys/stat.h>
 #include <fstream>
-#include <unordered_set>
+#include <mutex>
 #include <boost/lexical_cast.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/range/iterator_range.hpp>
+#include <boost/range/adaptor/reversed.hpp>
 
 #include "dino/core/session.h"
 #include "dino/core/dobject.h"
 #include "dino/core/dexception.h"
-#include "dino/core/currentuser.h"
 #include "dino/core/commandstack.h"
 #include "dino/core/objectfactory.h"
+#include "dino/core/detail/childmanifest.h"
 #include "dino/core/detail/dataiofactory.h"
+#include "dino/core/detail/dobjinfolist.h"
+#include "dino/core/detail/listenerrouter.h"
+#include "dino/core/detail/memorydatasource.h"
 #include "dino/core/detail/objectdataexception.h"
+#include "dino/core/detail/workerpool.h"
 
 #define THROW1(code, info)                        \
   BOOST_THROW_EXCEPTION(ObjectDataException(code) \
@@ -42,6 +48,9 @@ namespace {
 
 const std::string kDataSectionName = "data";
 const char* kLockFileSuffix = ".lock";
+// Directories of detached children under the top level directory. Not
+// a valid object name, so it's never taken as a child.
+const char* kTrashDirName = ".dino_trash";
 const unsigned int k_edit_type_mask =
     static_cast<unsigned int>(CommandType::kEditTypeMask);
 const unsigned int k_command_group_mask =
@@ -49,14 +58,55 @@ const unsigned int k_command_group_mask =
     | static_cast<unsigned int>(CommandType::kBaseObjectUpdateType)
     | static_cast<unsigned int>(CommandType::kChildListUpdateType);
 
+// Generation of the values and the base list of an object, shared with the
+// resolved key caches of the derived objects. Bumped whenever a cached value
+// pointer may become dangling (a value is erased, values are reloaded, the
+// base list changes or the object is destroyed).
+using KeyGenerationSp = std::shared_ptr<size_t>;
+using KeyGenerationList = std::vector<std::pair<KeyGenerationSp, size_t>>;
+
+bool IsUpToDate(const KeyGenerationList& generations) {
+  for (auto& generation : generations)
+    if (*generation.first != generation.second)
+      return false;
+  return true;
+}
+
+// Identifies a version of a file. A data file is replaced on each save, so
+// the inode differs even if the time and the size don't.
+struct FileStamp {
+  uint64_t inode = 0;
+  uint64_t mtime = 0;
+  uint64_t size = 0;
+  bool operator==(const FileStamp& rhs) const {
+    return inode == rhs.inode && mtime == rhs.mtime && size == rhs.size;
+  }
+};
+
+FileStamp GetFileStamp(const FsPath& file_path) {
+  FileStamp stamp;
+  struct stat st;
+  if (::stat(file_path.string().c_str(), &st) != 0)
+    return stamp;
+  stamp.inode = static_cast<uint64_t>(st.st_ino);
+  stamp.mtime = static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000
+      + static_cast<uint64_t>(st.st_mtim.tv_nsec);
+  stamp.size = static_cast<uint64_t>(st.st_size);
+  return stamp;
+}
+
+const unsigned int kLocalKeyFlag = 1;
+const unsigned int kInheritedKeyFlag = 2;
+const unsigned int kAnyKeyFlags = kLocalKeyFlag | kInheritedKeyFlag;
+
 class BaseObjInfo {
  public:
   BaseObjInfo() = default;
   BaseObjInfo(const DObjPath& p,
               const DObjectSp& o)
       : path_(p), obj_(o) {}
-  std::string Name() const { return path_.LeafName(); }
-  DObjPath Path() const { return path_; }
+  const std::string& Name() const { return path_.LeafName(); }
+  const DObjPath& Path() const { return path_; }
   DObjectSp Obj() const { return obj_; }
   void SetObj(const DObjectSp& o) { obj_ = o; }
   std::vector<boost::signals2::connection>& Connections() {
@@ -87,6 +137,8 @@ void CleanUpObjectDirectory(const fs::path& dir_path) {
     if (fs::is_directory(child)) {
       CleanUpObjectDirectory(child);
       Remove(child);
+    } else if (ChildManifest::IsManifestFile(child)) {
+      Remove(child);
     } else {
       auto info = DataIOFactory::GetDataFileInfo(child.string());
       if (info.IsValid())
@@ -141,27 +193,21 @@ void RestoreBaseFromDict(DValueDict& attrs,
   attrs.erase(kBaseObjCountKey);
 }
 
-template<typename T, typename F>
-T ExecInObjWithKey(std::vector<BaseObjInfo*>& base_info_list,
-                   const F& func_info) {
-  for (auto& base_info : base_info_list) {
-    if (base_info->Obj()->HasKey(func_info.key))
-      return func_info.then(*base_info);
-  }
-  return func_info.else_();
+void SortDObjInfoList(DObjInfoList& obj_list,
+                      const DObjCompareFunc& comp,
+                      bool enable_sorting) {
+  if (enable_sorting)
+    obj_list.Sort(comp);
 }
 
-using DObjCompareFunc = std::function<
-  bool (const DObjInfo& lhs, const DObjInfo& rhs)>;
-
-void SortDObjInfoVector(std::vector<DObjInfo>& obj_list,
-                        const DObjCompareFunc& comp,
-                        bool enable_sorting) {
+void AddToDObjInfoList(DObjInfoList& obj_list,
+                       const DObjInfo& obj_info,
+                       const DObjCompareFunc& comp,
+                       bool enable_sorting) {
   if (enable_sorting)
-    std::sort(obj_list.begin(),
-              obj_list.end(),
-              [&comp](const auto& lhs, const auto& rhs) {
-                return comp(lhs, rhs); });
+    obj_list.Insert(obj_info, comp);
+  else
+    obj_list.Append(obj_info);
 }
 
 template<typename T>
@@ -228,7 +274,44 @@ class FindObjInfo<BaseObjInfo*> {
 
 using FindBaseObj = FindObjInfo<BaseObjInfo>;
 using FindBaseObjPtr = FindObjInfo<BaseObjInfo*>;
-using FindDObjInfo = FindObjInfo<DObjInfo>;
+
+// Errors reported from the threads writing data files
+class SaveErrorList {
+ public:
+  using Entry = std::pair<ObjectData*, std::string>;
+
+  void Add(ObjectData* data, const std::string& message) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.emplace_back(data, message);
+  }
+  bool Empty() const {
+    return entries_.empty();
+  }
+  const std::vector<Entry>& Entries() const {
+    return entries_;
+  }
+  std::string Message() const {
+    std::string message;
+    for (auto& entry : entries_) {
+      if (!message.empty())
+        message += ", ";
+      message += entry.first->Path().String() + ": " + entry.second;
+    }
+    return message;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<Entry> entries_;
+};
+
+struct SaveContext {
+  SaveContext(const SaveOptions& options) : options(options) {}
+  const SaveOptions& options;
+  WorkerPool* pool = nullptr;
+  SaveErrorList* errors = nullptr;
+  SaveStats stats;
+};
 
 }  // namespace
 
@@ -247,19 +330,30 @@ class ObjectData::Impl {
        const FsPath& dir_path,
        const DObjPath& obj_path,
        const std::string& type,
+       FileFormat file_format,
        ObjectData* parent,
        Session* owner);
   ~Impl();
 
   bool HasKey(const std::string& key) const;
+  const DCompactValue* ResolveKey(const std::string& key,
+                                  const ObjectData** where) const;
+  // Adds the generations of the objects from this to where
+  const DCompactValue* ResolveKey(const std::string& key,
+                                  const ObjectData** where,
+                                  KeyGenerationList* generations) const;
+  void InvalidateResolvedKeys() { ++ *key_generation_; }
   DValue Get(const std::string& key, const DValue& default_value) const;
   DValue Get(const std::string& key) const;
   void Put(const std::string& key, const DValue& value);
+  void PutMany(const DValueDict& values);
   void RemoveKey(const std::string& key);
+  void RemoveKeys(const std::vector<std::string>& keys);
   bool IsLocalKey(const std::string& key) const;
   bool HasNonLocalKey(const std::string& key) const;
   DObjPath WhereIsKey(const std::string& key) const;
   std::vector<std::string> Keys(bool local_only) const;
+  DKeyRange KeyRange(bool local_only) const;
 
   bool HasAttr(const std::string& key) const;
   std::string Attr(const std::string& key) const;
@@ -284,6 +378,12 @@ class ObjectData::Impl {
   bool IsChildOpened(const std::string& name) const;
   DObjInfo ChildInfo(const std::string& name) const;
   std::vector<DObjInfo> Children() const;
+  const DObjInfo& ChildAt(size_t index) const;
+  size_t ChildIndex(const std::string& name) const;
+  void ForEachChild(const std::function<void (const DObjInfo&)>& func) const;
+  void ForEachListedChild(
+      const std::function<void (const DObjInfo&)>& func) const;
+  size_t ChildrenGeneration() const;
   size_t ChildCount() const;
   bool IsFlattened() const;
   bool IsChildFlat(const std::string& name) const;
@@ -328,12 +428,27 @@ class ObjectData::Impl {
 
   boost::signals2::connection AddListener(
       const ObjectListenerFunc& listener, ListenerCallPoint call_point);
+  boost::signals2::connection AddListener(
+      const ObjectListenerFunc& listener,
+      const ListenerFilter& filter,
+      ListenerCallPoint call_point);
+  boost::signals2::connection AddSummaryListener(
+      const SummaryListenerFunc& listener);
   void DisableSignal();
   void EnableSignal();
+  void EmitPendingSummary();
 
   void Load();
-  void Save(bool recurse);
+  void LoadFromSource(const LazyDataSourcePtr& source);
+  DataSp LoadFlattenedChild(const std::string& name);
+  void MarkDirtyDescendant();
+  // Empty if the child manifest isn't used
+  FsPath ManifestDirPath() const;
+  SaveStats Save(bool recurse, const SaveOptions& options);
   void RefreshChildren();
+  void AddChildFromDirectory(const std::string& name, const std::string& type);
+  void RemoveChildFromDirectory(const std::string& name);
+  void ReloadValues();
   void SortChildren();
   ObjectData* FindTop() const;
 
@@ -363,27 +478,51 @@ class ObjectData::Impl {
                        const DValue& prev_value);
   void ExecRemoveValue(const std::string& key, const DValue& prev_value);
   void ExecAddValue(const std::string& key, const DValue& new_value);
+  DetachedChildSp ExecDetachChild(const std::string& name);
+  bool IsDetached() const { return detached_; }
+  void ExecAttachChild(const DetachedChildSp& detached);
+  void ExecUpdateValues(const std::vector<std::string>& keys,
+                        const DValueDict& new_values,
+                        const DValueDict& prev_values);
   void ExecDeleteChild(const std::string& name);
   void ExecAddBase(const DObjectSp& base);
   void ExecRemoveBase(const DObjectSp& base);
 
   Session* Owner() const { return owner_; }
+  uintptr_t ObjectId() const { return object_id_; }
+  void SetObjectId(uintptr_t object_id) { object_id_ = object_id; }
   void EmitSignal(const Command& cmd, ListenerCallPoint call_point);
+  void EmitSummary(const Command& cmd);
 
   void InitCompareFunc();
 
  private:
   void Save(const std::unique_ptr<DataIO>& data_io);
+  void SaveTree(bool recurse, SaveContext& context);
+  void WriteDataFile(SaveContext& context);
   bool InitDirPathImpl(const FsPath& dir_path);
   bool CreateEmpty(const FsPath& dir_path);
   void RemoveLockFile();
   void CreateLockFile();
+  void LockObject();
+  bool UnlockObject();
   ObjectData* ChildData(const std::string& name,
                         bool open_if_not_opened) const;
   void RefreshActualChildren();
+  void DiscoverChildren() const;
   void RefreshChildrenInBase() const;
+  std::vector<ChildManifest::Entry> ManifestEntries(
+      const DObjInfoList& children) const;
   void ProcessBaseObjectUpdate(
       const Command& cmd, ListenerCallPoint call_point);
+  const DKeySourceMap& KeySources() const;
+  const DCompactValueDict& Values() const;
+  DCompactValueDict& MutableValues();
+  void SetLocalValue(const std::string& key, const DValue& value);
+  bool IsLazyChildPending(const std::string& name) const;
+  void AddInheritedKeys(const DObjectSp& base);
+  void RecheckInheritedKey(const std::string& key);
+  void RecheckInheritedKeys(const DObjectSp& base);
 
   CreateChildFunc GenCreateChildFunc(
       ObjectData* parent, std::vector<DataSp>* descendants);
@@ -397,28 +536,59 @@ class ObjectData::Impl {
   std::string type_;
   std::string data_file_name_;
   Session* owner_ = nullptr;
+  uintptr_t object_id_ = 0;
+
+  struct ResolvedKey {
+    const ObjectData* data;
+    const DCompactValue* value;
+    KeyGenerationList generations;
+  };
 
-  DValueDict values_;
+  mutable DCompactValueDict values_;
+  mutable LazyDataSourcePtr lazy_values_;
+  std::unordered_map<std::string, LazyDataSourcePtr> lazy_children_;
+  mutable std::unordered_map<std::string, ResolvedKey> resolved_keys_;
+  KeyGenerationSp key_generation_ = std::make_shared<size_t>(0);
+  mutable DKeySourceMap key_sources_;
+  mutable bool key_sources_valid_ = false;
+  // Generations of the objects in the base chains when key_sources_ was
+  // built
+  mutable KeyGenerationList key_sources_generations_;
   DValueDict attrs_;
   DValueDict temp_attrs_;
 
-  mutable std::vector<DObjInfo> actual_children_;
-  mutable std::vector<DObjInfo> children_;
+  mutable DObjInfoList actual_children_;
+  mutable DObjInfoList children_;
+  // Child directories are scanned on the first access to the child list
+  mutable bool children_discovered_ = true;
 
   mutable std::vector<BaseObjInfo> base_info_list_;
   mutable std::vector<BaseObjInfo> base_info_from_parent_list_;
   mutable std::vector<BaseObjInfo*> effective_base_info_list_;
   std::unordered_map<std::string, bool> child_flat_flags_;
   std::unique_ptr<boost::interprocess::file_lock> lock_file_;
+  bool lock_acquired_ = false;  // by the lock manager of the session
   std::array<boost::signals2::signal<void (const Command&)>,
              static_cast<unsigned int>(ListenerCallPoint::kNumCallPoint)> sig_;
+  std::array<ListenerRouter,
+             static_cast<unsigned int>(ListenerCallPoint::kNumCallPoint)>
+  routers_;
+  boost::signals2::signal<void (const ChangeSummary&)> summary_sig_;
+  // Changes collected while the session defers notifications
+  std::unique_ptr<ChangeSummary> pending_summary_;
   CommandStackSp command_stack_;
   CommandExecuterSp default_command_executer_;
   FileFormat file_format_ = FileFormat::kJson;
   int editable_ref_count_ = 0;
   int ref_count_ = 0;
   bool dirty_ = false;
+  // Data file written by the last save of this session
+  FileStamp saved_stamp_;
+  // Some opened descendant may have been changed after the last save
+  bool dirty_descendant_ = false;
   bool signal_enabled_ = true;
+  // Removed from the session by ExecDetachChild
+  bool detached_ = false;
   bool is_actual_ = false;
   DObjPath add_child_top_;
   DObjCompareFunc compare_func_;
@@ -439,6 +609,8 @@ ObjectData::Impl::Impl(ObjectData* self,
     default_command_executer_(new CommandExecuter(owner, self)),
     is_actual_(is_actual), enable_sorting_(enable_sorting) {
   InitCompareFunc();
+  file_format_ = parent ? parent->impl_->file_format_
+                        : owner->DefaultFileFormat();
   if (parent) {
     if (parent->IsFlattened())
       is_flattened = true;
@@ -446,7 +618,7 @@ ObjectData::Impl::Impl(ObjectData* self,
     if (!is_flattened && !parent_dir_path.empty()) {
       if (init_directory)
         InitDirPath(parent_dir_path / obj_path_.LeafName());
-      RefreshActualChildren();
+      children_discovered_ = dir_path_.empty();
     }
   }
 }
@@ -455,145 +627,279 @@ ObjectData::Impl::Impl(ObjectData* self,
                        const FsPath& dir_path,
                        const DObjPath& obj_path,
                        const std::string& type,
+                       FileFormat file_format,
                        ObjectData* parent,
                        Session* owner) :
     self_(self), parent_(parent), obj_path_(obj_path),
     dir_path_(dir_path), type_(type), owner_(owner),
-    default_command_executer_(new CommandExecuter(owner, self)) {
+    default_command_executer_(new CommandExecuter(owner, self)),
+    file_format_(file_format) {
   InitCompareFunc();
   data_file_name_ = DataIOFactory::DataFileName(type_, file_format_);
-  RefreshActualChildren();
+  children_discovered_ = false;
 }
     
 ObjectData::Impl::~Impl() {
-  RemoveLockFile();
+  InvalidateResolvedKeys();
+  UnlockObject();
   for (auto& base_info : effective_base_info_list_)
     for (auto& connection : base_info->Connections())
       connection.disconnect();
 }
 
-struct HasKeyFuncInfo {
-  HasKeyFuncInfo(const std::string& k, Session* o) : key(k), owner(o) {}
-  std::string key;
-  Session* owner;
-  bool then(const BaseObjInfo&) const { return true; }
-  bool else_() const { return false; }
-};
-
 bool ObjectData::Impl::HasKey(const std::string& key) const {
-  if (IsLocalKey(key))
-    return true;
+  const ObjectData* where = nullptr;
+  return ResolveKey(key, &where) != nullptr;
+}
+
+const DCompactValue* ObjectData::Impl::ResolveKey(
+    const std::string& key, const ObjectData** where) const {
+  return ResolveKey(key, where, nullptr);
+}
+
+const DCompactValue* ObjectData::Impl::ResolveKey(
+    const std::string& key, const ObjectData** where,
+    KeyGenerationList* generations) const {
+  auto& values = Values();
+  auto itr = values.find(key);
+  if (itr != values.cend()) {
+    *where = self_;
+    if (generations)
+      generations->emplace_back(key_generation_, *key_generation_);
+    return &itr->second;
+  }
+  auto cache_itr = resolved_keys_.find(key);
+  if (cache_itr != resolved_keys_.cend()) {
+    auto& resolved = cache_itr->second;
+    if (IsUpToDate(resolved.generations)) {
+      *where = resolved.data;
+      if (generations)
+        generations->insert(generations->end(),
+                            resolved.generations.cbegin(),
+                            resolved.generations.cend());
+      return resolved.value;
+    }
+    resolved_keys_.erase(cache_itr);
+  }
   InstanciateBases();
-  return ExecInObjWithKey<bool>(
-      effective_base_info_list_, HasKeyFuncInfo(key, owner_));
-}
-
-struct GetWithDefaultFuncInfo {
-  GetWithDefaultFuncInfo(
-      const std::string& k, const DValue& def_value, Session* o)
-      : key(k), default_value(def_value), owner(o) {}
-  std::string key;
-  DValue default_value;
-  Session* owner;
-  DValue then(const BaseObjInfo& info) const { return info.Obj()->Get(key); }
-  DValue else_() const { return default_value; }
-};
+  for (auto& base_info : effective_base_info_list_) {
+    KeyGenerationList base_generations{{key_generation_, *key_generation_}};
+    auto value = base_info->Obj()->GetData()->impl_->ResolveKey(
+        key, where, &base_generations);
+    if (value) {
+      if (generations)
+        generations->insert(generations->end(),
+                            base_generations.cbegin(),
+                            base_generations.cend());
+      resolved_keys_.emplace(
+          key, ResolvedKey{*where, value, std::move(base_generations)});
+      return value;
+    }
+  }
+  return nullptr;
+}
 
 DValue ObjectData::Impl::Get(const std::string& key,
                              const DValue& default_value) const {
-  auto itr = values_.find(key);
-  if (itr != values_.cend())
-    return itr->second;
-  InstanciateBases();
-  return ExecInObjWithKey<DValue>(
-      effective_base_info_list_,
-      GetWithDefaultFuncInfo(key, default_value, owner_));
-}
-
-struct GetFuncInfo {
-  GetFuncInfo(const std::string& k, const DObjPath& p, Session* o)
-      : key(k), path(p), owner(o) {}
-  std::string key;
-  DObjPath path;
-  Session* owner;
-  DValue then(const BaseObjInfo& info) const { return info.Obj()->Get(key); }
-  DValue else_() const { THROW2(kErrNoKey, path.String(), key); }
-};
+  const ObjectData* where = nullptr;
+  auto value = ResolveKey(key, &where);
+  if (!value)
+    return default_value;
+  return value->ToDValue();
+}
 
 DValue ObjectData::Impl::Get(const std::string& key) const {
-  auto itr = values_.find(key);
-  if (itr != values_.cend())
-    return itr->second;
-  InstanciateBases();
-  return ExecInObjWithKey<DValue>(
-      effective_base_info_list_, GetFuncInfo(key, Path(), owner_));
+  const ObjectData* where = nullptr;
+  auto value = ResolveKey(key, &where);
+  if (!value)
+    THROW2(kErrNoKey, Path().String(), key);
+  return value->ToDValue();
 }
 
 void ObjectData::Impl::Put(const std::string& key, const DValue& value) {
-  auto itr = values_.find(key);
+  auto& values = Values();
+  auto itr = values.find(key);
   auto edit_type = CommandType::kUnknown;
   auto prev_value = DValue(nil);
-  if (itr == values_.cend()) {
+  if (itr == values.cend()) {
     edit_type = CommandType::kAdd;
-  } else if (itr->second != value) {
-    prev_value = values_[key];
-    if (prev_value != value)
-      edit_type = CommandType::kUpdate;
+  } else if (!itr->second.Equals(value)) {
+    prev_value = itr->second.ToDValue();
+    edit_type = CommandType::kUpdate;
   }
   if (edit_type != CommandType::kUnknown)
     Executer()->UpdateValue(edit_type, self_, key, value, prev_value);
 }
 
+void ObjectData::Impl::PutMany(const DValueDict& values) {
+  auto& cur_values = Values();
+  std::vector<std::string> keys;
+  DValueDict new_values;
+  DValueDict prev_values;
+  for (auto& kv : values) {
+    auto itr = cur_values.find(kv.first);
+    if (itr != cur_values.cend()) {
+      if (itr->second.Equals(kv.second))
+        continue;
+      prev_values[kv.first] = itr->second.ToDValue();
+    }
+    keys.push_back(kv.first);
+    new_values[kv.first] = kv.second;
+  }
+  if (keys.empty())
+    return;
+  std::sort(keys.begin(), keys.end());
+  Executer()->UpdateValues(self_, keys, new_values, prev_values);
+}
+
 void ObjectData::Impl::RemoveKey(const std::string& key) {
-  auto itr = values_.find(key);
-  if (itr == values_.cend())
+  auto& values = Values();
+  auto itr = values.find(key);
+  if (itr == values.cend())
     THROW2(kErrNoKey, Path().String(), key);
-  Executer()->UpdateValue(CommandType::kDelete, self_, key, nil, itr->second);
+  Executer()->UpdateValue(
+      CommandType::kDelete, self_, key, nil, itr->second.ToDValue());
+}
+
+void ObjectData::Impl::RemoveKeys(const std::vector<std::string>& keys) {
+  auto& values = Values();
+  std::vector<std::string> removed_keys;
+  DValueDict prev_values;
+  for (auto& key : keys) {
+    auto itr = values.find(key);
+    if (itr == values.cend())
+      THROW2(kErrNoKey, Path().String(), key);
+    if (prev_values.emplace(key, itr->second.ToDValue()).second)
+      removed_keys.push_back(key);
+  }
+  if (removed_keys.empty())
+    return;
+  std::sort(removed_keys.begin(), removed_keys.end());
+  Executer()->UpdateValues(self_, removed_keys, DValueDict(), prev_values);
 }
 
 bool ObjectData::Impl::IsLocalKey(const std::string& key) const {
-  return values_.find(key) != values_.cend();
+  auto& values = Values();
+  return values.find(key) != values.cend();
 }
 
 bool ObjectData::Impl::HasNonLocalKey(const std::string& key) const {
-  std::unordered_set<std::string> keys;
-  for (auto& base : EffectiveBases())
-    for (auto& key : base->Keys(false))
-      keys.insert(key);
-  return keys.find(key) != keys.end();
-}
-
-struct WhereFuncInfo {
-  WhereFuncInfo(const std::string& k, const DObjPath& p, Session* o)
-      : key(k), path(p), owner(o) {}
-  std::string key;
-  DObjPath path;
-  Session* owner;
-  DObjPath then(const BaseObjInfo& info) const { return info.Obj()->WhereIsKey(key); }
-  DObjPath else_() const { THROW2(kErrNoKey, path.String(), key); }
-};
+  auto& key_sources = KeySources();
+  auto itr = key_sources.find(key);
+  return itr != key_sources.cend() && (itr->second & kInheritedKeyFlag);
+}
 
 DObjPath ObjectData::Impl::WhereIsKey(const std::string& key) const {
-  if (IsLocalKey(key))
-    return Path();
-  InstanciateBases();
-  return ExecInObjWithKey<DObjPath>(
-      effective_base_info_list_, WhereFuncInfo(key, Path(), owner_));
+  const ObjectData* where = nullptr;
+  if (!ResolveKey(key, &where))
+    THROW2(kErrNoKey, Path().String(), key);
+  return where->Path();
 }
 
 std::vector<std::string> ObjectData::Impl::Keys(bool local_only) const {
-  std::unordered_set<std::string> keys;
-  for (auto& kv : values_)
-    keys.insert(kv.first);
-  if (!local_only)
-    for (auto& base : EffectiveBases())
-      for (auto& key : base->Keys(false))
-        keys.insert(key);
-  std::vector<std::string> result;
-  result.reserve(keys.size());
-  std::copy(keys.begin(), keys.end(), std::back_inserter(result));
-  std::sort(result.begin(), result.end());
-  return result;
+  auto range = KeyRange(local_only);
+  return std::vector<std::string>(range.begin(), range.end());
+}
+
+DKeyRange ObjectData::Impl::KeyRange(bool local_only) const {
+  auto& key_sources = KeySources();
+  auto mask = local_only ? kLocalKeyFlag : kAnyKeyFlags;
+  return DKeyRange(
+      DKeyIterator(key_sources.cbegin(), key_sources.cend(), mask),
+      DKeyIterator(key_sources.cend(), key_sources.cend(), mask));
+}
+
+const DKeySourceMap& ObjectData::Impl::KeySources() const {
+  InstanciateBases();
+  if (key_sources_valid_ && IsUpToDate(key_sources_generations_))
+    return key_sources_;
+  key_sources_.clear();
+  key_sources_generations_.clear();
+  for (auto& kv : Values())
+    key_sources_[kv.first] = kLocalKeyFlag;
+  for (auto& base_info : effective_base_info_list_) {
+    auto base_impl = base_info->Obj()->GetData()->impl_.get();
+    for (auto& key : base_impl->KeyRange(false))
+      key_sources_[key] |= kInheritedKeyFlag;
+    key_sources_generations_.emplace_back(
+        base_impl->key_generation_, *base_impl->key_generation_);
+    key_sources_generations_.insert(
+        key_sources_generations_.end(),
+        base_impl->key_sources_generations_.cbegin(),
+        base_impl->key_sources_generations_.cend());
+  }
+  key_sources_valid_ = true;
+  return key_sources_;
+}
+
+const DCompactValueDict& ObjectData::Impl::Values() const {
+  if (lazy_values_) {
+    auto source = std::move(lazy_values_);
+    lazy_values_.reset();
+    source->ReadValues(&values_);
+  }
+  return values_;
+}
+
+DCompactValueDict& ObjectData::Impl::MutableValues() {
+  Values();
+  return values_;
+}
+
+void ObjectData::Impl::SetLocalValue(const std::string& key,
+                                     const DValue& value) {
+  auto& values = MutableValues();
+  auto itr = values.find(key);
+  if (itr != values.end()) {
+    itr->second = DCompactValue(value);
+    return;
+  }
+  values.emplace(key, DCompactValue(value));
+  // The derived objects may have resolved the key in another base. They
+  // may not be notified, if the signal is disabled.
+  InvalidateResolvedKeys();
+}
+
+void ObjectData::Impl::AddInheritedKeys(const DObjectSp& base) {
+  if (!key_sources_valid_)
+    return;
+  for (auto& key : base->KeyRange())
+    key_sources_[key] |= kInheritedKeyFlag;
+}
+
+void ObjectData::Impl::RecheckInheritedKey(const std::string& key) {
+  InstanciateBases();
+  if (!key_sources_valid_)
+    return;
+  bool inherited = false;
+  for (auto& base_info : effective_base_info_list_) {
+    if (base_info->Obj()->HasKey(key)) {
+      inherited = true;
+      break;
+    }
+  }
+  auto itr = key_sources_.find(key);
+  if (inherited) {
+    if (itr == key_sources_.end())
+      key_sources_.emplace(key, kInheritedKeyFlag);
+    else
+      itr->second |= kInheritedKeyFlag;
+  } else if (itr != key_sources_.end()) {
+    itr->second &= ~kInheritedKeyFlag;
+    if (!itr->second)
+      key_sources_.erase(itr);
+  }
+}
+
+void ObjectData::Impl::RecheckInheritedKeys(const DObjectSp& base) {
+  if (!key_sources_valid_)
+    return;
+  if (!base || base->IsExpired()) {
+    key_sources_valid_ = false;
+    return;
+  }
+  for (auto& key : base->KeyRange())
+    RecheckInheritedKey(key);
 }
 
 bool ObjectData::Impl::HasAttr(const std::string& key) const {
@@ -715,61 +1021,99 @@ bool ObjectData::Impl::IsActual() const {
 void ObjectData::Impl::SetIsActual(bool state) {
   if (state != is_actual_ && parent_) {
     auto name = obj_path_.LeafName();
-    auto res = FindDObjInfo(parent_->impl_->children_).ByName(name);
-    res.Obj().SetIsActual(state);
-    auto& actual_children = parent_->impl_->actual_children_;
+    auto parent_impl = parent_->impl_.get();
+    parent_impl->DiscoverChildren();
+    auto child_info = parent_impl->children_.Find(name);
+    child_info->SetIsActual(state);
+    auto& actual_children = parent_impl->actual_children_;
     if (state) {
-      if (!parent_->HasActualChild(name)) {
-        actual_children.push_back(res.Obj());
-        SortDObjInfoVector(actual_children, compare_func_, enable_sorting_);
-      }
+      if (!actual_children.Has(name))
+        AddToDObjInfoList(actual_children, *child_info,
+                          parent_impl->compare_func_,
+                          parent_impl->enable_sorting_);
       is_actual_ = true;
-      parent_->impl_->SetIsActual(true);
+      parent_impl->SetIsActual(true);
     } else {
-      if (parent_->HasActualChild(name)) {
-        actual_children.erase(FindDObjInfo(actual_children).ByName(name).Itr(),
-                              actual_children.cend());
-      }
+      actual_children.Erase(name);
       is_actual_ = false;
     }
   }
 }
 
 bool ObjectData::Impl::HasChild(const std::string& name) const {
-  return FindDObjInfo(children_).ByName(name).Found();
+  if (!IsChildFlat(name))
+    DiscoverChildren();
+  return children_.Has(name);
 }
 
 bool ObjectData::Impl::HasActualChild(const std::string& name) const {
-  return FindDObjInfo(actual_children_).ByName(name).Found();
+  if (!IsChildFlat(name))
+    DiscoverChildren();
+  return actual_children_.Has(name);
 }
 
 bool ObjectData::Impl::IsActualChild(const std::string& name) const {
-  auto res = FindDObjInfo(children_).ByName(name);
-  if (!res.Found())
+  DiscoverChildren();
+  auto child_info = children_.Find(name);
+  if (!child_info)
     THROW2(kErrChildNotExist, name, Path().String());
-  return res.Obj().IsActual();
+  return child_info->IsActual();
 }
 
 bool ObjectData::Impl::IsChildOpened(const std::string& name) const {
-  auto res = FindDObjInfo(children_).ByName(name);
-  if (!res.Found())
+  if (!IsChildFlat(name))
+    DiscoverChildren();
+  auto child_info = children_.Find(name);
+  if (!child_info)
     return false;
-  return owner_->IsOpened(res.Obj().Path());
+  return owner_->IsOpened(child_info->Path());
 }
 
 DObjInfo ObjectData::Impl::ChildInfo(const std::string& name) const {
-  auto res = FindDObjInfo(children_).ByName(name);
-  if (!res.Found())
+  if (!IsChildFlat(name))
+    DiscoverChildren();
+  auto child_info = children_.Find(name);
+  if (!child_info)
     return DObjInfo();
-  return res.Obj();
+  return *child_info;
 }
 
 std::vector<DObjInfo> ObjectData::Impl::Children() const {
-  return children_;
+  DiscoverChildren();
+  return children_.ToVector();
+}
+
+const DObjInfo& ObjectData::Impl::ChildAt(size_t index) const {
+  DiscoverChildren();
+  return children_.At(index);
+}
+
+size_t ObjectData::Impl::ChildIndex(const std::string& name) const {
+  DiscoverChildren();
+  return children_.IndexOf(name);
+}
+
+void ObjectData::Impl::ForEachChild(
+    const std::function<void (const DObjInfo&)>& func) const {
+  DiscoverChildren();
+  for (auto& child_info : children_)
+    func(child_info);
+}
+
+void ObjectData::Impl::ForEachListedChild(
+    const std::function<void (const DObjInfo&)>& func) const {
+  for (auto& child_info : children_)
+    func(child_info);
+}
+
+size_t ObjectData::Impl::ChildrenGeneration() const {
+  DiscoverChildren();
+  return children_.Generation();
 }
 
 size_t ObjectData::Impl::ChildCount() const {
-  return children_.size();
+  DiscoverChildren();
+  return children_.Size();
 }
 
 bool ObjectData::Impl::IsFlattened() const {
@@ -794,7 +1138,7 @@ void ObjectData::Impl::SetChildFlat(const std::string& name, bool flag_only) {
       auto child_data = ChildData(name, true);
       auto dir_initialized = !child_data->impl_->dir_path_.empty();
       if (dir_initialized)
-        child_data->impl_->RemoveLockFile();
+        child_data->impl_->UnlockObject();
       for (auto grand_child_info : child_data->Children())
         child_data->SetChildFlat(grand_child_info.Name());
       if (dir_initialized) {
@@ -857,13 +1201,8 @@ DObjectSp ObjectData::Impl::GetObjectByPath(const DObjPath& obj_path,
 void ObjectData::Impl::AddChildInfo(const DObjInfo& child_info) {
   if (HasActualChild(child_info.Name()))
     THROW2(kErrChildDataAlreadyExists, child_info.Name(), Path().String());
-  actual_children_.emplace_back(child_info);
-  children_.erase(std::remove_if(children_.begin(), children_.end(),
-                                 [&child_info](auto& c) {
-                                   return c.Name() == child_info.Name(); }),
-                  children_.end());
-  children_.emplace_back(child_info);
-  SortChildren();
+  actual_children_.Append(child_info);
+  AddToDObjInfoList(children_, child_info, compare_func_, enable_sorting_);
 }
 
 void ObjectData::Impl::DeleteChild(const std::string& name) {
@@ -878,9 +1217,9 @@ void ObjectData::Impl::DeleteChild(const std::string& name) {
 void ObjectData::Impl::AcquireWriteLock() {
   if (!dir_path_.empty()) {
     auto data_file_path = DataFilePath();
-    if (!CurrentUser::Instance().IsWritable(data_file_path))
+    if (!owner_->IsDataFileWritable(data_file_path))
       THROW1(kErrNoWritePermission, data_file_path.string());
-    CreateLockFile();
+    LockObject();
   }
   editable_ref_count_ ++;
 }
@@ -890,7 +1229,27 @@ void ObjectData::Impl::ReleaseWriteLock() {
     return;
   editable_ref_count_ --;
   if (editable_ref_count_ == 0)
-    RemoveLockFile();
+    UnlockObject();
+}
+
+void ObjectData::Impl::LockObject() {
+  if (owner_->GetLockMode() == LockMode::kLockFile) {
+    CreateLockFile();
+    return;
+  }
+  if (lock_acquired_)
+    return;
+  if (!owner_->AcquireObjectLock(obj_path_, FindTop()->DirPath()))
+    THROW1(kErrFailedToGetFileLock, obj_path_.String());
+  lock_acquired_ = true;
+}
+
+bool ObjectData::Impl::UnlockObject() {
+  RemoveLockFile();
+  if (!lock_acquired_)
+    return true;
+  lock_acquired_ = false;
+  return owner_->ReleaseObjectLock(obj_path_);
 }
 
 void ObjectData::Impl::RemoveLockFile() {
@@ -903,9 +1262,10 @@ void ObjectData::Impl::RemoveLockFile() {
 
 void ObjectData::Impl::CreateLockFile() {
   auto lock_file_path = LockFilePath();
-  if (!fs::exists(lock_file_path))
+  if (!fs::exists(lock_file_path)) {
     if (!std::fstream(lock_file_path.c_str(), std::ios_base::out))
       THROW1(kErrNoWritePermission, lock_file_path.string());
+  }
 
   if (!lock_file_) 
     lock_file_ = std::make_unique<ipc::file_lock>(lock_file_path.c_str());
@@ -942,6 +1302,7 @@ bool ObjectData::Impl::InitDirPathImpl(const FsPath& dir_path) {
     }
   }
   if (!ObjectFactory::Instance().IsFlattenedObject(Type())) {
+    DiscoverChildren();
     for (auto& child_info : actual_children_) {
       if (IsChildFlat(child_info.Name()))
         continue;
@@ -962,7 +1323,7 @@ bool ObjectData::Impl::InitDirPathImpl(const FsPath& dir_path) {
   }
   if (editable_ref_count_ > 0) {
     try {
-      CreateLockFile();
+      LockObject();
     } catch (const DException&) {
       data_file_name_.clear();
       dir_path_.clear();
@@ -974,10 +1335,13 @@ bool ObjectData::Impl::InitDirPathImpl(const FsPath& dir_path) {
 
 void ObjectData::Impl::SetDirty(bool dirty) {
   dirty_ = dirty;
+  if (dirty && parent_)
+    parent_->impl_->MarkDirtyDescendant();
   if (!dirty)
     // reset dirty flag recursively for flattened children
     for (auto& child_info : actual_children_)
-      if (IsChildFlat(child_info.Name()))
+      if (IsChildFlat(child_info.Name())
+          && !IsLazyChildPending(child_info.Name()))
         OpenChild(child_info.Name(), OpenMode::kEditable)->SetDirty(false);
 }
 
@@ -985,7 +1349,8 @@ bool ObjectData::Impl::IsDirty() const {
   if (!dirty_)
     // If not dirty, check dirty flag recursively from flattened children
     for (auto& child_info : actual_children_)
-      if (IsChildFlat(child_info.Name()))
+      if (IsChildFlat(child_info.Name())
+          && !IsLazyChildPending(child_info.Name()))
         if (OpenChild(child_info.Name(), OpenMode::kReadOnly)->IsDirty())
           return true;
   return dirty_;
@@ -1046,6 +1411,7 @@ void ObjectData::Impl::AddBaseFromParent(const DObjectSp& base) {
     SetupListener(base, base_info);
   base_info_from_parent_list_.push_back(base_info);
   UpdateEffectiveBaseList();
+  AddInheritedKeys(base);
   RefreshChildrenInBase();
   AddBaseToChildren(base);
   SetDirty(true);
@@ -1084,8 +1450,10 @@ void ObjectData::Impl::RemoveBaseFromChildren(const DObjPath& base_path) {
     if (res.Found()) {
       for (auto& connection : res.Obj().Connections())
         connection.disconnect();
+      auto removed_base = res.Obj().Obj();
       base_list.erase(res.Itr());
       child_data->impl_->UpdateEffectiveBaseList();
+      child_data->impl_->RecheckInheritedKeys(removed_base);
       child_data->impl_->RefreshChildrenInBase();
     }
   }
@@ -1115,6 +1483,7 @@ void ObjectData::Impl::RemoveBaseFromParent(const DObjectSp& base) {
     connection.disconnect();
   base_info_from_parent_list_.erase(res.Itr(), base_info_from_parent_list_.end());
   UpdateEffectiveBaseList();
+  RecheckInheritedKeys(base);
   RefreshChildrenInBase();
   EmitSignal(cmd, ListenerCallPoint::kPost);
 }
@@ -1124,6 +1493,7 @@ bool ObjectData::Impl::HasObjectInBasesFromParent(const DObjPath& path) const {
 }
 
 void ObjectData::Impl::UpdateEffectiveBaseList() {
+  InvalidateResolvedKeys();
   effective_base_info_list_.clear();
   for (auto& base_info : base_info_list_)
     effective_base_info_list_.push_back(&base_info);
@@ -1143,7 +1513,9 @@ void ObjectData::Impl::InstanciateBases(
     if (!base_info.Obj() || base_info.Obj()->IsExpired()) {
       auto base = owner_->OpenObject(base_info.Path(), OpenMode::kReadOnly);
       base_info.SetObj(base);
+      key_sources_valid_ = false;
       SetupListener(base, base_info);
+      DiscoverChildren();
       for (auto& child_info : actual_children_) {
         if (!base->HasChild(child_info.Name()))
           continue;
@@ -1174,6 +1546,19 @@ boost::signals2::connection ObjectData::Impl::AddListener(
   return sig_[static_cast<unsigned int>(call_point)].connect(listener);
 }
 
+boost::signals2::connection ObjectData::Impl::AddListener(
+    const ObjectListenerFunc& listener,
+    const ListenerFilter& filter,
+    ListenerCallPoint call_point) {
+  return routers_[static_cast<unsigned int>(call_point)].Connect(
+      listener, filter);
+}
+
+boost::signals2::connection ObjectData::Impl::AddSummaryListener(
+    const SummaryListenerFunc& listener) {
+  return summary_sig_.connect(listener);
+}
+
 void ObjectData::Impl::DisableSignal() {
   signal_enabled_ = false;
 }
@@ -1182,20 +1567,46 @@ void ObjectData::Impl::EnableSignal() {
   signal_enabled_ = true;
 }
 
-void ObjectData::Impl::Save(bool recurse) {
+SaveStats ObjectData::Impl::Save(bool recurse, const SaveOptions& options) {
+  SaveContext context(options);
+  if (options.num_threads == 1) {
+    SaveTree(recurse, context);
+    return context.stats;
+  }
+  SaveErrorList errors;
+  context.errors = &errors;
+  {
+    WorkerPool pool(options.num_threads);
+    context.pool = &pool;
+    SaveTree(recurse, context);
+    pool.Wait();
+  }
+  if (errors.Empty())
+    return context.stats;
+  for (auto& error : errors.Entries())
+    error.first->SetDirty(true);
+  THROW2(kErrFailedToSaveObjects, errors.Entries().size(), errors.Message());
+}
+
+void ObjectData::Impl::SaveTree(bool recurse, SaveContext& context) {
   if (!IsActual())
     return;
+  auto is_stored = !dir_path_.empty();
+  auto skip_clean = context.options.skip_clean;
+  if (skip_clean && is_stored && !IsDirty()
+      && (!recurse || !dirty_descendant_)) {
+    ++ context.stats.num_skipped_subtrees;
+    return;
+  }
   if (dir_path_.empty() && parent_ && !IsFlattened()) {
     auto cur_obj = FindTop();
     auto cur_dir = cur_obj->DirPath();
-    auto remaining_path = obj_path_.Tail();
-    while (!remaining_path.Empty()) {
+    for (size_t depth = 2; depth <= obj_path_.Depth(); ++ depth) {
       if (cur_obj->DirPath().empty())
         break;
-      cur_obj = cur_obj->OpenChild(
-          remaining_path.TopName(), OpenMode::kReadOnly)->GetData();
-      cur_dir = cur_dir / remaining_path.TopName();
-      remaining_path = remaining_path.Tail();
+      auto name = obj_path_.AncestorAt(depth).LeafName();
+      cur_obj = cur_obj->OpenChild(name, OpenMode::kReadOnly)->GetData();
+      cur_dir = cur_dir / name;
       if (cur_obj->IsFlattened())
         break;
       if (!cur_obj->DirPath().empty())
@@ -1203,26 +1614,63 @@ void ObjectData::Impl::Save(bool recurse) {
       cur_obj->InitDirPath(cur_dir);
     }
   }
-  auto io = DataIOFactory::Instance().Create(file_format_);
-  auto file_path = DataFilePath();
-  io->OpenForWrite(file_path);
-  Save(io);
-  io->CloseForWrite();
+  if (!skip_clean || !is_stored || IsDirty()) {
+    WriteDataFile(context);
+    ++ context.stats.num_written;
+  } else {
+    ++ context.stats.num_clean;
+  }
   if (recurse) {
+    DiscoverChildren();
     for (auto& child_info : actual_children_) {
       if (IsChildOpened(child_info.Name()) && !IsChildFlat(child_info.Name())) {
         auto child = OpenChild(
             child_info.Name(), OpenMode::kReadOnly);
         child->SetEditable();
-        child->Save(recurse);
+        child->PreSaveHook();
+        child->GetData()->impl_->SaveTree(recurse, context);
       }
     }
+    dirty_descendant_ = false;
   }
 }
 
+void ObjectData::Impl::WriteDataFile(SaveContext& context) {
+  auto io = DataIOFactory::Instance().Create(file_format_);
+  auto file_path = DataFilePath();
+  if (context.pool)
+    io->DeferFileWrite();
+  io->OpenForWrite(file_path);
+  Save(io);
+  if (!context.pool) {
+    io->CloseForWrite();
+    saved_stamp_ = GetFileStamp(file_path);
+    return;
+  }
+  std::shared_ptr<DataIO> shared_io(std::move(io));
+  auto data = self_;
+  auto errors = context.errors;
+  context.pool->Post([shared_io, data, errors, file_path] {
+      try {
+        shared_io->CloseForWrite();
+        data->impl_->saved_stamp_ = GetFileStamp(file_path);
+      } catch (const DException& e) {
+        errors->Add(data, e.GetErrorMessage());
+      } catch (const std::exception& e) {
+        errors->Add(data, e.what());
+      }
+    });
+}
+
+void ObjectData::Impl::MarkDirtyDescendant() {
+  for (auto impl = this; impl && !impl->dirty_descendant_;
+       impl = impl->parent_ ? impl->parent_->impl_.get() : nullptr)
+    impl->dirty_descendant_ = true;
+}
+
 void ObjectData::Impl::Save(const std::unique_ptr<DataIO>& io) {
   io->ToDataSection();
-  io->WriteDict(values_);
+  io->WriteDict(Values());
   io->ToSectionUp();
   io->ToAttributeSection();
   StoreBaseToDict(base_info_list_, attrs_);
@@ -1271,7 +1719,10 @@ void ObjectData::Impl::ExecUpdateValue(const std::string& key,
   Command cmd(CommandType::kValueUpdate, Path(),
               key, new_value, prev_value, DObjPath(), "", {});
   EmitSignal(cmd, ListenerCallPoint::kPre);
-  values_[key] = new_value;
+  SetLocalValue(key, new_value);
+  resolved_keys_.erase(key);
+  if (key_sources_valid_)
+    key_sources_[key] |= kLocalKeyFlag;
   SetDirty(true);
   EmitSignal(cmd, ListenerCallPoint::kPost);
 }
@@ -1282,7 +1733,16 @@ void ObjectData::Impl::ExecRemoveValue(const std::string& key,
   Command cmd(CommandType::kValueDelete, Path(),
               key, nil, prev_value, DObjPath(), "", {});
   EmitSignal(cmd, ListenerCallPoint::kPre);
-  values_.erase(key);
+  MutableValues().erase(key);
+  InvalidateResolvedKeys();
+  if (key_sources_valid_) {
+    auto itr = key_sources_.find(key);
+    if (itr != key_sources_.end()) {
+      itr->second &= ~kLocalKeyFlag;
+      if (!itr->second)
+        key_sources_.erase(itr);
+    }
+  }
   SetDirty(true);
   EmitSignal(cmd, ListenerCallPoint::kPost);
 }
@@ -1293,23 +1753,170 @@ void ObjectData::Impl::ExecAddValue(const std::string& key,
   Command cmd(CommandType::kValueAdd, Path(),
               key, new_value, nil, DObjPath(), "", {});
   EmitSignal(cmd, ListenerCallPoint::kPre);
-  values_[key] = new_value;
+  SetLocalValue(key, new_value);
+  resolved_keys_.erase(key);
+  if (key_sources_valid_)
+    key_sources_[key] |= kLocalKeyFlag;
+  SetDirty(true);
+  EmitSignal(cmd, ListenerCallPoint::kPost);
+}
+
+void ObjectData::Impl::ExecUpdateValues(const std::vector<std::string>& keys,
+                                        const DValueDict& new_values,
+                                        const DValueDict& prev_values) {
+  SetIsActual(true);
+  Command cmd(CommandType::kValuesUpdate, Path(),
+              keys, new_values, prev_values);
+  EmitSignal(cmd, ListenerCallPoint::kPre);
+  auto& values = MutableValues();
+  bool removed = false;
+  for (auto& key : keys) {
+    auto itr = new_values.find(key);
+    if (itr != new_values.cend()) {
+      SetLocalValue(key, itr->second);
+      resolved_keys_.erase(key);
+      if (key_sources_valid_)
+        key_sources_[key] |= kLocalKeyFlag;
+      continue;
+    }
+    values.erase(key);
+    removed = true;
+    if (key_sources_valid_) {
+      auto src_itr = key_sources_.find(key);
+      if (src_itr != key_sources_.end()) {
+        src_itr->second &= ~kLocalKeyFlag;
+        if (!src_itr->second)
+          key_sources_.erase(src_itr);
+      }
+    }
+  }
+  if (removed)
+    InvalidateResolvedKeys();
   SetDirty(true);
   EmitSignal(cmd, ListenerCallPoint::kPost);
 }
 
+DetachedChildSp ObjectData::Impl::ExecDetachChild(const std::string& name) {
+  if (IsChildFlat(name))
+    return nullptr;
+  auto child_info = ChildInfo(name);
+  auto detached = std::make_shared<DetachedChild>();
+  detached->child_info_ = child_info;
+  detached->data_list_ = Owner()->OpenedDataInSubtree(
+      child_info.Path());
+  // Locks are released before the directory is moved, and taken back if
+  // the directory can't be moved
+  for (auto& data : detached->data_list_ | boost::adaptors::reversed)
+    data->impl_->UnlockObject();
+  auto relock = [&detached]() {
+    for (auto& data : detached->data_list_) {
+      try {
+        if (data->IsEditable())
+          data->impl_->LockObject();
+      } catch (const DException&) {
+      }
+    }
+  };
+  ChildManifest::Update manifest(ManifestDirPath());
+  auto dir_path = DirPath().empty() ? FsPath() : DirPath() / name;
+  if (!dir_path.empty() && fs::is_directory(dir_path)) {
+    auto top = FindTop();
+    auto trash_dir_path = top->DirPath() / kTrashDirName;
+    boost::system::error_code ec;
+    if (!fs::exists(trash_dir_path)) {
+      // The manifest of this directory is locked already
+      std::unique_ptr<ChildManifest::Update> top_manifest;
+      if (top->impl_.get() != this)
+        top_manifest = std::make_unique<ChildManifest::Update>(
+            top->impl_->ManifestDirPath());
+      fs::create_directory(trash_dir_path, ec);
+      if (!ec)
+        (top_manifest ? *top_manifest : manifest).Restamp();
+    }
+    auto trash_path = trash_dir_path / fs::unique_path("%%%%-%%%%-%%%%-%%%%");
+    if (!ec)
+      fs::rename(dir_path, trash_path, ec);
+    if (ec) {
+      relock();
+      return nullptr;
+    }
+    detached->dir_path_ = dir_path;
+    detached->trash_path_ = trash_path;
+  }
+
+  auto prev_children = children_.ToVector();
+  Command cmd(CommandType::kDeleteChild, Path(), "", nil, nil,
+              child_info.Path(), child_info.Type(), prev_children);
+  EmitSignal(cmd, ListenerCallPoint::kPre);
+  Owner()->DetachObjectData(detached->data_list_);
+  for (auto& data : detached->data_list_)
+    data->impl_->detached_ = true;
+  detached->is_detached_ = true;
+  actual_children_.Erase(name);
+  manifest.Write(ManifestEntries(actual_children_));
+  RefreshChildrenInBase();
+  EmitSignal(cmd, ListenerCallPoint::kPost);
+  return detached;
+}
+
+void ObjectData::Impl::ExecAttachChild(const DetachedChildSp& detached) {
+  auto& child_info = detached->child_info_;
+  auto name = child_info.Name();
+  if (!detached->is_detached_ || HasActualChild(name))
+    THROW2(kErrChildDataAlreadyExists, name, Path().String());
+  ChildManifest::Update manifest(ManifestDirPath());
+  if (!detached->trash_path_.empty()) {
+    boost::system::error_code ec;
+    fs::rename(detached->trash_path_, detached->dir_path_, ec);
+    if (ec)
+      THROW2(kErrFailedToMoveDirectory,
+             detached->trash_path_.string(), ec.message());
+    fs::remove(detached->trash_path_.parent_path(), ec);
+  }
+
+  Command cmd(CommandType::kAddChild, Path(), "", nil, nil,
+              child_info.Path(), child_info.Type(),
+              children_.ToVector());
+  EmitSignal(cmd, ListenerCallPoint::kPre);
+  if (!detached->data_list_.empty())
+    detached->data_list_.front()->impl_->parent_ = self_;
+  for (auto& data : detached->data_list_)
+    data->impl_->detached_ = false;
+  Owner()->AttachObjectData(detached->data_list_);
+  for (auto& data : detached->data_list_) {
+    try {
+      if (data->IsEditable())
+        data->impl_->LockObject();
+    } catch (const DException&) {
+    }
+  }
+  detached->data_list_.clear();
+  detached->is_detached_ = false;
+  AddToDObjInfoList(actual_children_, child_info,
+                    compare_func_, enable_sorting_);
+  children_.Erase(name);
+  AddToDObjInfoList(children_, child_info,
+                    compare_func_, enable_sorting_);
+  if (!detached->trash_path_.empty())
+    manifest.Append(ChildManifest::Entry{name, child_info.Type()});
+  RefreshChildrenInBase();
+  EmitSignal(cmd, ListenerCallPoint::kPost);
+}
+
 void ObjectData::Impl::ExecDeleteChild(const std::string& name) {
-  auto prev_children = children_;
+  DiscoverChildren();
+  auto prev_children = children_.ToVector();
   auto child_info = ChildInfo(name);
   auto is_flat_child = IsChildFlat(name);
   Command cmd(CommandType::kDeleteChild, Path(), "", nil, nil,
               child_info.Path(), child_info.Type(), prev_children);
   EmitSignal(cmd, ListenerCallPoint::kPre);
+  ChildManifest::Update manifest(
+      is_flat_child ? FsPath() : ManifestDirPath());
   Owner()->DeleteObjectImpl(child_info.Path());
-  actual_children_.erase(
-      std::remove_if(actual_children_.begin(), actual_children_.end(),
-                     [&name](auto& c) { return c.Name() == name; }),
-      actual_children_.end());
+  actual_children_.Erase(name);
+  manifest.Write(ManifestEntries(actual_children_));
+  lazy_children_.erase(name);
   RefreshChildrenInBase();
   if (is_flat_child)
     SetDirty(true);
@@ -1326,6 +1933,7 @@ void ObjectData::Impl::ExecAddBase(const DObjectSp& base) {
   SetupListener(base, base_info);
   base_info_list_.push_back(base_info);
   UpdateEffectiveBaseList();
+  AddInheritedKeys(base);
   RefreshChildrenInBase();
   AddBaseToChildren(base);
   SetDirty(true);
@@ -1347,6 +1955,7 @@ void ObjectData::Impl::ExecRemoveBase(const DObjectSp& base) {
     connection.disconnect();
   base_info_list_.erase(itr, base_info_list_.end());
   UpdateEffectiveBaseList();
+  RecheckInheritedKeys(base);
   RefreshChildrenInBase();
   RemoveBaseFromChildren(base_path);
   for (auto& prev_child : prev_children) {
@@ -1376,34 +1985,76 @@ void ObjectData::Impl::EmitSignal(
       enable_signal_by_add_child = true;
     }
   }
-  bool is_to_emit = signal_enabled_ && enable_signal_by_add_child;
+  bool is_to_emit =
+      signal_enabled_ && !detached_ && enable_signal_by_add_child;
 
   if (is_to_emit) {
     sig_[static_cast<unsigned int>(call_point)](cmd);
+    routers_[static_cast<unsigned int>(call_point)].Dispatch(cmd);
+    if (call_point == ListenerCallPoint::kPost && !summary_sig_.empty())
+      EmitSummary(cmd);
     auto ancestor_cmd_stack_obj = FindAncestorWithCommandStack();
     if (ancestor_cmd_stack_obj)
       ancestor_cmd_stack_obj->impl_->EmitSignal(cmd, call_point);
   }
 }
 
+void ObjectData::Impl::EmitSummary(const Command& cmd) {
+  if (!owner_->IsNotificationDeferred()) {
+    ChangeSummary summary(Path());
+    summary.Add(cmd);
+    if (!summary.Empty())
+      summary_sig_(summary);
+    return;
+  }
+  if (!pending_summary_) {
+    pending_summary_ = std::make_unique<ChangeSummary>(Path());
+    owner_->AddPendingSummary(Path());
+  }
+  pending_summary_->Add(cmd);
+}
+
+void ObjectData::Impl::EmitPendingSummary() {
+  if (!pending_summary_)
+    return;
+  auto summary = std::move(pending_summary_);
+  if (!summary->Empty())
+    summary_sig_(*summary);
+}
+
 bool ObjectData::Impl::CreateEmpty(const FsPath& dir_path) {
-  std::ofstream f((dir_path / DataFileName()).string());
-  if (!f)
+  try {
+    auto io = DataIOFactory::Instance().Create(file_format_);
+    io->OpenForWrite(dir_path / DataFileName());
+    io->CloseForWrite();
+  } catch (const DException&) {
+    return false;
+  } catch (const fs::filesystem_error&) {
     return false;
-  f << "{}";
-  f.close();
+  }
   return true;
 }
 
 void ObjectData::Impl::Load() {
   auto io = DataIOFactory::Instance().Create(file_format_);
-  DValueDict values;
+  if (owner_->GetLoadMode() == LoadMode::kLazy) {
+    auto source = io->OpenLazy(DataFilePath());
+    if (source) {
+      LoadFromSource(source);
+      return;
+    }
+  }
+  lazy_values_.reset();
+  lazy_children_.clear();
+  DCompactValueDict values;
   DValueDict attrs;
   std::vector<DataSp> descendants;
   auto f = GenCreateChildFunc(self_, &descendants);
   auto arg = std::make_shared<ReadDataArg>(&values, &attrs, f);
   io->Load(DataFilePath(), arg);
   std::swap(values_, values);
+  InvalidateResolvedKeys();
+  key_sources_valid_ = false;
   std::swap(attrs_, attrs);
   RestoreBaseFromDict(attrs_, base_info_list_);
   UpdateEffectiveBaseList();
@@ -1434,75 +2085,243 @@ void ObjectData::Impl::Load() {
   SetDirty(false);
 }
 
+void ObjectData::Impl::LoadFromSource(const LazyDataSourcePtr& source) {
+  DValueDict attrs;
+  source->ReadAttrs(&attrs);
+  values_.clear();
+  lazy_values_ = source;
+  InvalidateResolvedKeys();
+  key_sources_valid_ = false;
+  std::swap(attrs_, attrs);
+  RestoreBaseFromDict(attrs_, base_info_list_);
+  UpdateEffectiveBaseList();
+  lazy_children_.clear();
+  auto child_info_list = source->ChildInfoList();
+  for (size_t idx = 0; idx < child_info_list.size(); ++ idx) {
+    auto& name = child_info_list[idx].Name();
+    child_flat_flags_[name] = true;
+    if (!HasActualChild(name))
+      AddChildInfo(DObjInfo(obj_path_.ChildPath(name),
+                            child_info_list[idx].Type(), true));
+    lazy_children_[name] = source->Child(idx);
+  }
+  enable_sorting_ = true;
+  if (effective_base_info_list_.size() > 0)
+    RefreshChildrenInBase();
+  else
+    SortChildren();
+  is_actual_ = true;
+  SetDirty(false);
+}
+
+bool ObjectData::Impl::IsLazyChildPending(const std::string& name) const {
+  return lazy_children_.find(name) != lazy_children_.cend();
+}
+
+DataSp ObjectData::Impl::LoadFlattenedChild(const std::string& name) {
+  auto itr = lazy_children_.find(name);
+  if (itr == lazy_children_.end())
+    return nullptr;
+  // The source is decoded only once. The child is a part of this object
+  // afterwards, the same as the ones created after the load.
+  auto source = std::move(itr->second);
+  lazy_children_.erase(itr);
+  auto child_info = ChildInfo(name);
+  auto data = std::shared_ptr<ObjectData>(new ObjectData(
+      child_info.Path(), child_info.Type(), self_, owner_,
+      true, true, false, false));
+  owner_->RegisterObjectData(data);
+  data->impl_->LoadFromSource(source);
+  for (auto& base_of_parent : EffectiveBases()) {
+    if (base_of_parent->HasChild(name)
+        && !data->impl_->HasObjectInBasesFromParent(
+            base_of_parent->Path().ChildPath(name)))
+      data->AddBaseFromParent(
+          base_of_parent->OpenChild(name, OpenMode::kReadOnly));
+  }
+  data->SetDirty(false);
+  return data;
+}
+
 void ObjectData::Impl::RefreshChildren() {
+  children_discovered_ = true;
   RefreshActualChildren();
   RefreshChildrenInBase();
 }
 
+void ObjectData::Impl::AddChildFromDirectory(const std::string& name,
+                                             const std::string& type) {
+  if (!children_discovered_ || HasActualChild(name))
+    return;
+  auto child_path = obj_path_.ChildPath(name);
+  Command cmd(CommandType::kAddChild, Path(), "", nil, nil,
+              child_path, type, children_.ToVector());
+  EmitSignal(cmd, ListenerCallPoint::kPre);
+  DObjInfo child_info(child_path, type);
+  AddToDObjInfoList(actual_children_, child_info, compare_func_, enable_sorting_);
+  children_.Erase(name);
+  AddToDObjInfoList(children_, child_info, compare_func_, enable_sorting_);
+  EmitSignal(cmd, ListenerCallPoint::kPost);
+}
+
+void ObjectData::Impl::RemoveChildFromDirectory(const std::string& name) {
+  if (!children_discovered_ || IsChildFlat(name) || !HasActualChild(name))
+    return;
+  auto child_info = ChildInfo(name);
+  Command cmd(CommandType::kDeleteChild, Path(), "", nil, nil,
+              child_info.Path(), child_info.Type(), children_.ToVector());
+  EmitSignal(cmd, ListenerCallPoint::kPre);
+  // The same as the local delete, the opened subtree is dropped
+  if (owner_->IsOpened(child_info.Path()))
+    owner_->PurgeObject(child_info.Path());
+  actual_children_.Erase(name);
+  RefreshChildrenInBase();
+  EmitSignal(cmd, ListenerCallPoint::kPost);
+}
+
+void ObjectData::Impl::ReloadValues() {
+  if (dir_path_.empty() || IsDirty())
+    return;
+  // Notified of the own save
+  if (GetFileStamp(DataFilePath()) == saved_stamp_)
+    return;
+  DCompactValueDict new_values;
+  try {
+    auto io = DataIOFactory::Instance().Create(file_format_);
+    auto source = io->OpenLazy(DataFilePath());
+    if (!source)
+      source = MemoryDataSource::Load(io.get(), DataFilePath());
+    source->ReadValues(&new_values);
+  } catch (const DException&) {
+    // Retried on the next update of the file
+    return;
+  }
+  std::vector<std::string> removed_keys;
+  for (auto& key_value : Values())
+    if (new_values.find(key_value.first) == new_values.cend())
+      removed_keys.emplace_back(key_value.first);
+  for (auto& key : removed_keys) {
+    Command cmd(CommandType::kValueDelete, Path(), key, nil,
+                Values().at(key).ToDValue(), DObjPath(), "", {});
+    EmitSignal(cmd, ListenerCallPoint::kPre);
+    MutableValues().erase(key);
+    InvalidateResolvedKeys();
+    key_sources_valid_ = false;
+    EmitSignal(cmd, ListenerCallPoint::kPost);
+  }
+  for (auto& key_value : new_values) {
+    auto& key = key_value.first;
+    auto new_value = key_value.second.ToDValue();
+    auto itr = Values().find(key);
+    auto is_new_key = itr == Values().cend();
+    if (!is_new_key && itr->second.Equals(new_value))
+      continue;
+    Command cmd(is_new_key ? CommandType::kValueAdd : CommandType::kValueUpdate,
+                Path(), key, new_value,
+                is_new_key ? DValue(nil) : itr->second.ToDValue(),
+                DObjPath(), "", {});
+    EmitSignal(cmd, ListenerCallPoint::kPre);
+    MutableValues()[key] = key_value.second;
+    InvalidateResolvedKeys();
+    key_sources_valid_ = false;
+    EmitSignal(cmd, ListenerCallPoint::kPost);
+  }
+}
+
 void ObjectData::Impl::SortChildren() {
-  SortDObjInfoVector(children_, compare_func_, enable_sorting_);
+  SortDObjInfoList(children_, compare_func_, enable_sorting_);
 }
 
 void ObjectData::Impl::RefreshActualChildren() {
   if (dir_path_.empty())
     return;
-  std::vector<DObjInfo> children;
-  std::copy_if(actual_children_.cbegin(), actual_children_.cend(),
-               std::back_inserter(children),
-               [this] (auto& c) { return this->IsChildFlat(c.Name()); });
-  actual_children_.erase(
-      std::remove_if(
-          actual_children_.begin(), actual_children_.end(),
-          [this] (auto& c) { return !this->IsChildFlat(c.Name()); }),
-      actual_children_.end());
-  auto dirs = boost::make_iterator_range(
-      fs::directory_iterator(dir_path_),
-      fs::directory_iterator());
-  for (auto itr : dirs) {
-    if (fs::is_directory(itr)) {
-      auto file_info = DataIOFactory::FindDataFileInfo(itr.path());
-      if (!file_info.IsValid())
-        continue;
-      auto child_name = file_info.DirName();
-      if (HasActualChild(child_name))
-        continue;
-      children.emplace_back(
-          DObjInfo(obj_path_.ChildPath(child_name), file_info.Type()));
+  DObjInfoList children;
+  for (auto& child_info : actual_children_)
+    if (IsChildFlat(child_info.Name()))
+      children.Append(child_info);
+  actual_children_.EraseIf(
+      [this] (auto& c) { return !this->IsChildFlat(c.Name()); });
+  auto use_manifest = owner_->IsChildManifestEnabled();
+  std::vector<ChildManifest::Entry> entries;
+  bool is_sorted = false;
+  if (use_manifest && ChildManifest::Read(dir_path_, &entries, &is_sorted)) {
+    auto need_sorting = !is_sorted || !children.Empty();
+    for (auto& entry : entries)
+      if (!HasActualChild(entry.name))
+        children.Append(
+            DObjInfo(obj_path_.ChildPath(entry.name), entry.type));
+    if (need_sorting)
+      SortDObjInfoList(children, compare_func_, enable_sorting_);
+  } else {
+    auto dir_mtime = use_manifest ? ChildManifest::DirModifiedTime(dir_path_) : 0;
+    auto dirs = boost::make_iterator_range(
+        fs::directory_iterator(dir_path_),
+        fs::directory_iterator());
+    for (auto itr : dirs) {
+      if (fs::is_directory(itr)) {
+        auto file_info = DataIOFactory::FindDataFileInfo(itr.path());
+        if (!file_info.IsValid())
+          continue;
+        auto child_name = file_info.DirName();
+        if (HasActualChild(child_name))
+          continue;
+        children.Append(
+            DObjInfo(obj_path_.ChildPath(child_name), file_info.Type()));
+      }
     }
+    SortDObjInfoList(children, compare_func_, enable_sorting_);
+    if (use_manifest)
+      ChildManifest::Write(dir_path_, ManifestEntries(children), dir_mtime);
   }
-  SortDObjInfoVector(children, compare_func_, enable_sorting_);
   if (children == actual_children_)
     return;
   std::swap(actual_children_, children);
-  children_.erase(
-      std::remove_if(
-          children_.begin(), children_.end(),
-          [] (auto& c) { return c.IsActual(); }),
-      children_.end());
-  children_.insert(
-      children_.begin(), actual_children_.begin(), actual_children_.end());
+  DObjInfoList all_children(actual_children_);
+  for (auto& child_info : children_)
+    if (!child_info.IsActual())
+      all_children.Append(child_info);
+  std::swap(children_, all_children);
   SortChildren();
 }
 
+FsPath ObjectData::Impl::ManifestDirPath() const {
+  if (!owner_->IsChildManifestEnabled())
+    return FsPath();
+  return dir_path_;
+}
+
+std::vector<ChildManifest::Entry> ObjectData::Impl::ManifestEntries(
+    const DObjInfoList& children) const {
+  std::vector<ChildManifest::Entry> entries;
+  entries.reserve(children.Size());
+  for (auto& child_info : children)
+    if (!IsChildFlat(child_info.Name()))
+      entries.emplace_back(
+          ChildManifest::Entry{child_info.Name(), child_info.Type()});
+  return entries;
+}
+
+void ObjectData::Impl::DiscoverChildren() const {
+  if (children_discovered_)
+    return;
+  children_discovered_ = true;
+  const_cast<ObjectData::Impl*>(this)->RefreshActualChildren();
+}
+
 void ObjectData::Impl::RefreshChildrenInBase() const {
-  std::unordered_set<std::string> names;
-  for (auto& child : actual_children_)
-    names.insert(child.Name());
-  children_.clear();
-  children_.insert(children_.begin(),
-                   actual_children_.cbegin(), actual_children_.cend());
+  DiscoverChildren();
+  children_ = actual_children_;
   InstanciateBases();
   for (auto& base_info : effective_base_info_list_) {
     for (auto base_child : base_info->Obj()->Children()) {
-      if (names.find(base_child.Name()) != names.cend())
+      if (children_.Has(base_child.Name()))
         continue;
-      names.insert(base_child.Name());
       base_child.SetIsActual(false);
       base_child.SetPath(obj_path_.ChildPath(base_child.Name()));
-      children_.emplace_back(base_child);
+      children_.Append(base_child);
     }
   }
-  SortDObjInfoVector(children_, compare_func_, enable_sorting_);
+  SortDObjInfoList(children_, compare_func_, enable_sorting_);
 }
 
 void ObjectData::Impl::ProcessBaseObjectUpdate(
@@ -1513,10 +2332,15 @@ void ObjectData::Impl::ProcessBaseObjectUpdate(
       | static_cast<unsigned int>(CommandType::kChildListUpdateType);
   auto edit_type = static_cast<unsigned int>(cmd.Type()) & k_edit_type_mask;
   if (cmd_type & children_update_mask) {
-    auto prev_children = children_;
+    resolved_keys_.clear();
+    DiscoverChildren();
+    auto prev_children = children_.ToVector();
     auto next_cmd_type = static_cast<CommandType>(
         edit_type | (cmd_type & k_command_group_mask));
     if (call_point == ListenerCallPoint::kPost) {
+      if (cmd_type & static_cast<unsigned int>(
+              CommandType::kBaseObjectUpdateType))
+        key_sources_valid_ = false;
       auto target_name = cmd.TargetObjectName();
       auto target_path = cmd.TargetObjectPath();
       if (edit_type == static_cast<unsigned int>(CommandType::kAdd)) {
@@ -1534,8 +2358,10 @@ void ObjectData::Impl::ProcessBaseObjectUpdate(
           auto res = FindBaseObj(base_list).ByPath(target_path);
           for (auto& connection : res.Obj().Connections())
             connection.disconnect();
+          auto removed_base = res.Obj().Obj();
           base_list.erase(res.Itr());
           child_data->impl_->UpdateEffectiveBaseList();
+          child_data->impl_->RecheckInheritedKeys(removed_base);
           child_data->impl_->RefreshChildrenInBase();
         }
         UpdateEffectiveBaseList();
@@ -1549,6 +2375,40 @@ void ObjectData::Impl::ProcessBaseObjectUpdate(
                        cmd.ObjPath(), "", prev_children), call_point);
     return;
   }
+  if (cmd.IsMultiValueUpdate()) {
+    std::vector<std::string> keys;
+    DValueDict new_values;
+    DValueDict prev_values;
+    for (auto& key : cmd.Keys()) {
+      resolved_keys_.erase(key);
+      auto new_itr = cmd.NewValues().find(key);
+      if (call_point == ListenerCallPoint::kPost) {
+        if (new_itr == cmd.NewValues().cend())
+          RecheckInheritedKey(key);
+        else if (key_sources_valid_)
+          key_sources_[key] |= kInheritedKeyFlag;
+      }
+      if (IsLocalKey(key))
+        continue;
+      keys.push_back(key);
+      if (new_itr != cmd.NewValues().cend())
+        new_values[key] = new_itr->second;
+      auto prev_itr = cmd.PrevValues().find(key);
+      if (prev_itr != cmd.PrevValues().cend())
+        prev_values[key] = prev_itr->second;
+    }
+    if (!keys.empty())
+      EmitSignal(Command(cmd.Type(), Path(), keys, new_values, prev_values),
+                 call_point);
+    return;
+  }
+  resolved_keys_.erase(cmd.Key());
+  if (call_point == ListenerCallPoint::kPost) {
+    if (cmd.Type() == CommandType::kValueDelete)
+      RecheckInheritedKey(cmd.Key());
+    else if (key_sources_valid_)
+      key_sources_[cmd.Key()] |= kInheritedKeyFlag;
+  }
   if (!IsLocalKey(cmd.Key()))
     EmitSignal(Command(cmd.Type(), Path(), cmd.Key(), cmd.NewValue(),
                        cmd.PrevValue(), DObjPath(), "", {}), call_point);
@@ -1609,7 +2469,7 @@ CreateChildFunc ObjectData::Impl::GenCreateChildFunc(
     DObjInfo child_info(child_path, obj_info.Type());
     auto data = std::shared_ptr<ObjectData>(new ObjectData(
         child_path, obj_info.Type(), parent, owner_, true, true, true, false));
-    parent->SetChildFlat(obj_info.Name());
+    parent->impl_->SetChildFlat(obj_info.Name(), true);
     descendants->emplace_back(data);
     auto arg = std::make_shared<ReadDataArg>(
         &(data->impl_->values_),
@@ -1672,10 +2532,11 @@ ObjectData::ObjectData(const DObjPath& obj_path,
 ObjectData::ObjectData(const FsPath& dir_path,
                        const DObjPath& obj_path,
                        const std::string& type,
+                       FileFormat file_format,
                        ObjectData* parent,
                        Session* owner) :
     impl_(std::make_unique<Impl>(
-        this, dir_path, obj_path, type, parent, owner)) {
+        this, dir_path, obj_path, type, file_format, parent, owner)) {
 }
 
 ObjectData::~ObjectData() = default;
@@ -1697,10 +2558,18 @@ void ObjectData::Put(const std::string& key, const DValue& value) {
   impl_->Put(key, value);
 }
 
+void ObjectData::PutMany(const DValueDict& values) {
+  impl_->PutMany(values);
+}
+
 void ObjectData::RemoveKey(const std::string& key) {
   impl_->RemoveKey(key);
 }
 
+void ObjectData::RemoveKeys(const std::vector<std::string>& keys) {
+  impl_->RemoveKeys(keys);
+}
+
 bool ObjectData::IsLocalKey(const std::string& key) const {
   return impl_->IsLocalKey(key);
 }
@@ -1717,6 +2586,10 @@ std::vector<std::string> ObjectData::Keys(bool local_only) const {
   return impl_->Keys(local_only);
 }
 
+DKeyRange ObjectData::KeyRange(bool local_only) const {
+  return impl_->KeyRange(local_only);
+}
+
 bool ObjectData::HasAttr(const std::string& key) const {
   return impl_->HasAttr(key);
 }
@@ -1798,6 +2671,28 @@ DObjInfo ObjectData::ChildInfo(const std::string& name) const {
   return impl_->ChildInfo(name);
 }
 
+const DObjInfo& ObjectData::ChildAt(size_t index) const {
+  return impl_->ChildAt(index);
+}
+
+size_t ObjectData::ChildIndex(const std::string& name) const {
+  return impl_->ChildIndex(name);
+}
+
+void ObjectData::ForEachChild(
+    const std::function<void (const DObjInfo&)>& func) const {
+  impl_->ForEachChild(func);
+}
+
+void ObjectData::ForEachListedChild(
+    const std::function<void (const DObjInfo&)>& func) const {
+  impl_->ForEachListedChild(func);
+}
+
+size_t ObjectData::ChildrenGeneration() const {
+  return impl_->ChildrenGeneration();
+}
+
 size_t ObjectData::ChildCount() const {
   return impl_->ChildCount();
 }
@@ -1838,7 +2733,11 @@ DObjectSp ObjectData::TopLevelObject() const {
 }
 
 uintptr_t ObjectData::ObjectId() const {
-  return reinterpret_cast<uintptr_t>(this);
+  return impl_->ObjectId();
+}
+
+void ObjectData::SetObjectId(uintptr_t object_id) {
+  impl_->SetObjectId(object_id);
 }
 
 void ObjectData::AddChildInfo(const DObjInfo& child_info) {
@@ -1910,6 +2809,22 @@ boost::signals2::connection ObjectData::AddListener(
   return impl_->AddListener(listener, call_point);
 }
 
+boost::signals2::connection ObjectData::AddListener(
+    const ObjectListenerFunc& listener,
+    const ListenerFilter& filter,
+    ListenerCallPoint call_point) {
+  return impl_->AddListener(listener, filter, call_point);
+}
+
+boost::signals2::connection ObjectData::AddSummaryListener(
+    const SummaryListenerFunc& listener) {
+  return impl_->AddSummaryListener(listener);
+}
+
+void ObjectData::EmitPendingSummary() {
+  impl_->EmitPendingSummary();
+}
+
 void ObjectData::DisableSignal() {
   impl_->DisableSignal();
 }
@@ -1926,14 +2841,27 @@ CommandStackSp ObjectData::GetCommandStack() const {
   return impl_->GetCommandStack();
 }
 
-void ObjectData::Save(bool recurse) {
-  impl_->Save(recurse);
+SaveStats ObjectData::Save(bool recurse, const SaveOptions& options) {
+  return impl_->Save(recurse, options);
 }
 
 void ObjectData::RefreshChildren() {
   impl_->RefreshChildren();
 }
 
+void ObjectData::AddChildFromDirectory(const std::string& name,
+                                       const std::string& type) {
+  impl_->AddChildFromDirectory(name, type);
+}
+
+void ObjectData::RemoveChildFromDirectory(const std::string& name) {
+  impl_->RemoveChildFromDirectory(name);
+}
+
+void ObjectData::ReloadValues() {
+  impl_->ReloadValues();
+}
+
 void ObjectData::SortChildren() {
   impl_->SortChildren();
 }
@@ -1966,6 +2894,12 @@ void ObjectData::ExecAddValue(const std::string& key,
   impl_->ExecAddValue(key, new_value);
 }
 
+void ObjectData::ExecUpdateValues(const std::vector<std::string>& keys,
+                                  const DValueDict& new_values,
+                                  const DValueDict& prev_values) {
+  impl_->ExecUpdateValues(keys, new_values, prev_values);
+}
+
 DObjectSp ObjectData::ExecCreateChild(const std::string& name,
                                       const std::string& type,
                                       bool is_flattened,
@@ -1982,9 +2916,16 @@ DObjectSp ObjectData::ExecCreateChild(const std::string& name,
   if (HasActualChild(name)) {
     child = impl_->Owner()->OpenObject(child_path, OpenMode::kEditable);
   } else {
+    ChildManifest::Update manifest(
+        is_flattened ? FsPath() : impl_->ManifestDirPath());
     child = impl_->Owner()->CreateObjectImpl(child_path, type, is_flattened);
-    if (is_flattened)
+    if (is_flattened) {
       SetDirty(true);
+    } else {
+      impl_->MarkDirtyDescendant();
+      if (!child->DirPath().empty())
+        manifest.Append(ChildManifest::Entry{name, type});
+    }
   }
   if (post_create_func)
     post_create_func(child);
@@ -1998,6 +2939,38 @@ void ObjectData::ExecDeleteChild(const std::string& name) {
   impl_->ExecDeleteChild(name);
 }
 
+DetachedChildSp ObjectData::ExecDetachChild(const std::string& name) {
+  return impl_->ExecDetachChild(name);
+}
+
+void ObjectData::ExecAttachChild(const DetachedChildSp& detached) {
+  impl_->ExecAttachChild(detached);
+}
+
+bool ObjectData::IsDetached() const {
+  return impl_->IsDetached();
+}
+
+DetachedChild::~DetachedChild() {
+  if (!is_detached_ || trash_path_.empty())
+    return;
+  boost::system::error_code ec;
+  fs::remove_all(trash_path_, ec);
+  fs::remove(trash_path_.parent_path(), ec);
+}
+
+const DObjInfo& DetachedChild::ChildInfo() const {
+  return child_info_;
+}
+
+const std::vector<DataSp>& DetachedChild::DataList() const {
+  return data_list_;
+}
+
+bool DetachedChild::IsDetached() const {
+  return is_detached_;
+}
+
 void ObjectData::ExecAddBase(const DObjectSp& base) {
   impl_->ExecAddBase(base);
 }
@@ -2031,8 +3004,17 @@ DataSp ObjectData::Open(const DObjPath& obj_path,
   auto file_info = DataIOFactory::FindDataFileInfo(dir_path);
   if (!file_info.IsValid())
     THROW1(kErrNotObjectDirectory, dir_path.string());
+  return Open(obj_path, dir_path, file_info, parent, owner);
+}
+
+DataSp ObjectData::Open(const DObjPath& obj_path,
+                        const FsPath& dir_path,
+                        const DObjFileInfo& file_info,
+                        ObjectData* parent,
+                        Session* owner) {
   auto data = std::shared_ptr<ObjectData>(new ObjectData(
-      dir_path, obj_path, file_info.Type(), parent, owner));
+      dir_path, obj_path, file_info.Type(), file_info.Format(),
+      parent, owner));
   return data;
 }
 
@@ -2041,6 +3023,15 @@ void ObjectData::Load() {
   impl_->SetIsActual(true);
 }
 
+void ObjectData::Load(const LazyDataSourcePtr& source) {
+  impl_->LoadFromSource(source);
+  impl_->SetIsActual(true);
+}
+
+DataSp ObjectData::LoadFlattenedChild(const std::string& name) {
+  return impl_->LoadFlattenedChild(name);
+}
+
 ObjectData* ObjectData::GetDataAt(const DObjPath& obj_path) {
   return impl_->GetObjectByPath(obj_path, OpenMode::kReadOnly)->GetData();
 }
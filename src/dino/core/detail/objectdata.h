@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include <deque>
+#include <functional>
 #include <string>
 #include <vector>
 #include <memory>
@@ -15,7 +17,9 @@
 #include "dino/core/dobjinfo.h"
 #include "dino/core/dobjfileinfo.h"
 #include "dino/core/dvalue.h"
+#include "dino/core/dkeyrange.h"
 #include "dino/core/filetypes.h"
+#include "dino/core/saveoptions.h"
 #include "dino/core/callback.h"
 #include "dino/core/detail/dataio.h"
 
@@ -29,8 +33,10 @@ namespace detail {
 
 class ObjectData;
 class DataIO;
+class DetachedChild;
 
 using DataSp = std::shared_ptr<ObjectData>;
+using DetachedChildSp = std::shared_ptr<DetachedChild>;
 
 class ObjectData {
  public:
@@ -40,11 +46,14 @@ class ObjectData {
   DValue Get(const std::string& key, const DValue& default_value) const;
   DValue Get(const std::string& key) const;
   void Put(const std::string& key, const DValue& value);
+  void PutMany(const DValueDict& values);
   void RemoveKey(const std::string& key);
+  void RemoveKeys(const std::vector<std::string>& keys);
   bool IsLocalKey(const std::string& key) const;
   bool HasNonLocalKey(const std::string& key) const;
   DObjPath WhereIsKey(const std::string& key) const;
   std::vector<std::string> Keys(bool local_only=false) const;
+  DKeyRange KeyRange(bool local_only=false) const;
 
   bool HasAttr(const std::string& key) const;
   std::string Attr(const std::string& key) const;
@@ -67,6 +76,13 @@ class ObjectData {
   bool IsActualChild(const std::string& name) const;
   bool IsChildOpened(const std::string& name) const;
   std::vector<DObjInfo> Children() const;
+  const DObjInfo& ChildAt(size_t index) const;
+  size_t ChildIndex(const std::string& name) const;
+  void ForEachChild(const std::function<void (const DObjInfo&)>& func) const;
+  // Children listed so far, without scanning the directory
+  void ForEachListedChild(
+      const std::function<void (const DObjInfo&)>& func) const;
+  size_t ChildrenGeneration() const;
   DObjInfo ChildInfo(const std::string& name) const;
   size_t ChildCount() const;
   bool IsFlattened() const;
@@ -81,6 +97,7 @@ class ObjectData {
   DObjectSp Parent() const;
   DObjectSp TopLevelObject() const;
   uintptr_t ObjectId() const;
+  void SetObjectId(uintptr_t object_id);
   void RemoveChild(const std::string& name);
   void AddChildInfo(const DObjInfo& child_info);
   void DeleteChild(const std::string& name);
@@ -105,15 +122,26 @@ class ObjectData {
 
   boost::signals2::connection AddListener(
       const ObjectListenerFunc& listener, ListenerCallPoint call_point);
+  boost::signals2::connection AddListener(
+      const ObjectListenerFunc& listener,
+      const ListenerFilter& filter,
+      ListenerCallPoint call_point);
+  boost::signals2::connection AddSummaryListener(
+      const SummaryListenerFunc& listener);
   void DisableSignal();
   void EnableSignal();
+  void EmitPendingSummary();
 
   CommandStackSp EnableCommandStack(bool enable);
   CommandStackSp GetCommandStack() const;
 
-  void Save(bool recurse);
+  SaveStats Save(bool recurse, const SaveOptions& options);
   void RefreshChildren();
   void SortChildren();
+  // Apply the changes made in the directory by other processes
+  void AddChildFromDirectory(const std::string& name, const std::string& type);
+  void RemoveChildFromDirectory(const std::string& name);
+  void ReloadValues();
 
   void IncRef();
   void DecRef(bool by_editable_ref);
@@ -133,6 +161,12 @@ class ObjectData {
                      const FsPath& dir_path,
                      ObjectData* parent,
                      Session* owner);
+  // file_info is the one already found in dir_path
+  static DataSp Open(const DObjPath& obj_path,
+                     const FsPath& dir_path,
+                     const DObjFileInfo& file_info,
+                     ObjectData* parent,
+                     Session* owner);
   static DObjFileInfo GetFileInfo(const FsPath& path);
   std::string DataFileName() const;
   FsPath DataFilePath() const;
@@ -146,6 +180,9 @@ class ObjectData {
                        const DValue& prev_value);
   void ExecAddValue(const std::string& key,
                     const DValue& new_value);
+  void ExecUpdateValues(const std::vector<std::string>& keys,
+                        const DValueDict& new_values,
+                        const DValueDict& prev_values);
   DObjectSp ExecCreateChild(
       const std::string& name,
       const std::string& type,
@@ -153,10 +190,22 @@ class ObjectData {
       bool emit_signal = true,
       const PostCreateFunc& post_create_func = PostCreateFunc());
   void ExecDeleteChild(const std::string& name);
+  // Deletes a child keeping its opened data and its directory, which is
+  // moved to the trash directory of the top level object, so that it can
+  // be put back by ExecAttachChild. Returns nullptr without any change
+  // if the child is flattened or its directory can't be moved.
+  DetachedChildSp ExecDetachChild(const std::string& name);
+  void ExecAttachChild(const DetachedChildSp& detached);
+  bool IsDetached() const;
   void ExecAddBase(const DObjectSp& base);
   void ExecRemoveBase(const DObjectSp& base);
 
   void Load();
+  // Loads the data already read from the data file
+  void Load(const LazyDataSourcePtr& source);
+  // Decodes a flattened child of a lazily loaded object. Returns nullptr
+  // if the child isn't waiting to be decoded.
+  DataSp LoadFlattenedChild(const std::string& name);
 
  private:
   ObjectData(const DObjPath& obj_path,
@@ -170,6 +219,7 @@ class ObjectData {
   ObjectData(const FsPath& dir_path,
              const DObjPath& obj_path,
              const std::string& type,
+             FileFormat file_format,
              ObjectData* parent,
              Session* owner);
 
@@ -177,6 +227,30 @@ class ObjectData {
   std::unique_ptr<Impl> impl_;
 };
 
+// Subtree removed by ObjectData::ExecDetachChild. The moved directory is
+// removed when this is destroyed while the subtree is detached.
+class DetachedChild {
+ public:
+  DetachedChild() = default;
+  ~DetachedChild();
+  DetachedChild(const DetachedChild&) = delete;
+  DetachedChild& operator=(const DetachedChild&) = delete;
+
+  const DObjInfo& ChildInfo() const;
+  // Opened objects in the subtree, parents first
+  const std::vector<DataSp>& DataList() const;
+  bool IsDetached() const;
+
+ private:
+  DObjInfo child_info_;
+  std::vector<DataSp> data_list_;
+  FsPath dir_path_;
+  FsPath trash_path_;
+  bool is_detached_ = false;
+
+  friend class ObjectData;
+};
+
 }  // namespace detail
 
 }  // namespace core
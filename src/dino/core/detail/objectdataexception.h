@@ -36,6 +36,8 @@ extern const int kErrCommandStackAlreadyEnabled;
 extern const int kErrObjectIsNotActual;
 extern const int kErrAttrDoesNotExist;
 extern const int kErrReservedAttrCantBeUsed;
+extern const int kErrFailedToSaveObjects;
+extern const int kErrFailedToMoveDirectory;
 
 }  // namespace detail
 
@@ -0,0 +1,98 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#include "dino/core/detail/spillfile.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+
+#include "dino/core/commandstackexception.h"
+
+namespace dino {
+
+namespace core {
+
+namespace detail {
+
+namespace fs = boost::filesystem;
+
+SpillFile::SpillFile(const FsPath& dir_path) {
+  boost::system::error_code ec;
+  auto dir = dir_path.empty() ? fs::temp_directory_path(ec) : dir_path;
+  if (ec)
+    BOOST_THROW_EXCEPTION(
+        CommandStackException(kErrHistorySpillError)
+        << ExpInfo1(dir_path.string()) << ExpInfo2(ec.message()));
+  path_ = dir / fs::unique_path("dino_history_%%%%-%%%%-%%%%-%%%%");
+  // Created beforehand so that only the user can read the data. An
+  // existing file isn't reused.
+  auto fd = ::open(path_.c_str(), O_CREAT | O_EXCL | O_WRONLY, 0600);
+  if (fd < 0)
+    BOOST_THROW_EXCEPTION(
+        CommandStackException(kErrHistorySpillError)
+        << ExpInfo1(path_.string()) << ExpInfo2("failed to create"));
+  ::close(fd);
+  Open(std::ios_base::in | std::ios_base::out
+       | std::ios_base::trunc | std::ios_base::binary);
+}
+
+SpillFile::~SpillFile() {
+  file_.close();
+  boost::system::error_code ec;
+  fs::remove(path_, ec);
+}
+
+const FsPath& SpillFile::Path() const {
+  return path_;
+}
+
+uint64_t SpillFile::Write(const char* data, size_t size) {
+  auto offset = size_;
+  file_.seekp(static_cast<std::streamoff>(offset));
+  file_.write(data, static_cast<std::streamsize>(size));
+  file_.flush();
+  if (!file_)
+    BOOST_THROW_EXCEPTION(
+        CommandStackException(kErrHistorySpillError)
+        << ExpInfo1(path_.string()) << ExpInfo2("write error"));
+  size_ += size;
+  return offset;
+}
+
+std::string SpillFile::Read(uint64_t offset, size_t size) {
+  std::string data(size, '\0');
+  file_.seekg(static_cast<std::streamoff>(offset));
+  file_.read(&data[0], static_cast<std::streamsize>(size));
+  if (!file_)
+    BOOST_THROW_EXCEPTION(
+        CommandStackException(kErrHistorySpillError)
+        << ExpInfo1(path_.string()) << ExpInfo2("read error"));
+  return data;
+}
+
+uint64_t SpillFile::Size() const {
+  return size_;
+}
+
+void SpillFile::Clear() {
+  file_.close();
+  Open(std::ios_base::in | std::ios_base::out
+       | std::ios_base::trunc | std::ios_base::binary);
+  size_ = 0;
+}
+
+void SpillFile::Open(std::ios_base::openmode mode) {
+  file_.open(path_.string(), mode);
+  if (!file_)
+    BOOST_THROW_EXCEPTION(
+        CommandStackException(kErrHistorySpillError)
+        << ExpInfo1(path_.string()) << ExpInfo2("failed to open"));
+}
+
+}  // namespace detail
+
+}  // namespace core
+
+}  // namespace dino
@@ -0,0 +1,48 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include "dino/core/fspath.h"
+
+namespace dino {
+
+namespace core {
+
+namespace detail {
+
+// Temporary file holding blocks of data moved out of memory. Blocks are
+// appended, and the space is reclaimed only by Clear. The file is removed
+// when the object is destroyed.
+class SpillFile {
+ public:
+  // An empty dir_path uses the temporary directory of the system
+  explicit SpillFile(const FsPath& dir_path);
+  ~SpillFile();
+  SpillFile(const SpillFile&) = delete;
+  SpillFile& operator=(const SpillFile&) = delete;
+
+  const FsPath& Path() const;
+  // Returns the offset of the block
+  uint64_t Write(const char* data, size_t size);
+  std::string Read(uint64_t offset, size_t size);
+  uint64_t Size() const;
+  void Clear();
+
+ private:
+  void Open(std::ios_base::openmode mode);
+
+  FsPath path_;
+  std::fstream file_;
+  uint64_t size_ = 0;
+};
+
+}  // namespace detail
+
+}  // namespace core
+
+}  // namespace dino
@@ -0,0 +1,118 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#include "dino/core/detail/workerpool.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dino {
+
+namespace core {
+
+namespace detail {
+
+using ScopedLock = std::unique_lock<std::mutex>;
+
+class WorkerPool::Impl {
+ public:
+  Impl(size_t num_threads, size_t max_queued_tasks)
+      : max_queued_tasks_(max_queued_tasks) {
+    if (num_threads == 0)
+      num_threads = DefaultNumThreads();
+    if (max_queued_tasks_ == 0)
+      max_queued_tasks_ = num_threads * 4;
+    for (size_t idx = 0; idx < num_threads; ++ idx)
+      threads_.emplace_back([this] { Run(); });
+  }
+  ~Impl() {
+    {
+      ScopedLock lock(mutex_);
+      stopped_ = true;
+    }
+    task_added_.notify_all();
+    for (auto& thread : threads_)
+      thread.join();
+  }
+  void Post(const Task& task) {
+    ScopedLock lock(mutex_);
+    task_taken_.wait(lock,
+                     [this] { return tasks_.size() < max_queued_tasks_; });
+    tasks_.push_back(task);
+    ++ num_unfinished_tasks_;
+    task_added_.notify_one();
+  }
+  void Wait() {
+    ScopedLock lock(mutex_);
+    task_done_.wait(lock,
+                    [this] { return num_unfinished_tasks_ == 0; });
+  }
+  size_t NumThreads() const {
+    return threads_.size();
+  }
+
+ private:
+  void Run() {
+    while (true) {
+      Task task;
+      {
+        ScopedLock lock(mutex_);
+        task_added_.wait(lock,
+                         [this] { return stopped_ || !tasks_.empty(); });
+        if (tasks_.empty())
+          return;
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      task_taken_.notify_one();
+      task();
+      {
+        ScopedLock lock(mutex_);
+        -- num_unfinished_tasks_;
+      }
+      task_done_.notify_all();
+    }
+  }
+
+  std::vector<std::thread> threads_;
+  std::deque<Task> tasks_;
+  std::mutex mutex_;
+  std::condition_variable task_added_;
+  std::condition_variable task_taken_;
+  std::condition_variable task_done_;
+  size_t max_queued_tasks_;
+  size_t num_unfinished_tasks_ = 0;
+  bool stopped_ = false;
+};
+
+WorkerPool::WorkerPool(size_t num_threads, size_t max_queued_tasks)
+    : impl_(std::make_unique<Impl>(num_threads, max_queued_tasks)) {
+}
+
+WorkerPool::~WorkerPool() = default;
+
+void WorkerPool::Post(const Task& task) {
+  impl_->Post(task);
+}
+
+void WorkerPool::Wait() {
+  impl_->Wait();
+}
+
+size_t WorkerPool::NumThreads() const {
+  return impl_->NumThreads();
+}
+
+size_t WorkerPool::DefaultNumThreads() {
+  auto num_threads = std::thread::hardware_concurrency();
+  return num_threads > 0 ? num_threads : 1;
+}
+
+}  // namespace detail
+
+}  // namespace core
+
+}  // namespace dino
@@ -0,0 +1,40 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <functional>
+#include <memory>
+
+namespace dino {
+
+namespace core {
+
+namespace detail {
+
+// Fixed size thread pool. Post blocks while the queue is full, so the
+// number of tasks waiting to run is bounded.
+class WorkerPool {
+ public:
+  using Task = std::function<void ()>;
+
+  // num_threads == 0 uses the number of hardware threads
+  WorkerPool(size_t num_threads, size_t max_queued_tasks = 0);
+  ~WorkerPool();
+
+  void Post(const Task& task);
+  void Wait();
+  size_t NumThreads() const;
+
+  static size_t DefaultNumThreads();
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace detail
+
+}  // namespace core
+
+}  // namespace dino
@@ -70,6 +70,7 @@ extern const int kErrFailedToOpenWorkspaceFile;
 extern const int kErrWorkspaceFileError;
 extern const int kErrWorkspaceFilePathNotSet;
 extern const int kErrTopObjectDoesNotExist;
+extern const int kErrFailedToStartWatcher;
 extern const int kErrObjectExpired;
 extern const int kErrObjectIsNotEditable;
 extern const int kErrChildIndexOutOfRange;
@@ -78,6 +79,7 @@ extern const int kErrNoRedoEntry;
 extern const int kErrNoUndoEntry;
 extern const int kErrBatchCommandError;
 extern const int kErrInvalidCommandTypeError;
+extern const int kErrHistorySpillError;
 
 }  // namespace core
 
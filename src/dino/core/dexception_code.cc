@@ -55,6 +55,8 @@ extern const int kErrWorkspaceFilePathNotSet = RegisterErrorCode(
     117, "Workspace file path has not been set.", 0);
 extern const int kErrTopObjectDoesNotExist = RegisterErrorCode(
     118, "The top level object '{}' does not exist", 1);
+extern const int kErrFailedToStartWatcher = RegisterErrorCode(
+    119, "Failed to start watching directories -> {}", 1);
 
 extern const int kErrObjectExpired = RegisterErrorCode(
     200, "The object handle '{}' already expired", 1);
@@ -71,6 +73,8 @@ extern const int kErrBatchCommandError = RegisterErrorCode(
     252, "Batch command {}", 1);
 extern const int kErrInvalidCommandTypeError = RegisterErrorCode(
     253, "Unexpected command type '{}' found in command stack", 1);
+extern const int kErrHistorySpillError = RegisterErrorCode(
+    254, "Failed to spill the command history to '{}' -> {}", 2);
 
 
 }  // namespace core
@@ -0,0 +1,60 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/range/iterator_range.hpp>
+
+namespace dino {
+
+namespace core {
+
+// Key name -> flags telling where the key comes from
+using DKeySourceMap = std::map<std::string, unsigned int>;
+
+// Iterates over the keys in a DKeySourceMap whose flags match the mask,
+// in sorted order.
+class DKeyIterator
+    : public boost::iterator_facade<DKeyIterator,
+                                    const std::string,
+                                    boost::forward_traversal_tag> {
+ public:
+  DKeyIterator() = default;
+  DKeyIterator(DKeySourceMap::const_iterator itr,
+               DKeySourceMap::const_iterator end,
+               unsigned int mask)
+      : itr_(itr), end_(end), mask_(mask) {
+    SkipUnmatched();
+  }
+
+ private:
+  friend class boost::iterator_core_access;
+
+  void increment() {
+    ++ itr_;
+    SkipUnmatched();
+  }
+  bool equal(const DKeyIterator& other) const {
+    return itr_ == other.itr_;
+  }
+  const std::string& dereference() const {
+    return itr_->first;
+  }
+  void SkipUnmatched() {
+    while (itr_ != end_ && !(itr_->second & mask_))
+      ++ itr_;
+  }
+
+  DKeySourceMap::const_iterator itr_;
+  DKeySourceMap::const_iterator end_;
+  unsigned int mask_ = 0;
+};
+
+using DKeyRange = boost::iterator_range<DKeyIterator>;
+
+}  // namespace core
+
+}  // namespace dino
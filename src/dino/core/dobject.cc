@@ -57,7 +57,7 @@ std::string DObject::Impl::Name() const {
 }
 
 detail::ObjectData* DObject::Impl::GetRawData() {
-  if (data_.expired())
+  if (IsExpired())
     BOOST_THROW_EXCEPTION(
         DObjectException(kErrObjectExpired)
         << ExpInfo1(path_.String()));
@@ -77,7 +77,8 @@ void DObject::Impl::SetReadOnly() {
 }
 
 bool DObject::Impl::IsExpired() const {
-  return data_.expired();
+  // A detached object is expired until it's attached again by undo
+  return data_.expired() || raw_data_->IsDetached();
 }
 
 DObject::DObject(const DataWp& data)
@@ -108,11 +109,21 @@ void DObject::Put(const std::string& key, const DValue& value) {
   impl_->GetRawData()->Put(key, value);
 }
 
+void DObject::PutMany(const DValueDict& values) {
+  REQUIRE_EDITABLE();
+  impl_->GetRawData()->PutMany(values);
+}
+
 void DObject::RemoveKey(const std::string& key) {
   REQUIRE_EDITABLE();
   impl_->GetRawData()->RemoveKey(key);
 }
 
+void DObject::RemoveKeys(const std::vector<std::string>& keys) {
+  REQUIRE_EDITABLE();
+  impl_->GetRawData()->RemoveKeys(keys);
+}
+
 bool DObject::IsLocalKey(const std::string& key) const {
   return impl_->GetRawData()->IsLocalKey(key);
 }
@@ -129,6 +140,10 @@ std::vector<std::string> DObject::Keys(bool local_only) const {
   return impl_->GetRawData()->Keys(local_only);
 }
 
+DKeyRange DObject::KeyRange(bool local_only) const {
+  return impl_->GetRawData()->KeyRange(local_only);
+}
+
 bool DObject::HasAttr(const std::string& key) const {
   return impl_->GetRawData()->HasAttr(key);
 }
@@ -223,13 +238,30 @@ size_t DObject::ChildCount() const {
   return impl_->GetRawData()->ChildCount();
 }
 
-DObjectSp DObject::GetChildAt(size_t index, OpenMode mode) const {
+const DObjInfo& DObject::ChildAt(size_t index) const {
   auto raw_data = impl_->GetRawData();
-  if (index > raw_data->ChildCount())
+  if (index >= raw_data->ChildCount())
     BOOST_THROW_EXCEPTION(
         DObjectException(kErrChildIndexOutOfRange)
         << ExpInfo1(index) << ExpInfo2(Path().String()));
-  return raw_data->OpenChild(raw_data->Children()[index].Name(), mode);
+  return raw_data->ChildAt(index);
+}
+
+size_t DObject::ChildIndex(const std::string& name) const {
+  return impl_->GetRawData()->ChildIndex(name);
+}
+
+void DObject::ForEachChild(
+    const std::function<void (const DObjInfo&)>& func) const {
+  impl_->GetRawData()->ForEachChild(func);
+}
+
+size_t DObject::ChildrenGeneration() const {
+  return impl_->GetRawData()->ChildrenGeneration();
+}
+
+DObjectSp DObject::GetChildAt(size_t index, OpenMode mode) const {
+  return impl_->GetRawData()->OpenChild(ChildAt(index).Name(), mode);
 }
 
 DObjectSp DObject::OpenChild(const std::string& name, OpenMode mode) const {
@@ -347,6 +379,18 @@ boost::signals2::connection DObject::AddListener(
   return impl_->GetRawData()->AddListener(listener, call_point);
 }
 
+boost::signals2::connection DObject::AddListener(
+    const ObjectListenerFunc& listener,
+    const ListenerFilter& filter,
+    ListenerCallPoint call_point) {
+  return impl_->GetRawData()->AddListener(listener, filter, call_point);
+}
+
+boost::signals2::connection DObject::AddSummaryListener(
+    const SummaryListenerFunc& listener) {
+  return impl_->GetRawData()->AddSummaryListener(listener);
+}
+
 void DObject::DisableSignal() {
   impl_->GetRawData()->DisableSignal();
 }
@@ -364,9 +408,13 @@ CommandStackSp DObject::GetCommandStack() const {
 }
 
 void DObject::Save(bool recurse) {
+  Save(recurse, SaveOptions());
+}
+
+SaveStats DObject::Save(bool recurse, const SaveOptions& options) {
   REQUIRE_EDITABLE();
   PreSaveHook();
-  impl_->GetRawData()->Save(recurse);
+  return impl_->GetRawData()->Save(recurse, options);
 }
 
 // Do nothing. This will be implemented in the derived class
@@ -6,12 +6,15 @@
 #include <memory>
 #include <string>
 #include <map>
+#include <functional>
 
 #include "dino/core/filetypes.h"
 #include "dino/core/fspath.h"
 #include "dino/core/dobjpath.h"
 #include "dino/core/dobjinfo.h"
 #include "dino/core/dvalue.h"
+#include "dino/core/dkeyrange.h"
+#include "dino/core/saveoptions.h"
 #include "dino/core/callback.h"
 #include "dino/core/fwd.h"
 
@@ -37,11 +40,20 @@ class DObject {
   DValue Get(const std::string& key) const;
   void Put(const std::string& key, const char* str_value);
   void Put(const std::string& key, const DValue& value);
+  // Puts all the values as one command. Listeners are notified once with
+  // a CommandType::kValuesUpdate command.
+  void PutMany(const DValueDict& values);
   void RemoveKey(const std::string& key);
+  // Removes all the keys as one command. Nothing is removed if any of
+  // the keys doesn't exist.
+  void RemoveKeys(const std::vector<std::string>& keys);
   bool IsLocalKey(const std::string& key) const;
   bool HasNonLocalKey(const std::string& key) const;
   DObjPath WhereIsKey(const std::string& key) const;
   std::vector<std::string> Keys(bool local_only=false) const;
+  // Sorted key names without building a list. The range is invalidated
+  // when keys are added to or removed from this object or its bases.
+  DKeyRange KeyRange(bool local_only=false) const;
 
   bool HasAttr(const std::string& key) const;
   std::string Attr(const std::string& key) const;
@@ -64,6 +76,14 @@ class DObject {
   bool IsActualChild(const std::string& name) const;
   bool IsChildOpened(const std::string& name) const;
   std::vector<DObjInfo> Children() const;
+  // ChildAt returns a reference into the child list, which stays valid
+  // until ChildrenGeneration() changes. ChildIndex returns ChildCount()
+  // if there's no such child. The function passed to ForEachChild must
+  // not add or remove children of this object.
+  const DObjInfo& ChildAt(size_t index) const;
+  size_t ChildIndex(const std::string& name) const;
+  void ForEachChild(const std::function<void (const DObjInfo&)>& func) const;
+  size_t ChildrenGeneration() const;
   DObjInfo ChildInfo(const std::string& name) const;
   size_t ChildCount() const;
   virtual DObjectSp GetChildAt(size_t index,
@@ -103,8 +123,23 @@ class DObject {
 
   std::vector<DObjectSp> EffectiveBases() const;
 
+  // A value put to a key not in the object is notified as kValueAdd, and
+  // the one put to an existing key as kValueUpdate, with or without the
+  // command stack.
   boost::signals2::connection AddListener(
       const ObjectListenerFunc& listener, ListenerCallPoint call_point);
+  // Called only for the commands matching the filter. The filter is
+  // resolved when connected, so the listener costs nothing for the
+  // commands of other types or other keys.
+  boost::signals2::connection AddListener(
+      const ObjectListenerFunc& listener,
+      const ListenerFilter& filter,
+      ListenerCallPoint call_point);
+  // Called after each change with a summary of the single command. While
+  // the session defers notifications, called once with the merged changes
+  // when the outermost Session::DeferNotifications scope ends.
+  boost::signals2::connection AddSummaryListener(
+      const SummaryListenerFunc& listener);
   void DisableSignal();
   void EnableSignal();
 
@@ -112,6 +147,10 @@ class DObject {
   CommandStackSp GetCommandStack() const;
 
   void Save(bool recurse = false);
+  // Errors of the files written by worker threads are reported together
+  // after all the files are processed. The objects that failed to be
+  // written stay dirty.
+  SaveStats Save(bool recurse, const SaveOptions& options);
 
   SessionPtr GetSession() const;
 
@@ -29,6 +29,9 @@ class DObjFileInfo {
   std::string Type() const {
     return type_;
   }
+  FileFormat Format() const {
+    return format_;
+  }
   bool IsValid() const {
     return
         DObjPath::IsValidName(type_)
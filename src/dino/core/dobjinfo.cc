@@ -15,26 +15,25 @@ namespace core {
 DObjInfo::DObjInfo() = default;
 
 DObjInfo::DObjInfo(const DObjPath& path, const std::string& type, bool is_actual)
-    : path_(path), name_(path.LeafName()), type_(type), is_actual_(is_actual) {
+    : path_(path), type_(type), is_actual_(is_actual) {
 }
 
 DObjInfo::~DObjInfo() = default;
 
-DObjPath DObjInfo::Path() const {
+const DObjPath& DObjInfo::Path() const {
   return path_;
 }
 
 void DObjInfo::SetPath(const DObjPath &path) {
   path_ = path;
-  name_ = path.LeafName();
 }
 
-std::string DObjInfo::Name() const {
-  return name_;
+const std::string& DObjInfo::Name() const {
+  return path_.LeafName();
 }
 
 void DObjInfo::SetName(const std::string& name) {
-  name_ = name;
+  path_ = path_.ParentPath().ChildPath(name);
 }
 
 std::string DObjInfo::Type() const {
@@ -49,8 +48,7 @@ bool DObjInfo::IsValid() const {
   return
       !path_.Empty()
       && path_.IsValid()
-      && !name_.empty()
-      && DObjPath::IsValidName(name_)
+      && DObjPath::IsValidName(path_.LeafName())
       && !type_.empty()
       && DObjPath::IsValidName(type_);
 }
@@ -65,7 +63,7 @@ void DObjInfo::SetIsActual(bool is_actual) {
 
 std::string DObjInfo::ToString(bool name_only) const {
   if (name_only)
-    return name_ + ':' + type_;
+    return path_.LeafName() + ':' + type_;
   return path_.String() + ':' + type_;
 }
 
@@ -87,7 +85,6 @@ DObjInfo DObjInfo::FromString(const std::string& info_str) {
 bool DObjInfo::operator==(const DObjInfo& rhs) const {
   return
       path_ == rhs.path_
-      && name_ == rhs.name_
       && type_ == rhs.type_
       && is_actual_ == rhs.is_actual_;
 }
@@ -19,9 +19,9 @@ class DObjInfo {
   DObjInfo(const DObjInfo&) = default;
   DObjInfo& operator=(const DObjInfo&) = default;
 
-  DObjPath Path() const;
+  const DObjPath& Path() const;
   void SetPath(const DObjPath &path);
-  std::string Name() const;
+  const std::string& Name() const;
   void SetName(const std::string& name);
   std::string Type() const;
   void SetType(const std::string& type);
@@ -34,7 +34,6 @@ class DObjInfo {
 
  private:
   DObjPath path_;
-  std::string name_;
   std::string type_;
   bool is_actual_ = false;
 };
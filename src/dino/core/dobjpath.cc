@@ -3,9 +3,10 @@
 
 #include "dino/core/dobjpath.h"
 
-#include <regex>
+#include <mutex>
+#include <unordered_map>
+#include <boost/functional/hash.hpp>
 #include <boost/algorithm/string/split.hpp>
-#include <boost/algorithm/string/join.hpp>
 #include <boost/algorithm/string/classification.hpp>
 
 namespace dino {
@@ -14,10 +15,125 @@ namespace core {
 
 namespace {
 
-std::regex kObjectNamePattern(R"(\w+)");
+// Same as the regular expression "\w+"
+bool IsWordChar(char c) {
+  return
+      (c >= 'a' && c <= 'z')
+      || (c >= 'A' && c <= 'Z')
+      || (c >= '0' && c <= '9')
+      || c == '_';
+}
+
+const std::string kEmptyString;
 
 }  // namespace
 
+class DObjPath::Node : public std::enable_shared_from_this<Node> {
+ public:
+  Node(const NodeSp& parent, const std::string& name)
+      : parent_(parent), name_(name) {
+    if (parent) {
+      top_ = parent->top_;
+      depth_ = parent->depth_ + 1;
+      hash_ = parent->hash_;
+      has_empty_elem_ = parent->has_empty_elem_;
+      is_valid_ = parent->is_valid_;
+    } else {
+      top_ = this;
+    }
+    boost::hash_combine(hash_, name);
+    has_empty_elem_ = has_empty_elem_ || name.empty();
+    is_valid_ = is_valid_ && IsValidName(name);
+  }
+  const Node* Parent() const { return parent_.get(); }
+  const NodeSp& ParentSp() const { return parent_; }
+  const Node* Top() const { return top_; }
+  const std::string& Name() const { return name_; }
+  size_t Depth() const { return depth_; }
+  size_t Hash() const { return hash_; }
+  bool HasEmptyElem() const { return has_empty_elem_; }
+  bool IsValid() const { return is_valid_; }
+  const Node* AncestorAt(size_t depth) const {
+    auto node = this;
+    while (node->depth_ > depth)
+      node = node->parent_.get();
+    return node;
+  }
+
+ private:
+  NodeSp parent_;
+  const Node* top_ = nullptr;
+  std::string name_;
+  size_t depth_ = 1;
+  size_t hash_ = 0;
+  bool has_empty_elem_ = false;
+  bool is_valid_ = true;
+};
+
+// Intern table of the path nodes. A node is identified by its parent node
+// and its element name, so an equal path always resolves to the same node
+// while any DObjPath holds it.
+class DObjPath::Table {
+ public:
+  NodeSp Intern(const NodeSp& parent, const std::string& name) {
+    Key key(parent.get(), name);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto itr = nodes_.find(key);
+    if (itr != nodes_.end()) {
+      auto node = itr->second.node.lock();
+      if (node)
+        return node;
+    }
+    auto raw_node = new Node(parent, name);
+    NodeSp node(raw_node, [](const Node* n) { Instance().Release(n); });
+    nodes_[key] = Entry{raw_node, node};
+    return node;
+  }
+
+  static Table& Instance() {
+    // Never destructed to keep static DObjPath instances valid at exit
+    static Table* table = new Table;
+    return *table;
+  }
+
+ private:
+  struct Key {
+    Key(const Node* p, const std::string& n) : parent(p), name(n) {}
+    bool operator==(const Key& rhs) const {
+      return parent == rhs.parent && name == rhs.name;
+    }
+    const Node* parent;
+    std::string name;
+  };
+  struct KeyHash {
+    size_t operator()(const Key& key) const {
+      size_t seed = std::hash<const Node*>()(key.parent);
+      boost::hash_combine(seed, key.name);
+      return seed;
+    }
+  };
+  struct Entry {
+    const Node* raw_node;
+    std::weak_ptr<const Node> node;
+  };
+
+  void Release(const Node* node) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto itr = nodes_.find(Key(node->Parent(), node->Name()));
+      // The entry may already be replaced by a new node for the same path
+      if (itr != nodes_.end() && itr->second.raw_node == node)
+        nodes_.erase(itr);
+    }
+    // Deleting the node may release the parent, so this must be done
+    // after unlocking the mutex.
+    delete node;
+  }
+
+  std::mutex mutex_;
+  std::unordered_map<Key, Entry, KeyHash> nodes_;
+};
+
 DObjPath::DObjPath() = default;
 
 DObjPath::DObjPath(const DObjPath&) = default;
@@ -25,100 +141,134 @@ DObjPath::DObjPath(const DObjPath&) = default;
 DObjPath::DObjPath(DObjPath&&) = default;
 
 DObjPath::DObjPath(const std::string& path_str) {
-  boost::algorithm::split(path_elems_, path_str, boost::is_any_of("/"));
-  path_elems_.erase(
-      std::remove(path_elems_.begin(), path_elems_.end(), ""),
-      path_elems_.end());
+  std::vector<std::string> path_elems;
+  boost::algorithm::split(path_elems, path_str, boost::is_any_of("/"));
+  for (auto& elem : path_elems)
+    if (!elem.empty())
+      node_ = Table::Instance().Intern(node_, elem);
+}
+
+DObjPath::DObjPath(const NodeSp& node) : node_(node) {
 }
 
 DObjPath& DObjPath::operator=(const DObjPath& obj_path) = default;
 
+DObjPath& DObjPath::operator=(DObjPath&& obj_path) = default;
+
 bool DObjPath::IsValid() const {
-  for (auto elem : path_elems_)
-    if (!IsValidName(elem))
-      return false;
-  return true;
+  return !node_ || node_->IsValid();
 }
 
 DObjPath DObjPath::ChildPath(const std::string& child_name) const {
-  DObjPath child_path(*this);
-  child_path.path_elems_.emplace_back(child_name);
-  return child_path;
+  return DObjPath(Table::Instance().Intern(node_, child_name));
 }
 
 std::string DObjPath::String() const {
-  return boost::algorithm::join(path_elems_, "/");
+  if (!node_)
+    return std::string();
+  std::vector<const Node*> nodes;
+  size_t length = 0;
+  for (auto node = node_.get(); node; node = node->Parent()) {
+    nodes.push_back(node);
+    length += node->Name().size() + 1;
+  }
+  std::string result;
+  result.reserve(length);
+  for (auto itr = nodes.rbegin(); itr != nodes.rend(); ++ itr) {
+    if (itr != nodes.rbegin())
+      result += '/';
+    result += (*itr)->Name();
+  }
+  return result;
 }
 
 boost::filesystem::path DObjPath::DirPath() const {
+  std::vector<const Node*> nodes;
+  for (auto node = node_.get(); node; node = node->Parent())
+    nodes.push_back(node);
   boost::filesystem::path path;
-  for (auto elem : path_elems_)
-    path /= elem;
+  for (auto itr = nodes.rbegin(); itr != nodes.rend(); ++ itr)
+    path /= (*itr)->Name();
   return path;
 }
 
 bool DObjPath::IsTop() const {
-  return path_elems_.size() == 1;
+  return Depth() == 1;
 }
 
 size_t DObjPath::Depth() const {
-  return path_elems_.size();
+  return node_ ? node_->Depth() : 0;
 }
 
 bool DObjPath::Empty() const {
-  if (path_elems_.empty())
-    return true;
-  return std::find_if(
-      path_elems_.cbegin(), path_elems_.cend(),
-      [](auto& e) { return e.empty(); }) != path_elems_.end();
+  return !node_ || node_->HasEmptyElem();
 }
 
-std::string DObjPath::TopName() const {
-  return path_elems_.front();
+const std::string& DObjPath::TopName() const {
+  return node_ ? node_->Top()->Name() : kEmptyString;
 }
 
 DObjPath DObjPath::Top() const {
-  return DObjPath(TopName());
+  if (!node_)
+    return DObjPath();
+  return DObjPath(node_->Top()->shared_from_this());
 }
 
 DObjPath DObjPath::Tail() const {
-  DObjPath tail(*this);
-  tail.path_elems_.erase(tail.path_elems_.begin());
+  std::vector<const Node*> nodes;
+  for (auto node = node_.get(); node && node->Parent(); node = node->Parent())
+    nodes.push_back(node);
+  DObjPath tail;
+  for (auto itr = nodes.rbegin(); itr != nodes.rend(); ++ itr)
+    tail.node_ = Table::Instance().Intern(tail.node_, (*itr)->Name());
   return tail;
 }
 
 DObjPath DObjPath::ParentPath() const {
-  DObjPath parent(*this);
-  parent.path_elems_.pop_back();
-  return parent;
+  if (!node_)
+    return DObjPath();
+  return DObjPath(node_->ParentSp());
 }
 
-std::string DObjPath::LeafName() const {
-  return path_elems_.back();
+const std::string& DObjPath::LeafName() const {
+  return node_ ? node_->Name() : kEmptyString;
 }
 
 bool DObjPath::IsDescendantOf(
     const DObjPath& ancestor, bool include_self) const {
   if (include_self && ancestor == *this)
     return true;
-  if (ancestor.path_elems_.size() >= path_elems_.size())
+  if (ancestor.Depth() >= Depth())
     return false;
-  for (size_t idx = 0; idx < ancestor.path_elems_.size(); ++ idx)
-    if (ancestor.path_elems_[idx] != path_elems_[idx])
-      return false;
-  return true;
+  if (!ancestor.node_)
+    return true;
+  return node_->AncestorAt(ancestor.Depth()) == ancestor.node_.get();
+}
+
+DObjPath DObjPath::AncestorAt(size_t depth) const {
+  if (depth == 0 || !node_)
+    return DObjPath();
+  if (depth >= Depth())
+    return *this;
+  return DObjPath(node_->AncestorAt(depth)->shared_from_this());
 }
 
 void DObjPath::Clear() {
-  path_elems_.clear();
+  node_.reset();
 }
 
 DObjPath DObjPath::Leaf() const {
-  return DObjPath(LeafName());
+  if (!node_)
+    return DObjPath();
+  return DObjPath(Table::Instance().Intern(nullptr, node_->Name()));
+}
+
+size_t DObjPath::HashValue() const {
+  return node_ ? node_->Hash() : 0;
 }
 
 bool DObjPath::operator==(const DObjPath& other) const {
-  return String() == other.String();
+  return node_ == other.node_;
 }
 
 bool DObjPath::operator!=(const DObjPath& other) const {
@@ -126,7 +276,12 @@ bool DObjPath::operator!=(const DObjPath& other) const {
 }
 
 bool DObjPath::IsValidName(const std::string& name) {
-  return std::regex_match(name, kObjectNamePattern);
+  if (name.empty())
+    return false;
+  for (auto c : name)
+    if (!IsWordChar(c))
+      return false;
+  return true;
 }
 
 }  // namespace core
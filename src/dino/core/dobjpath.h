@@ -5,6 +5,7 @@
 
 #include <string>
 #include <vector>
+#include <memory>
 
 #include "dino/core/fspath.h"
 
@@ -12,6 +13,8 @@ namespace dino {
 
 namespace core {
 
+// Object path. Path elements are interned in a process wide table, so that
+// copying, hashing and comparing paths never touch the element strings.
 class DObjPath {
  public:
   DObjPath();
@@ -19,6 +22,7 @@ class DObjPath {
   DObjPath(const DObjPath&);
   DObjPath(DObjPath&&);
   DObjPath& operator=(const DObjPath& obj_path);
+  DObjPath& operator=(DObjPath&& obj_path);
 
   bool IsValid() const;
   DObjPath ChildPath(const std::string& child_name) const;
@@ -27,15 +31,17 @@ class DObjPath {
   bool IsTop() const;
   size_t Depth() const;
   bool Empty() const;
-  std::string TopName() const;
+  const std::string& TopName() const;
   DObjPath Top() const;
   DObjPath Tail() const;
   DObjPath ParentPath() const;
-  std::string LeafName() const;
+  const std::string& LeafName() const;
   DObjPath Leaf() const;
   bool IsDescendantOf(const DObjPath& ancestor,
                       bool include_self = false) const;
+  DObjPath AncestorAt(size_t depth) const;
   void Clear();
+  size_t HashValue() const;
   bool operator==(const DObjPath& other) const;
   bool operator!=(const DObjPath& other) const;
 
@@ -44,12 +50,17 @@ class DObjPath {
   struct Hash {
     using result_type = std::size_t;
     std::size_t operator()(const DObjPath& path) const {
-      return std::hash<std::string>()(path.String());
+      return path.HashValue();
     }
   };
 
  private:
-  std::vector<std::string> path_elems_;
+  class Node;
+  class Table;
+  using NodeSp = std::shared_ptr<const Node>;
+  explicit DObjPath(const NodeSp& node);
+
+  NodeSp node_;
 };
 
 }  // namespace core
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <unordered_map>
 #include <fmt/format.h>
 #include <boost/variant.hpp>
@@ -66,7 +67,7 @@ DEFINE_DVALUE_EQ_NE_OPERATOR(int);
 inline bool operator==(const DValue& lhs, const DValueArray& rhs) {
   if (lhs.type() != typeid(rhs))
     return false;
-  auto lhs_val = boost::get<DValueArray>(lhs);
+  auto& lhs_val = boost::get<DValueArray>(lhs);
   if (lhs_val.size() != rhs.size())
     return false;
   auto l_itr = lhs_val.cbegin();
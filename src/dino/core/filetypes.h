@@ -16,10 +16,21 @@ enum class OpenMode {
 
 enum class FileFormat {
   kJson,
+  kBinary,
   kUnknown,
   kNone,
 };
 
+enum class LoadMode {
+  kEager,
+  kLazy
+};
+
+enum class LockMode {
+  kLockFile,
+  kLockTable
+};
+
 }  // namespace core
 
 }  // namespace dino
@@ -0,0 +1,34 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <cstddef>
+
+namespace dino {
+
+namespace core {
+
+struct SaveOptions {
+  // Number of threads writing the data files in a recursive save. The
+  // objects are serialized on the calling thread and their files are
+  // written by the workers. 1 writes everything on the calling thread,
+  // and 0 uses the number of hardware threads.
+  unsigned int num_threads = 1;
+  // Writes only the objects changed after the last save, and skips the
+  // subtrees in which nothing has been changed
+  bool skip_clean = false;
+};
+
+struct SaveStats {
+  // Objects whose data files were written
+  size_t num_written = 0;
+  // Objects visited to reach changed descendants, but not written
+  size_t num_clean = 0;
+  // Subtrees skipped without being visited
+  size_t num_skipped_subtrees = 0;
+};
+
+}  // namespace core
+
+}  // namespace dino
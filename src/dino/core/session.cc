@@ -3,6 +3,8 @@
 
 #include "dino/core/session.h"
 
+#include <exception>
+#include <set>
 #include <stdexcept>
 #include <unordered_map>
 #include <boost/filesystem.hpp>
@@ -10,16 +12,57 @@
 #include <fmt/format.h>
 
 #include "dino/core/sessionexception.h"
+#include "dino/core/currentuser.h"
 #include "dino/core/dobject.h"
 #include "dino/core/dexception.h"
 #include "dino/core/objectfactory.h"
 #include "dino/core/detail/objectdata.h"
+#include "dino/core/detail/dataioexception.h"
+#include "dino/core/detail/dataiofactory.h"
+#include "dino/core/detail/dirwatcher.h"
+#include "dino/core/detail/lockmanager.h"
+#include "dino/core/detail/memorydatasource.h"
+#include "dino/core/detail/workerpool.h"
 
 namespace dino {
 
 namespace core {
 
 namespace fs = boost::filesystem;
+
+namespace {
+
+// Result of reading an object directory on a worker thread
+struct ParsedObject {
+  DObjFileInfo file_info;
+  detail::LazyDataSourcePtr source;
+  std::exception_ptr error;
+};
+
+ParsedObject ParseObjectDirectory(const FsPath& dir_path, LoadMode load_mode) {
+  ParsedObject parsed;
+  try {
+    parsed.file_info = detail::DataIOFactory::FindDataFileInfo(dir_path);
+    if (!parsed.file_info.IsValid())
+      BOOST_THROW_EXCEPTION(
+          SessionException(kErrObjectDoesNotExist)
+          << ExpInfo1(dir_path.string()));
+    auto io = detail::DataIOFactory::Instance().Create(
+        parsed.file_info.Format());
+    auto file_path = dir_path / detail::DataIOFactory::DataFileName(
+        parsed.file_info.Type(), parsed.file_info.Format());
+    if (load_mode == LoadMode::kLazy)
+      parsed.source = io->OpenLazy(file_path);
+    if (!parsed.source)
+      parsed.source = detail::MemoryDataSource::Load(io.get(), file_path);
+  } catch (...) {
+    parsed.error = std::current_exception();
+  }
+  return parsed;
+}
+
+}  // namespace
+
 class Session::Impl {
  public:
   class TopObjPathInfo {
@@ -77,21 +120,86 @@ class Session::Impl {
                                const std::string& name,
                                OpenMode mode);
   void OpenDataAtPath(const DObjPath& path, const FsPath& top_dir);
+  detail::DataSp OpenParsedData(const DObjPath& obj_path,
+                                const FsPath& dir_path,
+                                detail::ObjectData* parent,
+                                const ParsedObject& parsed);
+  std::vector<DObjectSp> OpenTopLevelObjects(
+      const std::vector<std::pair<FsPath, std::string>>& dir_name_list,
+      OpenMode mode, unsigned int num_threads);
+  void Preload(const DObjPath& obj_path, size_t depth,
+               unsigned int num_threads);
   DObjectSp OpenObject(const DObjPath& obj_path, OpenMode mode);
   void ExecPreOpenHook(const DObjPath& obj_path, OpenMode mode);
   void DeleteObjectImpl(const DObjPath& obj_path, bool delete_files = true);
   void PurgeObject(const DObjPath& obj_path, bool check_existence = true);
   void SetPreOpenHook(const PreOpenHookFuncType& pre_open_hook);
+  void SetDefaultFileFormat(FileFormat file_format);
+  FileFormat DefaultFileFormat() const;
+  void SetLoadMode(LoadMode load_mode) { load_mode_ = load_mode; }
+  LoadMode GetLoadMode() const { return load_mode_; }
+  void EnableChildManifest(bool enable) { child_manifest_enabled_ = enable; }
+  bool IsChildManifestEnabled() const { return child_manifest_enabled_; }
+  void SetLockMode(LockMode lock_mode) { lock_mode_ = lock_mode; }
+  LockMode GetLockMode() const { return lock_mode_; }
+  detail::LockManager& GetLockManager() { return lock_manager_; }
+  bool IsDataFileWritable(const FsPath& file_path);
+  void EnableWatcher(bool enable, bool reload_values);
+  bool IsWatcherEnabled() const { return watcher_ != nullptr; }
+  int WatcherFileDescriptor() const;
+  size_t ProcessFileSystemEvents();
+  void BeginDeferNotifications() { ++ defer_depth_; }
+  void EndDeferNotifications();
+  bool IsNotificationDeferred() const { return defer_depth_ > 0; }
+  void AddPendingSummary(const DObjPath& obj_path) {
+    pending_summary_paths_.push_back(obj_path);
+  }
   void RegisterObjectData(const detail::DataSp& data);
+  std::vector<detail::DataSp> OpenedDataInSubtree(
+      const DObjPath& obj_path) const;
+  void DetachObjectData(const std::vector<detail::DataSp>& data_list);
+  void AttachObjectData(const std::vector<detail::DataSp>& data_list);
+  uintptr_t AssignObjectId(const DObjPath& obj_path);
   FsPath WorkspaceFilePath() const;
 
  private:
+  // Directory watched for the object at obj_path. pending_child is set
+  // for a new child directory whose data file hasn't been written yet.
+  struct WatchTarget {
+    DObjPath obj_path;
+    std::string pending_child;
+  };
+
+  void WatchObjectData(const detail::ObjectData* data);
+  void UnwatchObjectData(const DObjPath& obj_path);
+  void ProcessChildDirAdded(detail::ObjectData* data, const std::string& name);
+  void ProcessPendingChild(int watch_id, const WatchTarget& target);
+
   TopObjPathVector object_paths_;
+  // Outlives the object data releasing the locks
+  detail::LockManager lock_manager_;
   std::unordered_map<DObjPath,
                      detail::DataSp,
                      DObjPath::Hash> obj_data_map_;
+  std::unordered_map<uintptr_t, detail::DataSp> id_data_map_;
+  std::unordered_map<DObjPath, uintptr_t, DObjPath::Hash> path_id_map_;
+  uintptr_t next_object_id_ = 1;
   Session* self_;
   PreOpenHookFuncType pre_open_hook_;
+  FileFormat default_file_format_ = FileFormat::kJson;
+  LoadMode load_mode_ = LoadMode::kEager;
+  LockMode lock_mode_ = LockMode::kLockFile;
+  // Directories having a writable data file. Failures aren't kept, so
+  // that they are checked again after the permission is fixed.
+  std::set<std::string> writable_dirs_;
+  bool child_manifest_enabled_ = false;
+  std::unique_ptr<detail::DirWatcher> watcher_;
+  bool reload_values_ = false;
+  std::unordered_map<int, WatchTarget> watch_targets_;
+  std::unordered_map<DObjPath, int, DObjPath::Hash> path_watch_ids_;
+  int defer_depth_ = 0;
+  // Objects holding a pending summary, in the order of their first change
+  std::vector<DObjPath> pending_summary_paths_;
 };
 
 void Session::Impl::AddTopLevelObjectPath(const std::string& name,
@@ -245,6 +353,10 @@ void Session::Impl::InitTopLevelObjectPath(const std::string& name,
   } catch (const DException& e) {
     throw SessionException(e);
   }
+  if (watcher_)
+    for (auto& path_data : obj_data_map_)
+      if (path_data.first.TopName() == name)
+        WatchObjectData(path_data.second.get());
 }
 
 DObjectSp Session::Impl::CreateObjectImpl(const DObjPath& obj_path,
@@ -268,18 +380,13 @@ DObjectSp Session::Impl::CreateObjectImpl(const DObjPath& obj_path,
 }
 
 DObjectSp Session::Impl::GetObjectById(uintptr_t object_id, OpenMode mode) const {
-  detail::DataSp data;
-  for (auto& path_data_pair : obj_data_map_) {
-    if (reinterpret_cast<uintptr_t>(path_data_pair.second.get()) == object_id) {
-      data = path_data_pair.second;
-      break;
-    }
-  }
-  if (!data)
+  auto itr = id_data_map_.find(object_id);
+  if (itr == id_data_map_.cend())
     BOOST_THROW_EXCEPTION(
         SessionException(kErrObjectDataNotOpened)
         << ExpInfo1(fmt::format("OBJ_ID:{}", object_id)));
-  auto obj = std::shared_ptr<DObject>(ObjectFactory::Instance().Create(data));
+  auto obj = std::shared_ptr<DObject>(
+      ObjectFactory::Instance().Create(itr->second));
   if (mode == OpenMode::kEditable)
     obj->SetEditable();
   return obj;
@@ -302,7 +409,10 @@ DObjectSp Session::Impl::OpenTopLevelObject(const FsPath& dir_path,
     data->Load();
     return MakeObject(obj_path, mode);
   } catch (const DException& e) {
-    RemoveTopLevelObjectPath(name);
+    if (HasObjectData(obj_path))
+      PurgeObject(obj_path, false);
+    else
+      RemoveTopLevelObjectPath(name);
     throw SessionException(e);
   }
 }
@@ -310,6 +420,8 @@ DObjectSp Session::Impl::OpenTopLevelObject(const FsPath& dir_path,
 void Session::Impl::OpenDataAtPath(
     const DObjPath& path, const FsPath& top_dir) {
   auto parent_data = obj_data_map_[path.ParentPath()].get();
+  if (parent_data->LoadFlattenedChild(path.LeafName()))
+    return;
   try {
     auto data = detail::ObjectData::Open(
         path, top_dir / path.Tail().String(),
@@ -338,6 +450,136 @@ void Session::Impl::OpenDataAtPath(
   }
 }
 
+detail::DataSp Session::Impl::OpenParsedData(const DObjPath& obj_path,
+                                             const FsPath& dir_path,
+                                             detail::ObjectData* parent,
+                                             const ParsedObject& parsed) {
+  if (parsed.error)
+    std::rethrow_exception(parsed.error);
+  auto data = detail::ObjectData::Open(
+      obj_path, dir_path, parsed.file_info, parent, self_);
+  RegisterObjectData(data);
+  try {
+    data->Load(parsed.source);
+  } catch (...) {
+    PurgeObject(obj_path, false);
+    throw;
+  }
+  return data;
+}
+
+std::vector<DObjectSp> Session::Impl::OpenTopLevelObjects(
+    const std::vector<std::pair<FsPath, std::string>>& dir_name_list,
+    OpenMode mode, unsigned int num_threads) {
+  std::vector<ParsedObject> parsed_list(dir_name_list.size());
+  {
+    detail::WorkerPool pool(num_threads);
+    auto load_mode = load_mode_;
+    for (size_t idx = 0; idx < dir_name_list.size(); ++ idx) {
+      auto& dir_path = dir_name_list[idx].first;
+      DObjPath obj_path(dir_name_list[idx].second);
+      if (HasObjectData(obj_path))
+        continue;
+      PreOpenObjectCheck(obj_path, dir_path);
+      auto parsed = &parsed_list[idx];
+      auto abs_path = fs::absolute(dir_path);
+      pool.Post([parsed, abs_path, load_mode] {
+          *parsed = ParseObjectDirectory(abs_path, load_mode);
+        });
+    }
+    pool.Wait();
+  }
+
+  std::vector<DObjectSp> objects;
+  std::vector<DObjPath> opened_paths;
+  try {
+    for (size_t idx = 0; idx < dir_name_list.size(); ++ idx) {
+      auto& name = dir_name_list[idx].second;
+      DObjPath obj_path(name);
+      if (!HasObjectData(obj_path)) {
+        auto abs_path = fs::absolute(dir_name_list[idx].first);
+        AddTopLevelObjectPath(name, abs_path);
+        try {
+          OpenParsedData(obj_path, abs_path, nullptr, parsed_list[idx]);
+        } catch (const DException& e) {
+          RemoveTopLevelObjectPath(name);
+          throw SessionException(e);
+        } catch (...) {
+          RemoveTopLevelObjectPath(name);
+          throw;
+        }
+        opened_paths.emplace_back(obj_path);
+      }
+      objects.emplace_back(MakeObject(obj_path, mode));
+    }
+  } catch (...) {
+    for (auto& obj_path : opened_paths)
+      PurgeObject(obj_path, false);
+    throw;
+  }
+  return objects;
+}
+
+void Session::Impl::Preload(const DObjPath& obj_path, size_t depth,
+                            unsigned int num_threads) {
+  struct PreloadTarget {
+    detail::ObjectData* parent;
+    DObjPath obj_path;
+    FsPath dir_path;
+    ParsedObject parsed;
+  };
+
+  OpenObject(obj_path, OpenMode::kReadOnly);
+  std::vector<detail::ObjectData*> level{obj_data_map_[obj_path].get()};
+  auto load_mode = load_mode_;
+  for (size_t cur_depth = 0;
+       cur_depth < depth && !level.empty(); ++ cur_depth) {
+    std::vector<detail::ObjectData*> next_level;
+    std::vector<PreloadTarget> targets;
+    for (auto data : level) {
+      auto dir_path = data->DirPath();
+      if (dir_path.empty())
+        continue;
+      data->ForEachChild([&](const DObjInfo& child_info) {
+          if (!child_info.IsActual() || data->IsChildFlat(child_info.Name()))
+            return;
+          auto itr = obj_data_map_.find(child_info.Path());
+          if (itr != obj_data_map_.cend()) {
+            next_level.emplace_back(itr->second.get());
+            return;
+          }
+          targets.emplace_back(PreloadTarget{
+              data, child_info.Path(), dir_path / child_info.Name(), {}});
+        });
+    }
+    for (auto& target : targets)
+      ExecPreOpenHook(target.obj_path, OpenMode::kReadOnly);
+    {
+      // Destroyed before targets, so that no task outlives its target
+      detail::WorkerPool pool(num_threads);
+      for (auto& target : targets) {
+        auto target_ptr = &target;
+        pool.Post([target_ptr, load_mode] {
+            target_ptr->parsed = ParseObjectDirectory(
+                target_ptr->dir_path, load_mode);
+          });
+      }
+      pool.Wait();
+    }
+    for (auto& target : targets) {
+      if (target.parsed.error || HasObjectData(target.obj_path))
+        continue;
+      try {
+        next_level.emplace_back(
+            OpenParsedData(target.obj_path, target.dir_path,
+                           target.parent, target.parsed).get());
+      } catch (const DException&) {
+      }
+    }
+    std::swap(level, next_level);
+  }
+}
+
 DObjectSp Session::Impl::OpenObject(const DObjPath& obj_path, OpenMode mode) {
   if (HasObjectData(obj_path))
     return MakeObject(obj_path, mode);
@@ -359,17 +601,13 @@ DObjectSp Session::Impl::OpenObject(const DObjPath& obj_path, OpenMode mode) {
 
   auto top_dir = FindTopObjPathInfo(obj_path.TopName())->Path();
   try {
-    DObjPath current_path;
-    DObjPath remaining_path(obj_path);
-    while (remaining_path.Depth() > 1) {
-      current_path = current_path.ChildPath(remaining_path.TopName());
-      remaining_path = remaining_path.Tail();
+    for (size_t depth = 2; depth < obj_path.Depth(); ++ depth) {
+      auto current_path = obj_path.AncestorAt(depth);
       if (!HasObjectData(current_path))
         OpenDataAtPath(current_path, top_dir);
     }
-    current_path = current_path.ChildPath(remaining_path.TopName());
-    OpenDataAtPath(current_path, top_dir);
-    return MakeObject(current_path, mode);
+    OpenDataAtPath(obj_path, top_dir);
+    return MakeObject(obj_path, mode);
   } catch (const DException& e) {
     throw SessionException(e);
   }
@@ -399,6 +637,16 @@ void Session::Impl::DeleteObjectImpl(const DObjPath& obj_path,
       fs::remove_all(dir_to_remove);
     } catch (const fs::filesystem_error&) {
     }
+    auto dir_str = dir_to_remove.string();
+    writable_dirs_.erase(writable_dirs_.lower_bound(dir_str),
+                         writable_dirs_.lower_bound(dir_str + '0'));
+  }
+  // Ids survive purging, so that they can be cached while the objects
+  // are reopened. Ids of deleted objects aren't used again.
+  if (!obj_path.IsTop() || delete_files) {
+    for (auto& data : OpenedDataInSubtree(obj_path))
+      path_id_map_.erase(data->Path());
+    path_id_map_.erase(obj_path);
   }
   PurgeObject(obj_path, false);
 }
@@ -432,8 +680,14 @@ void Session::Impl::PurgeObject(const DObjPath& obj_path, bool check_existence)
           SessionException(kErrObjectDataNotOpened)
           << ExpInfo1(obj_path.String()));
   } else {
-    for (auto& child : obj_data_map_[obj_path]->Children())
-      PurgeObject(obj_path.ChildPath(child.Name()), false);
+    auto data = obj_data_map_[obj_path];
+    // Opened children are always listed, see RegisterObjectData
+    data->ForEachListedChild([this, &obj_path](auto& child) {
+        this->PurgeObject(obj_path.ChildPath(child.Name()), false);
+      });
+    if (watcher_)
+      UnwatchObjectData(obj_path);
+    id_data_map_.erase(obj_data_map_[obj_path]->ObjectId());
     obj_data_map_.erase(obj_path);
   }
   if (obj_path.IsTop())
@@ -444,6 +698,18 @@ void Session::Impl::SetPreOpenHook(const PreOpenHookFuncType& pre_open_hook) {
   pre_open_hook_ = pre_open_hook;
 }
 
+void Session::Impl::SetDefaultFileFormat(FileFormat file_format) {
+  if (file_format != FileFormat::kJson && file_format != FileFormat::kBinary)
+    BOOST_THROW_EXCEPTION(
+        SessionException(detail::kErrUnknownFileFormat)
+        << ExpInfo1(static_cast<int>(file_format)));
+  default_file_format_ = file_format;
+}
+
+FileFormat Session::Impl::DefaultFileFormat() const {
+  return default_file_format_;
+}
+
 void Session::Impl::RegisterObjectData(const detail::DataSp& data) {
   auto obj_path = data->Path();
   if (HasObjectData(obj_path))
@@ -451,10 +717,224 @@ void Session::Impl::RegisterObjectData(const detail::DataSp& data) {
         SessionException(kErrObjectDataAlreadyExists)
         << ExpInfo1(obj_path.String()));
   obj_data_map_[obj_path] = data;
+  data->SetObjectId(AssignObjectId(obj_path));
+  id_data_map_[data->ObjectId()] = data;
   if (data->IsActual() && !obj_path.IsTop()) {
     auto parent = obj_data_map_[obj_path.ParentPath()];
     parent->AddChildInfo(DObjInfo(data->Path(), data->Type(), data->IsActual()));
   }
+  if (watcher_)
+    WatchObjectData(data.get());
+}
+
+std::vector<detail::DataSp> Session::Impl::OpenedDataInSubtree(
+    const DObjPath& obj_path) const {
+  std::vector<detail::DataSp> data_list;
+  auto itr = obj_data_map_.find(obj_path);
+  if (itr == obj_data_map_.cend())
+    return data_list;
+  data_list.push_back(itr->second);
+  for (size_t idx = 0; idx < data_list.size(); ++ idx) {
+    auto parent_path = data_list[idx]->Path();
+    data_list[idx]->ForEachListedChild(
+        [this, &parent_path, &data_list](auto& child_info) {
+          auto child_itr = obj_data_map_.find(
+              parent_path.ChildPath(child_info.Name()));
+          if (child_itr != obj_data_map_.cend())
+            data_list.push_back(child_itr->second);
+        });
+  }
+  return data_list;
+}
+
+bool Session::Impl::IsDataFileWritable(const FsPath& file_path) {
+  auto dir_str = file_path.parent_path().string();
+  if (writable_dirs_.find(dir_str) != writable_dirs_.cend())
+    return true;
+  if (!CurrentUser::Instance().IsWritable(file_path))
+    return false;
+  writable_dirs_.insert(dir_str);
+  return true;
+}
+
+void Session::Impl::DetachObjectData(
+    const std::vector<detail::DataSp>& data_list) {
+  for (auto& data : data_list) {
+    if (watcher_)
+      UnwatchObjectData(data->Path());
+    id_data_map_.erase(data->ObjectId());
+    obj_data_map_.erase(data->Path());
+  }
+}
+
+void Session::Impl::AttachObjectData(
+    const std::vector<detail::DataSp>& data_list) {
+  for (auto& data : data_list) {
+    obj_data_map_[data->Path()] = data;
+    id_data_map_[data->ObjectId()] = data;
+    if (watcher_)
+      WatchObjectData(data.get());
+  }
+}
+
+void Session::Impl::EnableWatcher(bool enable, bool reload_values) {
+  reload_values_ = reload_values;
+  if (!enable) {
+    watcher_.reset();
+    watch_targets_.clear();
+    path_watch_ids_.clear();
+    return;
+  }
+  if (watcher_)
+    return;
+  watcher_ = std::make_unique<detail::DirWatcher>();
+  for (auto& path_data : obj_data_map_)
+    WatchObjectData(path_data.second.get());
+}
+
+int Session::Impl::WatcherFileDescriptor() const {
+  return watcher_ ? watcher_->FileDescriptor() : -1;
+}
+
+void Session::Impl::WatchObjectData(const detail::ObjectData* data) {
+  auto dir_path = data->DirPath();
+  if (dir_path.empty() || path_watch_ids_.count(data->Path()) > 0)
+    return;
+  auto watch_id = watcher_->Watch(dir_path);
+  if (watch_id < 0)
+    return;
+  watch_targets_[watch_id] = WatchTarget{data->Path(), ""};
+  path_watch_ids_[data->Path()] = watch_id;
+}
+
+void Session::Impl::UnwatchObjectData(const DObjPath& obj_path) {
+  auto itr = path_watch_ids_.find(obj_path);
+  if (itr == path_watch_ids_.end())
+    return;
+  watcher_->Unwatch(itr->second);
+  watch_targets_.erase(itr->second);
+  path_watch_ids_.erase(itr);
+}
+
+size_t Session::Impl::ProcessFileSystemEvents() {
+  if (!watcher_)
+    return 0;
+  auto events = watcher_->ReadEvents();
+  for (auto& event : events) {
+    if (event.type & detail::DirWatcher::kOverflow) {
+      // Events were dropped
+      for (auto& path_watch_id : path_watch_ids_)
+        if (HasObjectData(path_watch_id.first))
+          obj_data_map_[path_watch_id.first]->RefreshChildren();
+      continue;
+    }
+    auto itr = watch_targets_.find(event.watch_id);
+    if (itr == watch_targets_.end())
+      continue;
+    auto target = itr->second;
+    if (event.type & detail::DirWatcher::kWatchRemoved) {
+      watch_targets_.erase(itr);
+      if (target.pending_child.empty())
+        path_watch_ids_.erase(target.obj_path);
+      continue;
+    }
+    if (!HasObjectData(target.obj_path))
+      continue;
+    auto data = obj_data_map_[target.obj_path];
+    if (!target.pending_child.empty()) {
+      if (event.type & detail::DirWatcher::kFileWritten)
+        ProcessPendingChild(event.watch_id, target);
+      continue;
+    }
+    if (event.type & detail::DirWatcher::kChildDirAdded)
+      ProcessChildDirAdded(data.get(), event.name);
+    if (event.type & detail::DirWatcher::kChildDirRemoved)
+      data->RemoveChildFromDirectory(event.name);
+    if ((event.type & detail::DirWatcher::kFileWritten)
+        && reload_values_ && event.name == data->DataFileName())
+      data->ReloadValues();
+  }
+  return events.size();
+}
+
+void Session::Impl::ProcessChildDirAdded(detail::ObjectData* data,
+                                         const std::string& name) {
+  if (!DObjPath::IsValidName(name))
+    return;
+  auto child_dir_path = data->DirPath() / name;
+  auto file_info = detail::DataIOFactory::FindDataFileInfo(child_dir_path);
+  if (file_info.IsValid()) {
+    data->AddChildFromDirectory(name, file_info.Type());
+    return;
+  }
+  // Wait for the data file
+  auto watch_id = watcher_->Watch(child_dir_path);
+  if (watch_id < 0 || watch_targets_.count(watch_id) > 0)
+    return;
+  WatchTarget target{data->Path(), name};
+  watch_targets_[watch_id] = target;
+  ProcessPendingChild(watch_id, target);
+}
+
+void Session::Impl::ProcessPendingChild(int watch_id,
+                                        const WatchTarget& target) {
+  auto data = obj_data_map_[target.obj_path];
+  auto file_info = detail::DataIOFactory::FindDataFileInfo(
+      data->DirPath() / target.pending_child);
+  if (!file_info.IsValid())
+    return;
+  watcher_->Unwatch(watch_id);
+  watch_targets_.erase(watch_id);
+  data->AddChildFromDirectory(target.pending_child, file_info.Type());
+}
+
+uintptr_t Session::Impl::AssignObjectId(const DObjPath& obj_path) {
+  auto itr = path_id_map_.find(obj_path);
+  if (itr != path_id_map_.cend())
+    return itr->second;
+  auto object_id = next_object_id_ ++;
+  path_id_map_[obj_path] = object_id;
+  return object_id;
+}
+
+void Session::Impl::EndDeferNotifications() {
+  if (-- defer_depth_ > 0)
+    return;
+  auto paths = std::move(pending_summary_paths_);
+  pending_summary_paths_.clear();
+  std::exception_ptr error;
+  for (auto& path : paths) {
+    auto itr = obj_data_map_.find(path);
+    if (itr == obj_data_map_.end())
+      continue;
+    try {
+      itr->second->EmitPendingSummary();
+    } catch (...) {
+      if (!error)
+        error = std::current_exception();
+    }
+  }
+  if (error)
+    std::rethrow_exception(error);
+}
+
+Session::DeferNotifications::DeferNotifications(const SessionPtr& session)
+    : session_(session) {
+  session_->impl_->BeginDeferNotifications();
+}
+
+Session::DeferNotifications::~DeferNotifications() {
+  try {
+    End();
+  } catch (...) {
+  }
+}
+
+void Session::DeferNotifications::End() {
+  if (ended_)
+    return;
+  ended_ = true;
+  session_->impl_->EndDeferNotifications();
 }
 
 Session::Session() : impl_(std::make_unique<Impl>(this)) {
@@ -477,6 +957,13 @@ DObjectSp Session::OpenTopLevelObject(const FsPath& dir_path,
   return impl_->OpenTopLevelObject(dir_path, type, mode);
 }
 
+std::vector<DObjectSp> Session::OpenTopLevelObjects(
+    const std::vector<std::pair<FsPath, std::string>>& dir_name_list,
+    OpenMode mode,
+    unsigned int num_threads) {
+  return impl_->OpenTopLevelObjects(dir_name_list, mode, num_threads);
+}
+
 void Session::InitTopLevelObjectPath(const std::string& name,
                                      const FsPath& dir_path) {
   impl_->InitTopLevelObjectPath(name, dir_path);
@@ -511,6 +998,12 @@ bool Session::IsOpened(const DObjPath& obj_path) const {
   return impl_->HasObjectData(obj_path);
 }
 
+void Session::Preload(const DObjPath& obj_path, size_t depth,
+                      unsigned int num_threads) {
+  impl_->ExecPreOpenHook(obj_path, OpenMode::kReadOnly);
+  impl_->Preload(obj_path, depth, num_threads);
+}
+
 void Session::DeleteObject(const DObjPath& obj_path) {
   if (obj_path.IsTop()) {
     DeleteObjectImpl(obj_path);
@@ -537,10 +1030,92 @@ void Session::SetPreOpenHook(const PreOpenHookFuncType& pre_open_hook) {
   impl_->SetPreOpenHook(pre_open_hook);
 }
 
+void Session::SetDefaultFileFormat(FileFormat file_format) {
+  impl_->SetDefaultFileFormat(file_format);
+}
+
+FileFormat Session::DefaultFileFormat() const {
+  return impl_->DefaultFileFormat();
+}
+
+void Session::SetLoadMode(LoadMode load_mode) {
+  impl_->SetLoadMode(load_mode);
+}
+
+LoadMode Session::GetLoadMode() const {
+  return impl_->GetLoadMode();
+}
+
+void Session::EnableChildManifest(bool enable) {
+  impl_->EnableChildManifest(enable);
+}
+
+bool Session::IsChildManifestEnabled() const {
+  return impl_->IsChildManifestEnabled();
+}
+
+void Session::SetLockMode(LockMode lock_mode) {
+  impl_->SetLockMode(lock_mode);
+}
+
+LockMode Session::GetLockMode() const {
+  return impl_->GetLockMode();
+}
+
+void Session::EnableWatcher(bool enable, bool reload_values) {
+  impl_->EnableWatcher(enable, reload_values);
+}
+
+bool Session::IsWatcherEnabled() const {
+  return impl_->IsWatcherEnabled();
+}
+
+int Session::WatcherFileDescriptor() const {
+  return impl_->WatcherFileDescriptor();
+}
+
+size_t Session::ProcessFileSystemEvents() {
+  return impl_->ProcessFileSystemEvents();
+}
+
 void Session::RegisterObjectData(const detail::DataSp& data) {
   impl_->RegisterObjectData(data);
 }
 
+bool Session::AcquireObjectLock(const DObjPath& obj_path,
+                                const FsPath& top_dir_path) {
+  return impl_->GetLockManager().Acquire(obj_path, top_dir_path);
+}
+
+bool Session::ReleaseObjectLock(const DObjPath& obj_path) {
+  return impl_->GetLockManager().Release(obj_path);
+}
+
+bool Session::IsDataFileWritable(const FsPath& file_path) {
+  return impl_->IsDataFileWritable(file_path);
+}
+
+std::vector<detail::DataSp> Session::OpenedDataInSubtree(
+    const DObjPath& obj_path) const {
+  return impl_->OpenedDataInSubtree(obj_path);
+}
+
+void Session::DetachObjectData(const std::vector<detail::DataSp>& data_list) {
+  impl_->DetachObjectData(data_list);
+}
+
+void Session::AttachObjectData(const std::vector<detail::DataSp>& data_list) {
+  impl_->AttachObjectData(data_list);
+}
+
+bool Session::IsNotificationDeferred() const {
+  return impl_->IsNotificationDeferred();
+}
+
+void Session::AddPendingSummary(const DObjPath& obj_path) {
+  impl_->AddPendingSummary(obj_path);
+}
+
 SessionPtr Session::Create() {
   return std::unique_ptr<Session>(new Session());
 }
@@ -5,6 +5,7 @@
 
 #include <string>
 #include <vector>
+#include <utility>
 #include <functional>
 
 #include "dino/core/fspath.h"
@@ -25,6 +26,27 @@ class ObjectData;
 class Session : public std::enable_shared_from_this<Session> {
  public:
   using PreOpenHookFuncType = std::function<void (const DObjPath&, OpenMode)>;
+  // While an instance exists, the listeners added by
+  // DObject::AddSummaryListener aren't called. The changes of each object
+  // are merged and delivered as one summary when the outermost instance
+  // is destroyed. Listeners added by DObject::AddListener are called for
+  // each change as usual.
+  class DeferNotifications {
+   public:
+    explicit DeferNotifications(const SessionPtr& session);
+    // Calls End() if not called yet, ignoring the exceptions of the
+    // listeners
+    ~DeferNotifications();
+    DeferNotifications(const DeferNotifications&) = delete;
+    DeferNotifications& operator=(const DeferNotifications&) = delete;
+    // Delivers the summaries if this is the outermost instance. All the
+    // summaries are delivered, and then the first exception thrown by the
+    // listeners is rethrown.
+    void End();
+   private:
+    SessionPtr session_;
+    bool ended_ = false;
+  };
   Session(const Session&) = delete;
   Session& operator=(const Session&) = delete;
   ~Session();
@@ -34,6 +56,15 @@ class Session : public std::enable_shared_from_this<Session> {
   DObjectSp OpenTopLevelObject(const FsPath& dir_path,
                                const std::string& name,
                                OpenMode mode = OpenMode::kReadOnly);
+  // Opens the top level objects of the (directory, name) pairs. The data
+  // files are read on num_threads worker threads, and the objects are
+  // registered on the calling thread. If any of them fails, the ones
+  // opened by this call are purged. num_threads == 0 uses the number of
+  // hardware threads.
+  std::vector<DObjectSp> OpenTopLevelObjects(
+      const std::vector<std::pair<FsPath, std::string>>& dir_name_list,
+      OpenMode mode = OpenMode::kReadOnly,
+      unsigned int num_threads = 0);
   void InitTopLevelObjectPath(const std::string& name,
                               const FsPath& dir_path);
   DObjectSp CreateObject(const DObjPath& obj_info,
@@ -44,10 +75,50 @@ class Session : public std::enable_shared_from_this<Session> {
   DObjectSp GetObjectById(uintptr_t object_id,
                           OpenMode mode = OpenMode::kReadOnly) const;
   bool IsOpened(const DObjPath& obj_path) const;
+  // Opens the object and its descendants down to depth levels below it,
+  // reading the data files level by level on worker threads. Children
+  // that fail to be read are left unopened.
+  void Preload(const DObjPath& obj_path, size_t depth,
+               unsigned int num_threads = 0);
   void DeleteObject(const DObjPath& obj_path);
   void RemoveTopLevelObject(const std::string& name, bool delete_files = false);
   void PurgeObject(const DObjPath& obj_path);
   void SetPreOpenHook(const PreOpenHookFuncType& pre_open_hook);
+  // File format of the objects created in this session. Child objects
+  // use the format of their parent, and existing files are opened in
+  // whatever format they were saved.
+  void SetDefaultFileFormat(FileFormat file_format);
+  FileFormat DefaultFileFormat() const;
+  // In lazy mode, data files are mapped and the values are decoded when
+  // they're first accessed. Flattened children are decoded when they're
+  // opened. Formats without lazy loading support are loaded eagerly.
+  void SetLoadMode(LoadMode load_mode);
+  LoadMode GetLoadMode() const;
+  // Keeps a manifest of the child directories in each object directory.
+  // While the manifest is up to date, children are listed from it
+  // instead of scanning the directory.
+  void EnableChildManifest(bool enable = true);
+  bool IsChildManifestEnabled() const;
+  // kLockFile creates a lock file next to the data file of each editable
+  // object. kLockTable records the locks in one table file per top level
+  // directory instead. A lock in the table covers the subtree, so the
+  // objects opened editable under a locked ancestor are only counted in
+  // memory. Set before opening objects editable. In both modes, the write
+  // permission of a data file is checked once per directory in the
+  // session.
+  void SetLockMode(LockMode lock_mode);
+  LockMode GetLockMode() const;
+  // Watches the directories of the opened objects for changes made by
+  // other processes (Linux only). Pending changes are applied by
+  // ProcessFileSystemEvents, which adds and removes children and, if
+  // reload_values is true, reloads the values of objects that aren't
+  // dirty. The changes are notified to the listeners as commands.
+  void EnableWatcher(bool enable = true, bool reload_values = false);
+  bool IsWatcherEnabled() const;
+  // Becomes readable while events are pending. -1 if not watching.
+  int WatcherFileDescriptor() const;
+  // Returns the number of events processed
+  size_t ProcessFileSystemEvents();
 
   static SessionPtr Create();
 
@@ -58,6 +129,23 @@ class Session : public std::enable_shared_from_this<Session> {
                              bool is_flattened = false);
   void DeleteObjectImpl(const DObjPath& obj_path);
   void RegisterObjectData(const std::shared_ptr<detail::ObjectData>& data);
+  bool AcquireObjectLock(const DObjPath& obj_path, const FsPath& top_dir_path);
+  // Returns false if the lock is kept since its descendants couldn't be
+  // locked. The lock is released again by a later release.
+  bool ReleaseObjectLock(const DObjPath& obj_path);
+  // Cached per directory once the file is found writable
+  bool IsDataFileWritable(const FsPath& file_path);
+  // Opened objects in the subtree at obj_path, parents first
+  std::vector<std::shared_ptr<detail::ObjectData>> OpenedDataInSubtree(
+      const DObjPath& obj_path) const;
+  // Removes the data from the session without destroying them, and puts
+  // them back
+  void DetachObjectData(
+      const std::vector<std::shared_ptr<detail::ObjectData>>& data_list);
+  void AttachObjectData(
+      const std::vector<std::shared_ptr<detail::ObjectData>>& data_list);
+  bool IsNotificationDeferred() const;
+  void AddPendingSummary(const DObjPath& obj_path);
 
   class Impl;
   std::unique_ptr<Impl> impl_;
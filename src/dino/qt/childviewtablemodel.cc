@@ -0,0 +1,220 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#include "dino/qt/childviewtablemodel.h"
+
+#include <string>
+#include <unordered_map>
+
+#include "dino/core/childview.h"
+#include "dino/core/dobject.h"
+
+namespace dino {
+
+namespace qt {
+
+class ChildViewTableModel::Impl {
+ public:
+  Impl(ChildViewTableModel* self) : self(self) {}
+  ~Impl() = default;
+  void UpdateRows(const core::ChildViewChange& change) {
+    auto row = static_cast<int>(change.row);
+    auto is_pre = change.call_point == core::ListenerCallPoint::kPre;
+    switch (change.type) {
+      case core::ChildViewChange::Type::kInsert:
+        if (is_pre)
+          self->beginInsertRows(QModelIndex(), row, row);
+        else
+          self->endInsertRows();
+        break;
+      case core::ChildViewChange::Type::kRemove:
+        if (is_pre) {
+          row_objects.erase(view->NameAt(change.row));
+          self->beginRemoveRows(QModelIndex(), row, row);
+        } else {
+          self->endRemoveRows();
+        }
+        break;
+      case core::ChildViewChange::Type::kMove:
+        if (is_pre) {
+          auto dest_row = static_cast<int>(change.dest_row);
+          self->beginMoveRows(QModelIndex(), row, row, QModelIndex(),
+                              dest_row > row ? dest_row + 1 : dest_row);
+        } else {
+          self->endMoveRows();
+        }
+        break;
+      case core::ChildViewChange::Type::kUpdate:
+        EmitRowChanged(row);
+        break;
+      case core::ChildViewChange::Type::kReset:
+        if (is_pre) {
+          self->beginResetModel();
+        } else {
+          row_objects.clear();
+          self->endResetModel();
+        }
+        break;
+    }
+  }
+  // Values shown in the columns but not used by the view
+  void ConnectValueListener() {
+    core::ListenerFilter filter;
+    filter.command_type_mask =
+        static_cast<unsigned int>(core::CommandType::kValueUpdateType);
+    filter.path_prefix = root_obj->Path();
+    for (auto& col_info : col_info_list)
+      if (col_info.SourceType() == SourceTypeConst::kValue)
+        filter.keys.insert(col_info.SourceName().toStdString());
+    value_connection.disconnect();
+    if (filter.keys.empty())
+      return;
+    value_connection = listen_target->AddListener([this](auto& cmd) {
+        if (cmd.ObjPath().ParentPath() != root_obj->Path())
+          return;
+        auto row = view->RowOf(cmd.ObjPath().LeafName());
+        if (row != core::ChildView::npos)
+          EmitRowChanged(static_cast<int>(row));
+      }, filter, core::ListenerCallPoint::kPost);
+  }
+  void EmitRowChanged(int row) {
+    if (col_info_list.empty())
+      return;
+    emit self->dataChanged(self->index(row, 0),
+                           self->index(row, col_info_list.size() - 1));
+  }
+  // Child objects are opened when their rows are shown first
+  core::DObjectSp RowObject(int row) {
+    auto& name = view->NameAt(static_cast<size_t>(row));
+    auto& obj = row_objects[name];
+    if (!obj || obj->IsExpired())
+      obj = root_obj->OpenChild(name);
+    return obj;
+  }
+  core::DObjectSp root_obj;
+  core::DObjectSp listen_target;
+  std::unique_ptr<core::ChildView> view;
+  QList<ColumnInfo> col_info_list;
+  std::unordered_map<std::string, core::DObjectSp> row_objects;
+  boost::signals2::scoped_connection view_connection;
+  boost::signals2::scoped_connection value_connection;
+  ChildViewTableModel* self;
+};
+
+ChildViewTableModel::ChildViewTableModel(const core::DObjectSp& root_obj,
+                                         const core::DObjectSp& listen_to,
+                                         QObject* parent)
+    : QAbstractTableModel(parent), impl_(std::make_unique<Impl>(this)) {
+  impl_->root_obj = root_obj;
+  impl_->listen_target = listen_to;
+  if (!impl_->listen_target)
+    impl_->listen_target = root_obj;
+  impl_->view = std::make_unique<core::ChildView>(
+      root_obj, impl_->listen_target);
+  impl_->view_connection = impl_->view->AddListener([this](auto& change) {
+      this->impl_->UpdateRows(change);
+    });
+}
+
+ChildViewTableModel::~ChildViewTableModel() = default;
+
+void ChildViewTableModel::InsertColumns(
+    int col, const QList<ColumnInfo>& col_info_list) {
+  beginInsertColumns(QModelIndex(), col, col + col_info_list.size() - 1);
+  for (auto& col_info : col_info_list) {
+    impl_->col_info_list.insert(col, col_info);
+    ++ col;
+  }
+  endInsertColumns();
+  impl_->ConnectValueListener();
+}
+
+void ChildViewTableModel::RemoveColumns(int first, int last) {
+  beginRemoveColumns(QModelIndex(), first, last);
+  while (last >= first) {
+    impl_->col_info_list.removeAt(first);
+    last --;
+  }
+  endRemoveColumns();
+  impl_->ConnectValueListener();
+}
+
+core::ChildView& ChildViewTableModel::View() const {
+  return *impl_->view;
+}
+
+QModelIndex ChildViewTableModel::ObjectToIndex(
+    const core::DObjectSp& obj) const {
+  if (obj->Path().ParentPath() != impl_->root_obj->Path())
+    return QModelIndex();
+  auto row = impl_->view->RowOf(obj->Name());
+  if (row == core::ChildView::npos)
+    return QModelIndex();
+  return index(static_cast<int>(row), 0, QModelIndex());
+}
+
+core::DObjectSp ChildViewTableModel::IndexToObject(
+    const QModelIndex& index) const {
+  if (!index.isValid())
+    return impl_->root_obj;
+  if (index.row() >= rowCount())
+    return nullptr;
+  return impl_->RowObject(index.row());
+}
+
+int ChildViewTableModel::rowCount(const QModelIndex& parent) const {
+  if (parent.isValid())
+    return 0;
+  return static_cast<int>(impl_->view->Size());
+}
+
+int ChildViewTableModel::columnCount(const QModelIndex&) const {
+  return impl_->col_info_list.size();
+}
+
+QVariant ChildViewTableModel::headerData(
+    int section, Qt::Orientation orient, int role) const {
+  if (role != Qt::DisplayRole || orient == Qt::Vertical)
+    return QAbstractTableModel::headerData(section, orient, role);
+  return impl_->col_info_list[section].ColumnName();
+}
+
+QVariant ChildViewTableModel::data(const QModelIndex& index, int role) const {
+  auto obj = impl_->RowObject(index.row());
+  return impl_->col_info_list[index.column()].GetData(obj, role);
+}
+
+Qt::ItemFlags ChildViewTableModel::flags(const QModelIndex& index) const {
+  auto obj = impl_->RowObject(index.row());
+  return impl_->col_info_list[index.column()].GetFlags(obj);
+}
+
+bool ChildViewTableModel::setData(
+    const QModelIndex& index, const QVariant& value, int role) {
+  // A separate editable handle, so that the cached ones don't keep the
+  // write locks
+  auto obj = impl_->root_obj->OpenChild(
+      impl_->view->NameAt(static_cast<size_t>(index.row())),
+      core::OpenMode::kEditable);
+  return impl_->col_info_list[index.column()].SetData(obj, value, role);
+}
+
+void ChildViewTableModel::sort(int column, Qt::SortOrder order) {
+  if (column < 0 || column >= impl_->col_info_list.size()) {
+    impl_->view->SetSortKeys({});
+    return;
+  }
+  auto& col_info = impl_->col_info_list[column];
+  if (col_info.SourceType() != SourceTypeConst::kValue) {
+    impl_->view->SetSortKeys({});
+    return;
+  }
+  core::ChildView::SortKey sort_key;
+  sort_key.key = col_info.SourceName().toStdString();
+  sort_key.ascending = order == Qt::AscendingOrder;
+  impl_->view->SetSortKeys({sort_key});
+}
+
+}  // namespace qt
+
+}  // namespace dino
@@ -0,0 +1,59 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <QAbstractTableModel>
+#include <QList>
+#include <memory>
+
+#include "dino/core/fwd.h"
+#include "dino/qt/columninfo.h"
+
+namespace dino {
+
+namespace core {
+
+class ChildView;
+
+}  // namespace core
+
+namespace qt {
+
+// Table of the children of an object, sorted and filtered by a
+// core::ChildView instead of a QSortFilterProxyModel. Sorting by a value
+// column or filtering reads the values once per child, and the rows are
+// moved by the view when the values are changed.
+class ChildViewTableModel : public QAbstractTableModel {
+  Q_OBJECT
+ public:
+  ChildViewTableModel(const core::DObjectSp& root_obj,
+                      const core::DObjectSp& listen_to = nullptr,
+                      QObject* parent = nullptr);
+  virtual ~ChildViewTableModel();
+  virtual void InsertColumns(int col, const QList<ColumnInfo>& col_info_list);
+  virtual void RemoveColumns(int first, int last);
+  // Filter is set through the view
+  core::ChildView& View() const;
+  QModelIndex ObjectToIndex(const core::DObjectSp& obj) const;
+  core::DObjectSp IndexToObject(const QModelIndex& index) const;
+  virtual int rowCount(const QModelIndex& parent = QModelIndex()) const;
+  virtual int columnCount(const QModelIndex& parent = QModelIndex()) const;
+  virtual QVariant headerData(
+      int section, Qt::Orientation orient, int role) const;
+  virtual QVariant data(
+     const QModelIndex& index, int role = Qt::DisplayRole) const;
+  virtual Qt::ItemFlags flags(const QModelIndex& index) const;
+  virtual bool setData(const QModelIndex& index, const QVariant& value,
+                       int role = Qt::EditRole);
+  // Value columns are sorted by the value, and the others by the name
+  virtual void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace qt
+
+}  // namespace dino
@@ -3,6 +3,13 @@
 
 #include "dino/qt/dobjectkeyvaluetablemodel.h"
 
+#include <QTimer>
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include "dino/core/dobject.h"
 
 namespace dino {
@@ -117,74 +124,140 @@ class DObjectKeyValueTableModel::Impl {
   }
 
   void PreUpdate(const dino::core::Command& cmd) {
-    std::vector<std::string> keys;
-    int row;
+    // Values of the bases are notified with the path of root_obj
+    if (cmd.ObjPath() != root_obj->Path())
+      return;
     switch (cmd.Type()) {
       case core::CommandType::kValueAdd:
-        keys = root_obj->Keys();
-        if (std::find(keys.begin(), keys.end(), cmd.Key()) == keys.end()) {
-          keys.push_back(cmd.Key());
-          std::sort(keys.begin(), keys.end());
-          row = std::distance(keys.begin(),
-                              std::find(keys.begin(), keys.end(), cmd.Key()));
-          self->beginInsertRows(QModelIndex(), row, row);
-          row_count_changing = true;
+        if (key_rows.count(cmd.Key()) == 0) {
+          FlushDataChanged();
+          changing_row = static_cast<int>(std::distance(
+              keys.begin(),
+              std::lower_bound(keys.begin(), keys.end(), cmd.Key())));
+          self->beginInsertRows(QModelIndex(), changing_row, changing_row);
         }
         break;
       case core::CommandType::kValueDelete:
         if (!root_obj->HasNonLocalKey(cmd.Key())) {
-          keys = root_obj->Keys();
-          row = std::distance(keys.begin(),
-                              std::find(keys.begin(), keys.end(), cmd.Key()));
-          self->beginRemoveRows(QModelIndex(), row, row);
-          row_count_changing = true;
+          auto itr = key_rows.find(cmd.Key());
+          if (itr == key_rows.end())
+            break;
+          FlushDataChanged();
+          changing_row = itr->second;
+          self->beginRemoveRows(QModelIndex(), changing_row, changing_row);
+        }
+        break;
+      case core::CommandType::kValuesUpdate:
+        for (auto& key : cmd.Keys()) {
+          auto is_added = cmd.PrevValues().count(key) == 0
+                          && key_rows.count(key) == 0;
+          auto is_removed = cmd.NewValues().count(key) == 0
+                            && !root_obj->HasNonLocalKey(key);
+          if (is_added || is_removed) {
+            FlushDataChanged();
+            self->beginResetModel();
+            is_resetting = true;
+            break;
+          }
         }
         break;
       case core::CommandType::kAddBaseObject:
       case core::CommandType::kRemoveBaseObject:
+        FlushDataChanged();
         self->beginResetModel();
+        is_resetting = true;
         break;
       default:
         break;
     }
   }
   void PostUpdate(const dino::core::Command& cmd) {
-    bool need_data_changed_signal = false;
+    if (cmd.ObjPath() != root_obj->Path())
+      return;
     switch (cmd.Type()) {
       case core::CommandType::kValueAdd:
-        if (row_count_changing) {
+        if (changing_row >= 0) {
+          keys.insert(keys.begin() + changing_row, cmd.Key());
+          UpdateKeyRows(changing_row);
+          changing_row = -1;
           self->endInsertRows();
-          row_count_changing = false;
         } else {
-          need_data_changed_signal = true;
+          AddChangedKey(cmd.Key());
         }
         break;
       case core::CommandType::kValueDelete:
-        if (row_count_changing) {
+        if (changing_row >= 0) {
+          key_rows.erase(cmd.Key());
+          keys.erase(keys.begin() + changing_row);
+          UpdateKeyRows(changing_row);
+          changing_row = -1;
           self->endRemoveRows();
-          row_count_changing = false;
         } else {
-          need_data_changed_signal = true;
+          AddChangedKey(cmd.Key());
         }
         break;
       case core::CommandType::kValueUpdate:
-        need_data_changed_signal = true;
+        AddChangedKey(cmd.Key());
+        break;
+      case core::CommandType::kValuesUpdate:
+        if (is_resetting) {
+          ReloadKeys();
+          is_resetting = false;
+          self->endResetModel();
+        } else {
+          for (auto& key : cmd.Keys())
+            AddChangedKey(key);
+        }
         break;
       case core::CommandType::kAddBaseObject:
       case core::CommandType::kRemoveBaseObject:
+        ReloadKeys();
+        is_resetting = false;
         self->endResetModel();
         break;
       default:
         break;
     }
-    if (need_data_changed_signal) {
-      auto keys = root_obj->Keys();
-      auto row = std::distance(keys.begin(),
-                               std::find(keys.begin(), keys.end(), cmd.Key()));
-      emit self->dataChanged(self->createIndex(row, 0),
-                             self->createIndex(row, col_id_list.count() - 1));
+  }
+
+  void ReloadKeys() {
+    keys = root_obj->Keys();
+    std::sort(keys.begin(), keys.end());
+    key_rows.clear();
+    UpdateKeyRows(0);
+  }
+  void UpdateKeyRows(int first_row) {
+    for (auto row = first_row; row < static_cast<int>(keys.size()); ++ row)
+      key_rows[keys[row]] = row;
+  }
+  // The rows changed by a series of commands are notified at once when
+  // the control returns to the event loop, or before the rows are
+  // inserted or removed
+  void AddChangedKey(const std::string& key) {
+    auto itr = key_rows.find(key);
+    if (itr == key_rows.end())
+      return;
+    first_changed_row = std::min(first_changed_row, itr->second);
+    last_changed_row = std::max(last_changed_row, itr->second);
+    if (!is_flush_scheduled) {
+      is_flush_scheduled = true;
+      QTimer::singleShot(0, self, [this]() {
+          is_flush_scheduled = false;
+          FlushDataChanged();
+        });
     }
   }
+  void FlushDataChanged() {
+    if (last_changed_row < 0)
+      return;
+    auto first_row = first_changed_row;
+    auto last_row = last_changed_row;
+    first_changed_row = std::numeric_limits<int>::max();
+    last_changed_row = -1;
+    emit self->dataChanged(self->createIndex(first_row, 0),
+                           self->createIndex(last_row,
+                                             col_id_list.count() - 1));
+  }
 
   DObjectKeyValueTableModel* self;
   core::DObjectSp root_obj;
@@ -196,7 +269,14 @@ class DObjectKeyValueTableModel::Impl {
   QMap<int, ColInfo> id_to_col_info;
   QList<int> col_id_list;
 
-  bool row_count_changing = false;
+  // Keys of root_obj in the order of the rows
+  std::vector<std::string> keys;
+  std::unordered_map<std::string, int> key_rows;
+  int changing_row = -1;
+  bool is_resetting = false;
+  int first_changed_row = std::numeric_limits<int>::max();
+  int last_changed_row = -1;
+  bool is_flush_scheduled = false;
   bool editable = false;
 };
 
@@ -210,6 +290,7 @@ DObjectKeyValueTableModel::DObjectKeyValueTableModel(
   impl_->listen_target = listen_to;
   if (!impl_->listen_target)
     impl_->listen_target = root_obj;
+  impl_->ReloadKeys();
   impl_->listen_target->AddListener([this](auto& cmd) {
       this->impl_->PreUpdate(cmd);
     }, dino::core::ListenerCallPoint::kPre);
@@ -250,14 +331,14 @@ int DObjectKeyValueTableModel::columnCount(const QModelIndex& parent) const {
 int DObjectKeyValueTableModel::rowCount(const QModelIndex& parent) const {
   Q_UNUSED(parent);
   if (!parent.isValid())
-    return static_cast<int>(impl_->root_obj->Keys().size());
+    return static_cast<int>(impl_->keys.size());
   else
     return 0;
 }
 
 QVariant DObjectKeyValueTableModel::data(
     const QModelIndex& index, int role) const {
-  auto key = impl_->root_obj->Keys()[index.row()];
+  auto& key = impl_->keys[index.row()];
   auto col_id = impl_->ColumnToID(index.column());
   if (role == Qt::DisplayRole || role == Qt::EditRole) {
     switch (col_id) {
@@ -293,7 +374,7 @@ bool DObjectKeyValueTableModel::setData(
   auto col_type = impl_->ColumnToID(index.column());
   if (col_type != ColumnID::kValueColumnID)
     return false;
-  auto key = impl_->root_obj->Keys()[index.row()];
+  auto key = impl_->keys[index.row()];
   impl_->root_obj->Put(key, impl_->string_to_value_func(value.toString()));
   return true;
 }
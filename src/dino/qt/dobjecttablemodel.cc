@@ -4,6 +4,8 @@
 #include "dino/qt/dobjecttablemodel.h"
 
 #include <QList>
+#include <algorithm>
+#include <vector>
 
 #include "dino/core/session.h"
 #include "dino/core/dobject.h"
@@ -12,42 +14,35 @@ namespace dino {
 
 namespace qt {
 
+namespace {
+
+const int kDefaultFetchSize = 256;
+
+}  // namespace
+
 class DObjectTableModel::Impl {
  public:
   Impl(DObjectTableModel* self) : self(self) {}
   ~Impl() = default;
+  // Only the children of the root object are the rows
   void PreUpdate(const dino::core::Command& cmd) {
-    auto session = root_obj->GetSession();
-    auto obj = session->OpenObject(cmd.ObjPath());
+    auto is_root = cmd.ObjPath() == root_obj->Path();
     switch (cmd.Type()) {
       case core::CommandType::kAddBaseObject:
       case core::CommandType::kRemoveBaseObject:
         self->beginResetModel();
         break;
-      case core::CommandType::kAddChild:
-      case core::CommandType::kAddFlattenedChild: {
-        auto child_name = cmd.TargetObjectName();
-        auto children = obj->Children();
-        auto index = self->ObjectToIndex(obj);
-        auto row = std::distance(
-            children.cbegin(),
-            std::find_if(
-                children.cbegin(), children.cend(),
-                [child_name](auto& obj_info) {
-                  return obj_info.Name() < child_name;}));
-        self->beginInsertRows(index, row, row);
-        break;
-      }
       case core::CommandType::kDeleteChild: {
-        auto child_name = cmd.TargetObjectName();
-        auto children = cmd.PrevChildren();
-        auto index = self->ObjectToIndex(obj);
-        auto row = std::distance(
-            children.cbegin(),
-            std::find_if(
-                children.cbegin(), children.cend(),
-                [child_name](auto& obj) { return obj.Name() == child_name; }));
-        self->beginRemoveRows(index, row, row);
+        if (!is_root)
+          break;
+        auto row = static_cast<int>(
+            root_obj->ChildIndex(cmd.TargetObjectName()));
+        if (row >= num_fetched_rows) {
+          pending_rows.push_back(-1);
+          break;
+        }
+        pending_rows.push_back(row);
+        self->beginRemoveRows(QModelIndex(), row, row);
         break;
       }
       default:
@@ -57,32 +52,100 @@ class DObjectTableModel::Impl {
   void PostUpdate(const dino::core::Command& cmd) {
     auto session = root_obj->GetSession();
     auto obj = session->OpenObject(cmd.ObjPath());
+    auto is_root = cmd.ObjPath() == root_obj->Path();
     switch (cmd.Type()) {
       case core::CommandType::kValueAdd:
       case core::CommandType::kValueUpdate:
       case core::CommandType::kValueDelete: {
         auto col = KeyToCol(cmd.Key());
         auto index = self->ObjectToIndex(obj);
-        if (col < self->columnCount(index))
+        if (index.isValid() && col < self->columnCount(index))
           emit self->dataChanged(index.sibling(index.row(), col),
                                  index.sibling(index.row(), col));
         break;
       }
+      case core::CommandType::kValuesUpdate: {
+        auto index = self->ObjectToIndex(obj);
+        if (!index.isValid())
+          break;
+        auto col_count = self->columnCount(index);
+        auto first_col = col_count;
+        auto last_col = -1;
+        for (auto& key : cmd.Keys()) {
+          auto col = KeyToCol(key);
+          if (col >= col_count)
+            continue;
+          first_col = std::min(first_col, col);
+          last_col = std::max(last_col, col);
+        }
+        if (last_col >= 0)
+          emit self->dataChanged(index.sibling(index.row(), first_col),
+                                 index.sibling(index.row(), last_col));
+        break;
+      }
       case core::CommandType::kAddBaseObject:
       case core::CommandType::kRemoveBaseObject:
+        ResetRows();
         self->endResetModel();
         break;
       case core::CommandType::kAddChild:
-      case core::CommandType::kAddFlattenedChild:
+      case core::CommandType::kAddFlattenedChild: {
+        if (!is_root)
+          break;
+        // The row is known after the child is put in the sorted list, and
+        // the rows of the model aren't changed until here
+        auto row = static_cast<int>(
+            root_obj->ChildIndex(cmd.TargetObjectName()));
+        auto prev_child_count = static_cast<int>(root_obj->ChildCount()) - 1;
+        // Rows after the fetched ones appear when they are fetched
+        if (row > num_fetched_rows
+            || (row == num_fetched_rows
+                && num_fetched_rows < prev_child_count))
+          break;
+        self->beginInsertRows(QModelIndex(), row, row);
+        row_cache.insert(row_cache.begin() + row, nullptr);
+        num_fetched_rows ++;
         self->endInsertRows();
         break;
-      case core::CommandType::kDeleteChild:
+      }
+      case core::CommandType::kDeleteChild: {
+        if (!is_root)
+          break;
+        auto row = PopPendingRow();
+        if (row < 0)
+          break;
+        row_cache.erase(row_cache.begin() + row);
+        num_fetched_rows --;
         self->endRemoveRows();
         break;
+      }
       default:
         break;
     }
   }
+  int PopPendingRow() {
+    if (pending_rows.empty())
+      return -1;
+    auto row = pending_rows.back();
+    pending_rows.pop_back();
+    return row;
+  }
+  // Child objects are opened when their rows are shown first. The rows
+  // may be behind the child list while it's updated, so the cached object
+  // is used only if it's the child at the row.
+  core::DObjectSp RowObject(int row) {
+    auto& obj = row_cache[row];
+    auto name = root_obj->ChildAt(row).Name();
+    if (!obj || obj->IsExpired() || obj->Name() != name)
+      obj = root_obj->OpenChild(name);
+    return obj;
+  }
+  void ResetRows() {
+    row_cache.clear();
+    num_fetched_rows = std::min(
+        fetch_size, static_cast<int>(root_obj->ChildCount()));
+    row_cache.resize(num_fetched_rows);
+  }
   int KeyToCol(const std::string& key_) {
     auto key = QString::fromStdString(key_);
     int col = 0;
@@ -96,6 +159,11 @@ class DObjectTableModel::Impl {
   core::DObjectSp root_obj;
   core::DObjectSp listen_target;
   QList<ColumnInfo> col_info_list;
+  std::vector<core::DObjectSp> row_cache;
+  int num_fetched_rows = 0;
+  int fetch_size = kDefaultFetchSize;
+  // Rows notified by the pre-update listener, or -1 if not notified
+  std::vector<int> pending_rows;
   DObjectTableModel* self;
 };
 
@@ -107,6 +175,7 @@ DObjectTableModel::DObjectTableModel(const core::DObjectSp& root_obj,
   impl_->listen_target = listen_to;
   if (!impl_->listen_target)
     impl_->listen_target = root_obj;
+  impl_->ResetRows();
   impl_->listen_target->AddListener([this](auto& cmd) {
       this->impl_->PreUpdate(cmd);
     }, dino::core::ListenerCallPoint::kPre);
@@ -144,27 +213,30 @@ QModelIndex DObjectTableModel::ObjectToIndex(const core::DObjectSp& obj) const {
     child = child->Parent();
   if (!child->Parent())
     return QModelIndex();
-  auto children = impl_->root_obj->Children();
-  auto target_name = obj->Name();
-  auto row = std::distance(
-      children.cbegin(),
-      std::find_if(children.cbegin(), children.cend(),
-                   [&target_name](auto& obj_info) {
-                     return obj_info.Name() == target_name;} ));
-  return index(row, 0, QModelIndex());
+  auto row = impl_->root_obj->ChildIndex(child->Name());
+  return index(static_cast<int>(row), 0, QModelIndex());
 }
 
 core::DObjectSp DObjectTableModel::IndexToObject(const QModelIndex& index) const {
   if (!index.isValid())
     return impl_->root_obj;
-  auto children = impl_->root_obj->Children();
-  if (index.row() >= static_cast<int>(children.size()))
+  if (index.row() >= impl_->num_fetched_rows)
     return nullptr;
-  return impl_->root_obj->OpenChild(children[index.row()].Name());
+  return impl_->RowObject(index.row());
+}
+
+void DObjectTableModel::SetFetchSize(int fetch_size) {
+  impl_->fetch_size = std::max(fetch_size, 1);
+}
+
+int DObjectTableModel::FetchSize() const {
+  return impl_->fetch_size;
 }
 
-int DObjectTableModel::rowCount(const QModelIndex&) const {
-  return impl_->root_obj->ChildCount();
+int DObjectTableModel::rowCount(const QModelIndex& parent) const {
+  if (parent.isValid())
+    return 0;
+  return impl_->num_fetched_rows;
 }
 
 int DObjectTableModel::columnCount(const QModelIndex&) const {
@@ -181,25 +253,50 @@ QVariant DObjectTableModel::headerData(
 }
 
 QVariant DObjectTableModel::data(const QModelIndex& index, int role) const {
-  auto obj = impl_->root_obj->GetChildAt(index.row());
+  auto obj = impl_->RowObject(index.row());
   auto col_info = impl_->col_info_list[index.column()];
   return col_info.GetData(obj, role);
 }
 
 Qt::ItemFlags DObjectTableModel::flags(const QModelIndex& index) const {
-  auto obj = impl_->root_obj->GetChildAt(index.row());
+  auto obj = impl_->RowObject(index.row());
   auto col_info = impl_->col_info_list[index.column()];
   return col_info.GetFlags(obj);
 }
 
 bool DObjectTableModel::setData(
     const QModelIndex& index, const QVariant& value, int role) {
-  auto obj = impl_->root_obj->GetChildAt(index.row());
+  // A separate editable handle, so that the cached ones don't keep the
+  // write locks
+  auto obj = impl_->root_obj->OpenChild(impl_->RowObject(index.row())->Name());
   obj->SetEditable();
   auto col_info = impl_->col_info_list[index.column()];
   return col_info.SetData(obj, value, role);
 }
 
+bool DObjectTableModel::canFetchMore(const QModelIndex& parent) const {
+  if (parent.isValid())
+    return false;
+  return impl_->num_fetched_rows
+      < static_cast<int>(impl_->root_obj->ChildCount());
+}
+
+void DObjectTableModel::fetchMore(const QModelIndex& parent) {
+  if (parent.isValid())
+    return;
+  auto num_rows = std::min(
+      impl_->fetch_size,
+      static_cast<int>(impl_->root_obj->ChildCount())
+      - impl_->num_fetched_rows);
+  if (num_rows <= 0)
+    return;
+  auto first = impl_->num_fetched_rows;
+  beginInsertRows(QModelIndex(), first, first + num_rows - 1);
+  impl_->num_fetched_rows += num_rows;
+  impl_->row_cache.resize(impl_->num_fetched_rows);
+  endInsertRows();
+}
+
 }  // namespace qt
 
 }  // namespace dino
@@ -27,6 +27,9 @@ class DObjectTableModel : public QAbstractTableModel {
   virtual void RemoveColumns(int first, int last);
   QModelIndex ObjectToIndex(const core::DObjectSp& obj) const;
   core::DObjectSp IndexToObject(const QModelIndex& index) const;
+  // Rows are fetched by blocks of this size
+  void SetFetchSize(int fetch_size);
+  int FetchSize() const;
   virtual int rowCount(const QModelIndex& parent = QModelIndex()) const;
   virtual int columnCount(const QModelIndex& parent = QModelIndex()) const;
   virtual QVariant headerData(
@@ -36,6 +39,8 @@ class DObjectTableModel : public QAbstractTableModel {
   virtual Qt::ItemFlags flags(const QModelIndex& index) const;
   virtual bool setData(const QModelIndex& index, const QVariant& value,
                        int role = Qt::EditRole);
+  virtual bool canFetchMore(const QModelIndex& parent) const;
+  virtual void fetchMore(const QModelIndex& parent);
 
  private:
   class Impl;
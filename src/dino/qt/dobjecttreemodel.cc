@@ -3,6 +3,10 @@
 
 #include "dino/qt/dobjecttreemodel.h"
 
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
 #include "dino/core/command.h"
 #include "dino/core/session.h"
 #include "dino/core/dobject.h"
@@ -11,29 +15,19 @@ namespace dino {
 
 namespace qt {
 
-namespace {
-
-core::DObjectSp GetObjectAt(const core::DObjectSp& obj, int row) {
-  auto children = obj->Children();
-  if (row >= static_cast<int>(children.size()))
-    return nullptr;
-  return obj->OpenChild(children[row].Name());
-}
-
-int GetRow(const core::DObjectSp& obj, const core::DObjectSp& child) {
-  auto child_info_list = obj->Children();
-  auto target_name = child->Name();
-  return std::distance(
-      child_info_list.cbegin(),
-      std::find_if(child_info_list.cbegin(), child_info_list.cend(),
-                   [&target_name](auto& child_info) {
-                     return target_name == child_info.Name(); }));
-}
-
-}  // namespace
-
 class DObjectTreeModel::Impl {
  public:
+  // Objects shown in the model. Nodes are added when their indexes are
+  // made first, and are updated by the child list changes.
+  struct Node {
+    core::DObjectSp obj;
+    uintptr_t parent_id = 0;
+    int row = -1;
+    // Ids of the children by row, 0 for the ones not opened yet
+    std::vector<uintptr_t> child_ids;
+    bool is_child_ids_listed = false;
+  };
+
   Impl(DObjectTreeModel* self) : self(self) {}
   ~Impl() = default;
   void PreUpdate(const core::Command& cmd) {
@@ -44,11 +38,11 @@ class DObjectTreeModel::Impl {
         break;
       case core::CommandType::kAddChild:
       case core::CommandType::kAddFlattenedChild: {
-        auto session = root_obj->GetSession();
-        auto obj = session->OpenObject(cmd.ObjPath());
+        // Children of the objects not shown yet don't need notifications
+        auto parent_id = OpenedNodeId(cmd.ObjPath());
+        if (parent_id == 0)
+          break;
         auto child_name = cmd.TargetObjectName();
-        auto children = cmd.PrevChildren();
-        auto index = self->ObjectToIndex(obj);
         bool already_exists = false;
         int row = 0;
         for (auto& child_info : cmd.PrevChildren()) {
@@ -62,24 +56,27 @@ class DObjectTreeModel::Impl {
         }
         if (!already_exists) {
           inserting_row = row;
-          parent_of_inserting_row = index;
-          self->beginInsertRows(index, row, row);
+          parent_of_inserting_row = NodeIndex(parent_id);
+          parent_id_of_changing_row = parent_id;
+          self->beginInsertRows(parent_of_inserting_row, row, row);
         }
         break;
       }
       case core::CommandType::kDeleteChild: {
-        auto session = root_obj->GetSession();
-        auto obj = session->OpenObject(cmd.ObjPath());
+        auto parent_id = OpenedNodeId(cmd.ObjPath());
+        if (parent_id == 0)
+          break;
         auto child_name = cmd.TargetObjectName();
-        auto children = cmd.PrevChildren();
-        auto index = self->ObjectToIndex(obj);
-        auto row = std::distance(
+        auto& children = cmd.PrevChildren();
+        auto row = static_cast<int>(std::distance(
             children.cbegin(),
             std::find_if(
                 children.cbegin(), children.cend(),
                 [&child_name](auto& obj_info) {
-                  return obj_info.Name() == child_name; }));
-        self->beginRemoveRows(index, row, row);
+                  return obj_info.Name() == child_name; })));
+        removing_row = row;
+        parent_id_of_changing_row = parent_id;
+        self->beginRemoveRows(NodeIndex(parent_id), row, row);
         break;
       }
       default:
@@ -91,39 +88,54 @@ class DObjectTreeModel::Impl {
       case core::CommandType::kValueAdd:
       case core::CommandType::kValueUpdate:
       case core::CommandType::kValueDelete: {
-        auto session = root_obj->GetSession();
-        auto obj = session->OpenObject(cmd.ObjPath());
+        auto index = NodeIndex(OpenedNodeId(cmd.ObjPath()));
+        if (!index.isValid())
+          break;
         auto col = KeyToCol(cmd.Key());
-        auto index = self->ObjectToIndex(obj);
         if (col < self->columnCount(index))
           emit self->dataChanged(index.sibling(index.row(), col),
                                  index.sibling(index.row(), col));
         break;
       }
+      case core::CommandType::kValuesUpdate: {
+        auto index = NodeIndex(OpenedNodeId(cmd.ObjPath()));
+        if (!index.isValid())
+          break;
+        auto col_count = self->columnCount(index);
+        auto first_col = col_count;
+        auto last_col = -1;
+        for (auto& key : cmd.Keys()) {
+          auto col = KeyToCol(key);
+          if (col >= col_count)
+            continue;
+          first_col = std::min(first_col, col);
+          last_col = std::max(last_col, col);
+        }
+        if (last_col >= 0)
+          emit self->dataChanged(index.sibling(index.row(), first_col),
+                                 index.sibling(index.row(), last_col));
+        break;
+      }
       case core::CommandType::kAddBaseObject:
       case core::CommandType::kRemoveBaseObject:
+        ResetNodes();
         self->endResetModel();
         break;
       case core::CommandType::kAddChild:
       case core::CommandType::kAddFlattenedChild:
         {
           if (inserting_row >= 0) {
+            InsertChildRow(parent_id_of_changing_row, inserting_row);
             self->endInsertRows();
-            auto session = root_obj->GetSession();
-            auto children = session->OpenObject(cmd.ObjPath())->Children();
-            auto row= std::distance(
-                children.cbegin(),
-                std::find_if(
-                    children.cbegin(), children.cend(),
-                    [cmd](auto& child_info) {
-                      return child_info.Name() == cmd.TargetObjectName();
-                    }));
+            auto& obj = nodes[parent_id_of_changing_row].obj;
+            auto row = static_cast<int>(
+                obj->ChildIndex(cmd.TargetObjectName()));
             if (inserting_row != row) {
-              if (row > inserting_row)
-                row ++;
+              auto dest_row = row > inserting_row ? row + 1 : row;
               self->beginMoveRows(
                   parent_of_inserting_row, inserting_row, inserting_row,
-                  parent_of_inserting_row, row);
+                  parent_of_inserting_row, dest_row);
+              MoveChildRow(parent_id_of_changing_row, inserting_row, row);
               self->endMoveRows();
             }
           }
@@ -131,7 +143,11 @@ class DObjectTreeModel::Impl {
         }
         break;
       case core::CommandType::kDeleteChild:
-        self->endRemoveRows();
+        if (removing_row >= 0) {
+          RemoveChildRow(parent_id_of_changing_row, removing_row);
+          self->endRemoveRows();
+        }
+        removing_row = -1;
         break;
       default:
         break;
@@ -147,25 +163,132 @@ class DObjectTreeModel::Impl {
     }
     return col;
   }
-  QModelIndex GetIndexFromRoute(
-      std::vector<core::DObjectSp>& route, const QModelIndex& current) {
-    if (route.empty())
-      return current;
-    auto target = route.back();
-    route.pop_back();
-    for (int row = 0; row < self->rowCount(current); ++ row) {
-      auto child_index = self->index(row, 0, current);
-      if (child_index.internalId() == target->ObjectId())
-        return GetIndexFromRoute(route, child_index);
+
+  Node* FindNode(uintptr_t id) {
+    auto itr = nodes.find(id);
+    return itr == nodes.end() ? nullptr : &itr->second;
+  }
+  Node* NodeOf(const QModelIndex& index) {
+    if (!index.isValid())
+      return FindNode(root_id);
+    return FindNode(index.internalId());
+  }
+  QModelIndex NodeIndex(uintptr_t id) {
+    if (id == 0 || id == root_id)
+      return QModelIndex();
+    return self->createIndex(nodes[id].row, 0, id);
+  }
+  // Returns 0 if the object isn't in the model yet
+  uintptr_t OpenedNodeId(const core::DObjPath& obj_path) {
+    auto itr = path_ids.find(obj_path);
+    return itr == path_ids.end() ? 0 : itr->second;
+  }
+  // Adds the nodes from the nearest ancestor in the model. Returns 0 if
+  // the object isn't under the root.
+  uintptr_t AddNode(const core::DObjectSp& obj) {
+    auto id = obj->ObjectId();
+    if (nodes.count(id))
+      return id;
+    auto parent = obj->Parent();
+    if (!parent)
+      return 0;
+    auto parent_id = AddNode(parent);
+    if (parent_id == 0)
+      return 0;
+    auto row = static_cast<int>(
+        nodes[parent_id].obj->ChildIndex(obj->Name()));
+    return ChildId(parent_id, row);
+  }
+  void ListChildIds(Node& node) {
+    if (node.is_child_ids_listed)
+      return;
+    node.child_ids.assign(node.obj->ChildCount(), 0);
+    node.is_child_ids_listed = true;
+  }
+  uintptr_t ChildId(uintptr_t parent_id, int row) {
+    auto& parent_node = nodes[parent_id];
+    ListChildIds(parent_node);
+    if (row < 0 || row >= static_cast<int>(parent_node.child_ids.size()))
+      return 0;
+    auto& child_id = parent_node.child_ids[row];
+    if (child_id == 0) {
+      auto child = parent_node.obj->OpenChild(
+          parent_node.obj->ChildAt(row).Name());
+      child_id = child->ObjectId();
+      // References to the elements are kept by the rehash
+      auto& child_node = nodes[child_id];
+      child_node.obj = child;
+      child_node.parent_id = parent_id;
+      child_node.row = row;
+      path_ids[child->Path()] = child_id;
     }
-    return QModelIndex();
+    return child_id;
+  }
+  void UpdateRows(Node& parent_node, int first, int last) {
+    for (auto row = first; row <= last; ++ row) {
+      auto child_id = parent_node.child_ids[row];
+      if (child_id != 0)
+        nodes[child_id].row = row;
+    }
+  }
+  void InsertChildRow(uintptr_t parent_id, int row) {
+    auto parent_node = FindNode(parent_id);
+    if (!parent_node || !parent_node->is_child_ids_listed)
+      return;
+    auto& child_ids = parent_node->child_ids;
+    child_ids.insert(child_ids.begin() + row, 0);
+    UpdateRows(*parent_node, row, static_cast<int>(child_ids.size()) - 1);
+  }
+  void MoveChildRow(uintptr_t parent_id, int from, int to) {
+    auto parent_node = FindNode(parent_id);
+    if (!parent_node || !parent_node->is_child_ids_listed)
+      return;
+    auto& child_ids = parent_node->child_ids;
+    auto child_id = child_ids[from];
+    child_ids.erase(child_ids.begin() + from);
+    child_ids.insert(child_ids.begin() + to, child_id);
+    UpdateRows(*parent_node, std::min(from, to), std::max(from, to));
   }
+  void RemoveChildRow(uintptr_t parent_id, int row) {
+    auto parent_node = FindNode(parent_id);
+    if (!parent_node || !parent_node->is_child_ids_listed)
+      return;
+    auto& child_ids = parent_node->child_ids;
+    RemoveSubtree(child_ids[row]);
+    child_ids.erase(child_ids.begin() + row);
+    UpdateRows(*parent_node, row, static_cast<int>(child_ids.size()) - 1);
+  }
+  void RemoveSubtree(uintptr_t id) {
+    auto node = FindNode(id);
+    if (!node)
+      return;
+    for (auto child_id : node->child_ids)
+      RemoveSubtree(child_id);
+    path_ids.erase(node->obj->Path());
+    nodes.erase(id);
+  }
+  void ResetNodes() {
+    nodes.clear();
+    path_ids.clear();
+    root_id = root_obj->ObjectId();
+    nodes[root_id].obj = root_obj;
+    path_ids[root_obj->Path()] = root_id;
+  }
+
   core::DObjectSp root_obj;
   core::DObjectSp listen_target;
   QList<ColumnInfo> col_info_list;
   DObjectTreeModel* self;
+  std::unordered_map<uintptr_t, Node> nodes;
+  // Ids of the nodes, to find them from the commands without opening the
+  // objects
+  std::unordered_map<core::DObjPath, uintptr_t, core::DObjPath::Hash>
+      path_ids;
+  uintptr_t root_id = 0;
   int inserting_row = -1;
+  int removing_row = -1;
   QModelIndex parent_of_inserting_row;
+  uintptr_t parent_id_of_changing_row = 0;
 };
 
 DObjectTreeModel::DObjectTreeModel(const core::DObjectSp& root_obj,
@@ -176,6 +299,7 @@ DObjectTreeModel::DObjectTreeModel(const core::DObjectSp& root_obj,
   impl_->listen_target = listen_to;
   if (!impl_->listen_target)
     impl_->listen_target = root_obj;
+  impl_->ResetNodes();
   impl_->listen_target->AddListener([this](auto& cmd) {
       this->impl_->PreUpdate(cmd);
     }, core::ListenerCallPoint::kPre);
@@ -219,7 +343,12 @@ int DObjectTreeModel::columnCount(const QModelIndex& /*parent*/) const {
 }
 
 int DObjectTreeModel::rowCount(const QModelIndex& parent) const {
-  return static_cast<int>(IndexToObject(parent)->ChildCount());
+  auto node = impl_->NodeOf(parent);
+  if (!node)
+    return 0;
+  if (node->is_child_ids_listed)
+    return static_cast<int>(node->child_ids.size());
+  return static_cast<int>(node->obj->ChildCount());
 }
 
 QVariant DObjectTreeModel::data(const QModelIndex& index, int role) const {
@@ -240,48 +369,35 @@ bool DObjectTreeModel::setData(
 
 QModelIndex DObjectTreeModel::index(int row, int column,
                                     const QModelIndex& parent) const {
-  auto parent_obj = IndexToObject(parent);
-  auto obj = GetObjectAt(parent_obj, row);
-  if (!obj)
+  if (!impl_->NodeOf(parent))
     return QModelIndex();
-  return createIndex(row, column, obj->ObjectId());
+  auto parent_id = parent.isValid() ? parent.internalId() : impl_->root_id;
+  auto child_id = impl_->ChildId(parent_id, row);
+  if (child_id == 0)
+    return QModelIndex();
+  return createIndex(row, column, child_id);
 }
 
 QModelIndex DObjectTreeModel::parent(const QModelIndex& index) const {
   if (!index.isValid())
     return QModelIndex();
-
-  auto obj = IndexToObject(index);
-  if (obj->ObjectId() == impl_->root_obj->ObjectId())
-    return QModelIndex();
-
-  auto parent_obj = obj->Parent();
-  if (!parent_obj)
+  auto node = impl_->FindNode(index.internalId());
+  if (!node)
     return QModelIndex();
-  if (parent_obj->ObjectId() == impl_->root_obj->ObjectId())
-    return QModelIndex();
-
-  auto grand_parent_obj = parent_obj->Parent();
-  if (!grand_parent_obj)
-    return QModelIndex();
-  auto row = GetRow(grand_parent_obj, parent_obj);
-  return createIndex(row, 0, parent_obj->ObjectId());
+  return impl_->NodeIndex(node->parent_id);
 }
 
 core::DObjectSp DObjectTreeModel::IndexToObject(const QModelIndex& index) const {
   if (!index.isValid())
     return impl_->root_obj;
+  auto node = impl_->FindNode(index.internalId());
+  if (node)
+    return node->obj;
   return impl_->root_obj->GetSession()->GetObjectById(index.internalId());
 }
 
 QModelIndex DObjectTreeModel::ObjectToIndex(const core::DObjectSp& obj) const {
-  std::vector<core::DObjectSp> route_to_root;
-  core::DObjectSp current_obj = obj;
-  while (current_obj && current_obj->ObjectId() != impl_->root_obj->ObjectId()) {
-    route_to_root.push_back(current_obj);
-    current_obj = current_obj->Parent();
-  }
-  return impl_->GetIndexFromRoute(route_to_root, QModelIndex());
+  return impl_->NodeIndex(impl_->AddNode(obj));
 }
 
 core::DObjectSp DObjectTreeModel::RootObject() const {
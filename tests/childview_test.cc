@@ -0,0 +1,224 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#include "dino/core/childview.h"
+
+#include <memory>
+#include <gtest/gtest.h>
+#include <fmt/format.h>
+
+#include "dino/core/session.h"
+#include "dino/core/dobject.h"
+
+namespace dc = dino::core;
+
+namespace {
+
+std::vector<std::string> RowNames(const dc::ChildView& view) {
+  std::vector<std::string> names;
+  for (size_t row = 0; row < view.Size(); ++ row)
+    names.push_back(view.NameAt(row));
+  return names;
+}
+
+dc::DObjectSp CreateTop(const dc::SessionPtr& session) {
+  auto top = session->CreateTopLevelObject("top", "top");
+  const std::vector<int> sizes{30, 10, 50, 20, 40};
+  for (size_t idx = 0; idx < sizes.size(); ++ idx) {
+    auto child = top->CreateChild(fmt::format("c{}", idx), "child");
+    child->Put("size", sizes[idx]);
+    child->Put("kind", idx % 2 == 1 ? "odd" : "even");
+  }
+  return top;
+}
+
+}
+
+class ChildViewTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    session = dc::Session::Create();
+    top = CreateTop(session);
+    top->EnableCommandStack();
+    view = std::make_unique<dc::ChildView>(top);
+    view->AddListener([this](auto& change) {
+        if (change.call_point == dc::ListenerCallPoint::kPost)
+          changes.push_back(change);
+      });
+  }
+
+  dc::SessionPtr session;
+  dc::DObjectSp top;
+  std::unique_ptr<dc::ChildView> view;
+  std::vector<dc::ChildViewChange> changes;
+};
+
+TEST_F(ChildViewTest, Sort) {
+  ASSERT_EQ(RowNames(*view),
+            (std::vector<std::string>{"c0", "c1", "c2", "c3", "c4"}));
+  view->SetSortKeys({{"size", true}});
+  ASSERT_EQ(RowNames(*view),
+            (std::vector<std::string>{"c1", "c3", "c0", "c4", "c2"}));
+  ASSERT_EQ(changes.back().type, dc::ChildViewChange::Type::kReset);
+  view->SetSortKeys({{"kind", true}, {"size", false}});
+  ASSERT_EQ(RowNames(*view),
+            (std::vector<std::string>{"c2", "c4", "c0", "c3", "c1"}));
+  ASSERT_EQ(view->RowOf("c3"), 3u);
+  ASSERT_EQ(view->ObjectAt(0)->Get("size"), 50);
+
+  // Values of different types
+  top->OpenChild("c0", dc::OpenMode::kEditable)->Put("size", "large");
+  top->OpenChild("c1", dc::OpenMode::kEditable)->RemoveKey("size");
+  top->OpenChild("c2", dc::OpenMode::kEditable)->Put("size", 2.5);
+  top->OpenChild("c3", dc::OpenMode::kEditable)->Put("size", true);
+  top->OpenChild("c4", dc::OpenMode::kEditable)->Put(
+      "size", dc::DValueArray{1});
+  view->SetSortKeys({{"size", true}});
+  ASSERT_EQ(RowNames(*view),
+            (std::vector<std::string>{"c1", "c3", "c0", "c2", "c4"}));
+
+  // The keys no longer used don't reach the view
+  view->SetSortKeys({});
+  ASSERT_EQ(RowNames(*view),
+            (std::vector<std::string>{"c0", "c1", "c2", "c3", "c4"}));
+  auto num_changes = changes.size();
+  top->OpenChild("c0", dc::OpenMode::kEditable)->Put("size", 1);
+  ASSERT_EQ(changes.size(), num_changes);
+}
+
+TEST_F(ChildViewTest, Filter) {
+  view->SetSortKeys({{"size", true}});
+  view->SetFilter({"size"}, [](auto& values) { return values[0] != 10; });
+  ASSERT_EQ(RowNames(*view),
+            (std::vector<std::string>{"c3", "c0", "c4", "c2"}));
+  ASSERT_EQ(view->RowOf("c4"), 2u);
+  ASSERT_EQ(view->RowOf("c1"), dc::ChildView::npos);
+
+  // Filtered in and out
+  top->OpenChild("c1", dc::OpenMode::kEditable)->Put("size", 100);
+  ASSERT_EQ(changes.back().type, dc::ChildViewChange::Type::kInsert);
+  ASSERT_EQ(changes.back().row, 4u);
+  top->OpenChild("c4", dc::OpenMode::kEditable)->Put("size", 10);
+  ASSERT_EQ(changes.back().type, dc::ChildViewChange::Type::kRemove);
+  ASSERT_EQ(changes.back().row, 2u);
+  ASSERT_EQ(RowNames(*view),
+            (std::vector<std::string>{"c3", "c0", "c2", "c1"}));
+
+  // Filter by a key other than the sort keys
+  view->SetFilter({"kind"}, [](auto& values) { return values[0] == "odd"; });
+  ASSERT_EQ(RowNames(*view), (std::vector<std::string>{"c3", "c1"}));
+  top->OpenChild("c0", dc::OpenMode::kEditable)->Put("kind", "odd");
+  ASSERT_EQ(RowNames(*view), (std::vector<std::string>{"c3", "c0", "c1"}));
+
+  // The filter key no longer used doesn't reach the view
+  view->ClearFilter();
+  ASSERT_EQ(view->Size(), 5u);
+  auto num_changes = changes.size();
+  top->OpenChild("c2", dc::OpenMode::kEditable)->Put("kind", "odd");
+  ASSERT_EQ(changes.size(), num_changes);
+  top->OpenChild("c2", dc::OpenMode::kEditable)->Put("size", 1);
+  ASSERT_EQ(changes.size(), num_changes + 1);
+}
+
+TEST_F(ChildViewTest, Move) {
+  view->SetSortKeys({{"size", true}});
+  ASSERT_EQ(RowNames(*view),
+            (std::vector<std::string>{"c1", "c3", "c0", "c4", "c2"}));
+
+  // Move forward and backward
+  top->OpenChild("c3", dc::OpenMode::kEditable)->Put("size", 45);
+  ASSERT_EQ(RowNames(*view),
+            (std::vector<std::string>{"c1", "c0", "c4", "c3", "c2"}));
+  ASSERT_EQ(changes.back().type, dc::ChildViewChange::Type::kMove);
+  ASSERT_EQ(changes.back().row, 1u);
+  ASSERT_EQ(changes.back().dest_row, 3u);
+  top->OpenChild("c2", dc::OpenMode::kEditable)->Put("size", 5);
+  ASSERT_EQ(RowNames(*view),
+            (std::vector<std::string>{"c2", "c1", "c0", "c4", "c3"}));
+  ASSERT_EQ(changes.back().type, dc::ChildViewChange::Type::kMove);
+  ASSERT_EQ(changes.back().row, 4u);
+  ASSERT_EQ(changes.back().dest_row, 0u);
+
+  // Stays in the row
+  top->OpenChild("c0", dc::OpenMode::kEditable)->Put("size", 35);
+  ASSERT_EQ(changes.back().type, dc::ChildViewChange::Type::kUpdate);
+  ASSERT_EQ(changes.back().row, 2u);
+
+  // Keys not used by the view don't reach it
+  auto num_changes = changes.size();
+  top->OpenChild("c0", dc::OpenMode::kEditable)->Put("other", 1);
+  ASSERT_EQ(changes.size(), num_changes);
+}
+
+TEST_F(ChildViewTest, InsertRemove) {
+  view->SetSortKeys({{"size", true}});
+  view->SetFilter({"size"}, [](auto& values) { return values[0] != 10; });
+
+  // A new child without the key is sorted as nil
+  auto child = top->CreateChild("c5", "child");
+  ASSERT_EQ(changes.back().type, dc::ChildViewChange::Type::kInsert);
+  ASSERT_EQ(changes.back().row, 0u);
+  ASSERT_EQ(RowNames(*view),
+            (std::vector<std::string>{"c5", "c3", "c0", "c4", "c2"}));
+  child->PutMany({{"size", 45}, {"kind", "odd"}});
+  ASSERT_EQ(view->RowOf("c5"), 3u);
+
+  // Deleting a filtered out child is not notified
+  top->CreateChild("c6", "child")->Put("size", 10);
+  ASSERT_EQ(changes.back().type, dc::ChildViewChange::Type::kRemove);
+  ASSERT_EQ(view->RowOf("c6"), dc::ChildView::npos);
+  auto num_changes = changes.size();
+  top->DeleteChild("c6");
+  ASSERT_EQ(changes.size(), num_changes);
+
+  top->DeleteChild("c0");
+  ASSERT_EQ(changes.back().type, dc::ChildViewChange::Type::kRemove);
+  ASSERT_EQ(changes.back().row, 1u);
+  ASSERT_EQ(RowNames(*view),
+            (std::vector<std::string>{"c3", "c4", "c5", "c2"}));
+}
+
+TEST_F(ChildViewTest, BaseObjectChange) {
+  view->SetSortKeys({{"size", true}});
+  auto base = session->CreateTopLevelObject("base", "top");
+  base->CreateChild("b0", "child")->Put("size", 25);
+  auto base_child = base->CreateChild("b1", "child");
+  base_child->Put("size", 1);
+  base_child->Put("kind", "odd");
+
+  // Children of the base object are added by the rebuild
+  top->AddBase(base);
+  ASSERT_EQ(changes.back().type, dc::ChildViewChange::Type::kReset);
+  ASSERT_EQ(RowNames(*view),
+            (std::vector<std::string>{"b1", "c1", "c3", "b0", "c0", "c4",
+                                      "c2"}));
+  top->RemoveBase(base);
+  ASSERT_EQ(RowNames(*view),
+            (std::vector<std::string>{"c1", "c3", "c0", "c4", "c2"}));
+
+  // A child inheriting the values
+  auto child = top->OpenChild("c1", dc::OpenMode::kEditable);
+  child->RemoveKey("size");
+  ASSERT_EQ(view->RowOf("c1"), 0u);
+  child->AddBase(base_child);
+  ASSERT_EQ(RowNames(*view),
+            (std::vector<std::string>{"c1", "c3", "c0", "c4", "c2"}));
+  child->AddBase(base->OpenChild("b0"));
+  child->RemoveBase(base_child);
+  ASSERT_EQ(RowNames(*view),
+            (std::vector<std::string>{"c3", "c1", "c0", "c4", "c2"}));
+}
+
+TEST_F(ChildViewTest, Refresh) {
+  // Changes of the children don't reach the parent without a command stack
+  auto other_top = session->CreateTopLevelObject("other", "top");
+  other_top->CreateChild("c0", "child")->Put("size", 2);
+  other_top->CreateChild("c1", "child")->Put("size", 1);
+  dc::ChildView other_view(other_top);
+  other_view.SetSortKeys({{"size", true}});
+  ASSERT_EQ(RowNames(other_view), (std::vector<std::string>{"c1", "c0"}));
+  other_top->OpenChild("c0", dc::OpenMode::kEditable)->Put("size", -1);
+  ASSERT_EQ(RowNames(other_view), (std::vector<std::string>{"c1", "c0"}));
+  other_view.Refresh();
+  ASSERT_EQ(RowNames(other_view), (std::vector<std::string>{"c0", "c1"}));
+}
@@ -3,6 +3,9 @@
 
 #include "dino/core/dobject.h"
 
+#include <chrono>
+#include <fstream>
+#include <thread>
 #include <gtest/gtest.h>
 #include <boost/filesystem.hpp>
 
@@ -18,6 +21,7 @@ namespace {
 
 const std::string kObjName1 = "top1";
 const std::string kObjName2 = "top2";
+const std::string kObjName3 = "top3";
 
 }
 
@@ -28,6 +32,8 @@ class DataIOTest : public ::testing::Test {
       fs::remove_all(kObjName1);
     if (fs::exists(kObjName2))
       fs::remove_all(kObjName2);
+    if (fs::exists(kObjName3))
+      fs::remove_all(kObjName3);
   }
 };
 
@@ -79,3 +85,444 @@ TEST_F(DataIOTest, SaveReadTest) {
   obj = session->OpenTopLevelObject(kObjName2, kObjName2);
   ASSERT_TRUE(obj->Get("test") == 30);
 }
+
+TEST_F(DataIOTest, BinarySaveReadTest) {
+  dc::DValueArray array{1, std::string("a long string value in array"),
+                        dc::DValueArray{2.5, true}};
+  {
+    auto session = dc::Session::Create();
+    session->SetDefaultFileFormat(dc::FileFormat::kBinary);
+    auto obj = session->CreateTopLevelObject(kObjName3, kObjName3);
+    session->InitTopLevelObjectPath(kObjName3, kObjName3);
+    obj->Put("int", 30);
+    obj->Put("double", 1.5);
+    obj->Put("bool", true);
+    obj->Put("str", std::string("short"));
+    obj->Put("nil", nil);
+    obj->Put("array", array);
+    obj->SetAttr("attr1", "value1");
+    auto flat = obj->CreateChild("flat", "child", true);
+    flat->Put("int", 40);
+    auto child = obj->CreateChild("child", "child");
+    child->Put("str", std::string("child value"));
+    obj->Save(true);
+  }
+  ASSERT_TRUE(fs::exists(fs::path(kObjName3) / (kObjName3 + ".dbin")));
+  ASSERT_TRUE(fs::exists(fs::path(kObjName3) / "child" / "child.dbin"));
+
+  auto session = dc::Session::Create();
+  auto obj = session->OpenTopLevelObject(
+      kObjName3, kObjName3, dc::OpenMode::kEditable);
+  ASSERT_EQ(obj->Get("int"), 30);
+  ASSERT_EQ(obj->Get("double"), 1.5);
+  ASSERT_EQ(obj->Get("bool"), true);
+  ASSERT_EQ(obj->Get("str"), "short");
+  ASSERT_EQ(obj->Get("nil"), nil);
+  ASSERT_EQ(obj->Get("array"), array);
+  ASSERT_EQ(obj->Attr("attr1"), "value1");
+  ASSERT_EQ(obj->ChildCount(), 2u);
+  ASSERT_EQ(obj->OpenChild("flat")->Get("int"), 40);
+  ASSERT_EQ(obj->OpenChild("child")->Get("str"), "child value");
+
+  auto new_child = obj->CreateChild("child2", "child");
+  ASSERT_TRUE(fs::exists(fs::path(kObjName3) / "child2" / "child.dbin"));
+}
+
+TEST_F(DataIOTest, BinaryInvalidFile) {
+  fs::create_directory(kObjName3);
+  {
+    std::ofstream f((fs::path(kObjName3) / (kObjName3 + ".dbin")).string());
+    f << "not a binary data file";
+  }
+  auto session = dc::Session::Create();
+  ASSERT_THROW(session->OpenTopLevelObject(kObjName3, kObjName3),
+               dc::DException);
+}
+
+TEST_F(DataIOTest, LazyLoadTest) {
+  {
+    auto session = dc::Session::Create();
+    session->SetDefaultFileFormat(dc::FileFormat::kBinary);
+    auto obj = session->CreateTopLevelObject(kObjName3, kObjName3);
+    session->InitTopLevelObjectPath(kObjName3, kObjName3);
+    obj->Put("int", 30);
+    obj->SetAttr("attr1", "value1");
+    auto flat = obj->CreateChild("flat", "child", true);
+    flat->Put("int", 40);
+    flat->CreateChild("grand_child", "child")->Put("str", std::string("gc"));
+    obj->Save(true);
+
+    auto json_obj = session->CreateTopLevelObject(kObjName1, kObjName1);
+    session->InitTopLevelObjectPath(kObjName1, kObjName1);
+    json_obj->Put("int", 50);
+    json_obj->Save();
+  }
+
+  auto session = dc::Session::Create();
+  session->SetLoadMode(dc::LoadMode::kLazy);
+  ASSERT_EQ(session->GetLoadMode(), dc::LoadMode::kLazy);
+  auto obj = session->OpenTopLevelObject(
+      kObjName3, kObjName3, dc::OpenMode::kEditable);
+  ASSERT_EQ(obj->Attr("attr1"), "value1");
+  ASSERT_EQ(obj->ChildCount(), 1u);
+  ASSERT_TRUE(obj->IsChildFlat("flat"));
+  ASSERT_FALSE(obj->IsChildOpened("flat"));
+  ASSERT_EQ(obj->Get("int"), 30);
+  auto flat = obj->OpenChild("flat");
+  ASSERT_EQ(flat->Get("int"), 40);
+  ASSERT_FALSE(flat->IsDirty());
+  ASSERT_EQ(flat->OpenChild("grand_child")->Get("str"), "gc");
+
+  obj->Put("int", 31);
+  obj->Save(true);
+  session->PurgeObject(dc::DObjPath(kObjName3));
+  obj = session->OpenTopLevelObject(kObjName3, kObjName3);
+  ASSERT_EQ(obj->Get("int"), 31);
+  ASSERT_EQ(obj->OpenChild("flat")->Get("int"), 40);
+
+  auto json_obj = session->OpenTopLevelObject(kObjName1, kObjName1);
+  ASSERT_EQ(json_obj->Get("int"), 50);
+}
+
+TEST_F(DataIOTest, ParallelSaveTest) {
+  const int kNumChildren = 20;
+  {
+    auto session = dc::Session::Create();
+    auto obj = session->CreateTopLevelObject(kObjName2, kObjName2);
+    session->InitTopLevelObjectPath(kObjName2, kObjName2);
+    obj->Put("value", -1);
+    for (int idx = 0; idx < kNumChildren; ++ idx) {
+      auto child = obj->CreateChild("child" + std::to_string(idx), "child");
+      child->Put("value", idx);
+      auto grand_child = child->CreateChild("grand_child", "child");
+      grand_child->Put("value", idx * 10 + 1);
+    }
+    dc::SaveOptions options;
+    options.num_threads = 4;
+    obj->Save(true, options);
+    ASSERT_FALSE(obj->IsDirty());
+    ASSERT_FALSE(obj->OpenChild("child3")->IsDirty());
+  }
+
+  auto session = dc::Session::Create();
+  auto obj = session->OpenTopLevelObject(kObjName2, kObjName2);
+  ASSERT_EQ(obj->Get("value"), -1);
+  ASSERT_EQ(obj->ChildCount(), static_cast<size_t>(kNumChildren));
+  for (int idx = 0; idx < kNumChildren; ++ idx) {
+    auto child = obj->OpenChild("child" + std::to_string(idx));
+    ASSERT_EQ(child->Get("value"), idx);
+    ASSERT_EQ(child->OpenChild("grand_child")->Get("value"), idx * 10 + 1);
+  }
+  ASSERT_FALSE(fs::exists(
+      fs::path(kObjName2) / "child0" / (std::string("child.json.writing"))));
+}
+
+TEST_F(DataIOTest, IncrementalSaveTest) {
+  auto session = dc::Session::Create();
+  auto obj = session->CreateTopLevelObject(kObjName2, kObjName2);
+  session->InitTopLevelObjectPath(kObjName2, kObjName2);
+  for (int idx = 0; idx < 5; ++ idx) {
+    auto child = obj->CreateChild("child" + std::to_string(idx), "child");
+    child->Put("value", idx);
+    child->CreateChild("grand_child", "child")->Put("value", idx + 10);
+  }
+  dc::SaveOptions options;
+  options.skip_clean = true;
+  auto stats = obj->Save(true, options);
+  ASSERT_EQ(stats.num_written, 10u);
+  ASSERT_EQ(stats.num_clean, 1u);
+  ASSERT_EQ(stats.num_skipped_subtrees, 0u);
+
+  stats = obj->Save(true, options);
+  ASSERT_EQ(stats.num_written, 0u);
+  ASSERT_EQ(stats.num_clean, 0u);
+  ASSERT_EQ(stats.num_skipped_subtrees, 1u);
+
+  auto grand_child = session->OpenObject(
+      dc::DObjPath("top2/child2/grand_child"), dc::OpenMode::kEditable);
+  grand_child->Put("value", 100);
+  auto new_child = session->CreateObject(
+      dc::DObjPath("top2/child3/new_child"), "child");
+  options.num_threads = 2;
+  stats = obj->Save(true, options);
+  ASSERT_EQ(stats.num_written, 1u);
+  ASSERT_EQ(stats.num_clean, 3u);
+  ASSERT_EQ(stats.num_skipped_subtrees, 5u);
+  ASSERT_FALSE(obj->IsDirty());
+
+  stats = obj->Save(true, dc::SaveOptions());
+  ASSERT_EQ(stats.num_written, 12u);
+
+  session->PurgeObject(dc::DObjPath(kObjName2));
+  obj = session->OpenTopLevelObject(kObjName2, kObjName2);
+  ASSERT_EQ(obj->OpenChild("child2")->OpenChild("grand_child")->Get("value"),
+            100);
+  ASSERT_TRUE(obj->OpenChild("child3")->HasChild("new_child"));
+}
+
+TEST_F(DataIOTest, PreloadTest) {
+  const std::vector<std::string> names{kObjName1, kObjName2, kObjName3};
+  {
+    auto session = dc::Session::Create();
+    for (auto& name : names) {
+      auto obj = session->CreateTopLevelObject(name, name);
+      session->InitTopLevelObjectPath(name, name);
+      obj->Put("name", name);
+      auto child = obj->CreateChild("child", "child");
+      child->Put("value", 1);
+      child->CreateChild("flat", "child", true)->Put("value", 2);
+      auto grand_child = child->CreateChild("grand_child", "child");
+      grand_child->CreateChild("leaf", "child");
+      obj->Save(true);
+    }
+  }
+
+  auto session = dc::Session::Create();
+  std::vector<std::pair<dc::FsPath, std::string>> dir_name_list;
+  for (auto& name : names)
+    dir_name_list.emplace_back(dc::FsPath(name), name);
+  auto objects = session->OpenTopLevelObjects(dir_name_list);
+  ASSERT_EQ(objects.size(), names.size());
+  for (size_t idx = 0; idx < names.size(); ++ idx)
+    ASSERT_EQ(objects[idx]->Get("name"), names[idx]);
+
+  session->Preload(dc::DObjPath(kObjName1), 2, 2);
+  ASSERT_TRUE(session->IsOpened(dc::DObjPath("top1/child")));
+  ASSERT_TRUE(session->IsOpened(dc::DObjPath("top1/child/grand_child")));
+  ASSERT_FALSE(
+      session->IsOpened(dc::DObjPath("top1/child/grand_child/leaf")));
+  ASSERT_FALSE(session->IsOpened(dc::DObjPath("top2/child")));
+  auto child = session->OpenObject(dc::DObjPath("top1/child"));
+  ASSERT_EQ(child->Get("value"), 1);
+  ASSERT_EQ(child->OpenChild("flat")->Get("value"), 2);
+  ASSERT_FALSE(child->IsDirty());
+
+  auto other_session = dc::Session::Create();
+  dir_name_list.emplace_back(dc::FsPath("no_such_dir"), "no_such_dir");
+  ASSERT_THROW(other_session->OpenTopLevelObjects(dir_name_list),
+               dc::DException);
+  ASSERT_FALSE(other_session->IsOpened(dc::DObjPath(kObjName1)));
+  ASSERT_TRUE(other_session->TopObjectNames().empty());
+}
+
+TEST_F(DataIOTest, PreloadLoadError) {
+  // The bases have to be opened first, so loading the derived objects
+  // fails after they are registered
+  {
+    auto session = dc::Session::Create();
+    auto base = session->CreateTopLevelObject(kObjName1, kObjName1);
+    session->InitTopLevelObjectPath(kObjName1, kObjName1);
+    base->Put("value", 1);
+    auto obj = session->CreateTopLevelObject(kObjName2, kObjName2);
+    session->InitTopLevelObjectPath(kObjName2, kObjName2);
+    obj->AddBase(base);
+    obj->CreateChild("child", "child")->AddBase(base);
+    base->Save();
+    obj->Save(true);
+  }
+
+  auto session = dc::Session::Create();
+  std::vector<std::pair<dc::FsPath, std::string>> dir_name_list{
+    {dc::FsPath(kObjName2), kObjName2}};
+  ASSERT_THROW(session->OpenTopLevelObjects(dir_name_list), dc::DException);
+  ASSERT_FALSE(session->IsOpened(dc::DObjPath(kObjName2)));
+  ASSERT_TRUE(session->TopObjectNames().empty());
+
+  auto base = session->OpenTopLevelObject(kObjName1, kObjName1);
+  auto objects = session->OpenTopLevelObjects(dir_name_list);
+  ASSERT_EQ(objects[0]->Get("value"), 1);
+  session->PurgeObject(dc::DObjPath(kObjName1));
+
+  dc::DObjPath child_path(kObjName2 + "/child");
+  session->Preload(dc::DObjPath(kObjName2), 1, 2);
+  ASSERT_FALSE(session->IsOpened(child_path));
+  session->OpenTopLevelObject(kObjName1, kObjName1);
+  ASSERT_EQ(session->OpenObject(child_path)->Get("value"), 1);
+}
+
+TEST_F(DataIOTest, ChildManifestTest) {
+  auto manifest_path = fs::path(kObjName1) / ".dino_children";
+  auto read_manifest = [&manifest_path] {
+    std::ifstream f(manifest_path.string());
+    return std::string(std::istreambuf_iterator<char>(f),
+                       std::istreambuf_iterator<char>());
+  };
+  {
+    auto session = dc::Session::Create();
+    session->EnableChildManifest();
+    auto obj = session->CreateTopLevelObject(kObjName1, kObjName1);
+    session->InitTopLevelObjectPath(kObjName1, kObjName1);
+    obj->CreateChild("c1", "child");
+    obj->CreateChild("c2", "child");
+    obj->Save(true);
+  }
+  {
+    auto session = dc::Session::Create();
+    session->EnableChildManifest();
+    auto obj = session->OpenTopLevelObject(kObjName1, kObjName1);
+    ASSERT_EQ(obj->ChildCount(), 2u);
+    ASSERT_TRUE(fs::exists(manifest_path));
+  }
+  {
+    // Updated without the manifest
+    auto session = dc::Session::Create();
+    auto obj = session->OpenTopLevelObject(
+        kObjName1, kObjName1, dc::OpenMode::kEditable);
+    obj->CreateChild("c3", "child");
+    obj->Save(true);
+  }
+  {
+    auto session = dc::Session::Create();
+    session->EnableChildManifest();
+    auto obj = session->OpenTopLevelObject(
+        kObjName1, kObjName1, dc::OpenMode::kEditable);
+    ASSERT_EQ(obj->ChildCount(), 3u);
+    ASSERT_NE(read_manifest().find("c3 child"), std::string::npos);
+    obj->CreateChild("c4", "child");
+    obj->DeleteChild("c1");
+    obj->Save(true);
+    auto contents = read_manifest();
+    ASSERT_NE(contents.find("c4 child"), std::string::npos);
+    ASSERT_EQ(contents.find("c1 child"), std::string::npos);
+  }
+  auto session = dc::Session::Create();
+  session->EnableChildManifest();
+  auto obj = session->OpenTopLevelObject(kObjName1, kObjName1);
+  ASSERT_EQ(obj->ChildCount(), 3u);
+  ASSERT_EQ(obj->ChildAt(0).Name(), "c2");
+  ASSERT_EQ(obj->ChildAt(1).Name(), "c3");
+  ASSERT_EQ(obj->ChildAt(2).Name(), "c4");
+  ASSERT_FALSE(obj->HasChild("c1"));
+  ASSERT_NE(read_manifest().find("c4 child"), std::string::npos);
+}
+
+TEST_F(DataIOTest, ChildManifestExternalChangeTest) {
+  {
+    auto session = dc::Session::Create();
+    session->EnableChildManifest();
+    auto obj = session->CreateTopLevelObject(kObjName1, kObjName1);
+    session->InitTopLevelObjectPath(kObjName1, kObjName1);
+    obj->CreateChild("c1", "child");
+    obj->Save(true);
+  }
+  {
+    auto session = dc::Session::Create();
+    session->EnableChildManifest();
+    auto obj = session->OpenTopLevelObject(
+        kObjName1, kObjName1, dc::OpenMode::kEditable);
+    ASSERT_EQ(obj->ChildCount(), 1u);
+    obj->CreateChild("c2", "child");
+    obj->Save(true);
+  }
+  {
+    // Added without the manifest
+    auto session = dc::Session::Create();
+    auto obj = session->OpenTopLevelObject(
+        kObjName1, kObjName1, dc::OpenMode::kEditable);
+    obj->CreateChild("c3", "child");
+    obj->Save(true);
+  }
+  {
+    // Opened, saved and closed after the change
+    auto session = dc::Session::Create();
+    session->EnableChildManifest();
+    auto obj = session->OpenTopLevelObject(
+        kObjName1, kObjName1, dc::OpenMode::kEditable);
+    obj->Put("value", 1);
+    obj->Save(true);
+  }
+  auto session = dc::Session::Create();
+  session->EnableChildManifest();
+  auto obj = session->OpenTopLevelObject(kObjName1, kObjName1);
+  ASSERT_EQ(obj->ChildCount(), 3u);
+  ASSERT_TRUE(obj->HasChild("c3"));
+}
+
+TEST_F(DataIOTest, DeferredChildDiscoveryTest) {
+  {
+    auto session = dc::Session::Create();
+    auto obj = session->CreateTopLevelObject(kObjName1, kObjName1);
+    session->InitTopLevelObjectPath(kObjName1, kObjName1);
+    obj->CreateChild("a", "child")->CreateChild("b", "child")->Put("value", 1);
+    obj->Save(true);
+  }
+  auto add_child = [](const std::string& name) {
+    auto session = dc::Session::Create();
+    auto obj = session->OpenTopLevelObject(
+        kObjName1, kObjName1, dc::OpenMode::kEditable);
+    obj->CreateChild(name, "child");
+    obj->Save(true);
+  };
+
+  auto session = dc::Session::Create();
+  auto obj = session->OpenTopLevelObject(kObjName1, kObjName1);
+  auto b = session->OpenObject(dc::DObjPath("top1/a/b"));
+  ASSERT_EQ(b->Get("value"), 1);
+  // Not listed yet, so the child added later is found
+  add_child("x");
+  ASSERT_EQ(obj->ChildCount(), 2u);
+  ASSERT_TRUE(obj->HasChild("x"));
+  // Listed, so a rescan is required
+  add_child("y");
+  ASSERT_FALSE(obj->HasChild("y"));
+  obj->RefreshChildren();
+  ASSERT_EQ(obj->ChildCount(), 3u);
+  ASSERT_TRUE(obj->HasChild("y"));
+}
+
+#ifdef __linux__
+TEST_F(DataIOTest, WatcherTest) {
+  auto update = [](const std::function<void (const dc::DObjectSp&)>& func) {
+    auto session = dc::Session::Create();
+    auto obj = session->OpenTopLevelObject(
+        kObjName1, kObjName1, dc::OpenMode::kEditable);
+    func(obj);
+    obj->Save(true);
+  };
+  {
+    auto session = dc::Session::Create();
+    auto obj = session->CreateTopLevelObject(kObjName1, kObjName1);
+    session->InitTopLevelObjectPath(kObjName1, kObjName1);
+    obj->Put("value", 1);
+    obj->CreateChild("a", "child");
+    obj->Save(true);
+  }
+
+  auto session = dc::Session::Create();
+  session->EnableWatcher(true, true);
+  ASSERT_TRUE(session->IsWatcherEnabled());
+  ASSERT_GE(session->WatcherFileDescriptor(), 0);
+  auto obj = session->OpenTopLevelObject(kObjName1, kObjName1);
+  ASSERT_EQ(obj->ChildCount(), 1u);
+  std::vector<dc::CommandType> cmd_types;
+  obj->AddListener([&cmd_types](const dc::Command& cmd) {
+      cmd_types.emplace_back(cmd.Type());
+    }, dc::ListenerCallPoint::kPost);
+  auto wait_for = [&session](const std::function<bool ()>& cond) {
+    for (int count = 0; count < 200 && !cond(); ++ count) {
+      session->ProcessFileSystemEvents();
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return cond();
+  };
+
+  update([](auto& o) { o->CreateChild("x", "child"); });
+  ASSERT_TRUE(wait_for([&obj] { return obj->HasChild("x"); }));
+  ASSERT_EQ(cmd_types.back(), dc::CommandType::kAddChild);
+
+  auto child_a = obj->OpenChild("a");
+  fs::remove_all(fs::path(kObjName1) / "a");
+  ASSERT_TRUE(wait_for([&obj] { return !obj->HasChild("a"); }));
+  ASSERT_EQ(cmd_types.back(), dc::CommandType::kDeleteChild);
+  ASSERT_EQ(obj->ChildCount(), 1u);
+  ASSERT_FALSE(session->IsOpened(child_a->Path()));
+  ASSERT_TRUE(child_a->IsExpired());
+
+  update([](auto& o) { o->Put("value", 2); });
+  ASSERT_TRUE(wait_for([&obj] { return obj->Get("value") == 2; }));
+  ASSERT_EQ(cmd_types.back(), dc::CommandType::kValueUpdate);
+
+  session->EnableWatcher(false);
+  ASSERT_EQ(session->WatcherFileDescriptor(), -1);
+}
+#endif
@@ -0,0 +1,128 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#include "dino/qt/dobjectkeyvaluetablemodel.h"
+
+#include <QCoreApplication>
+#include <tuple>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "dino/core/session.h"
+#include "dino/core/dobject.h"
+
+namespace dc = dino::core;
+namespace dq = dino::qt;
+
+namespace {
+
+std::string CellText(const dq::DObjectKeyValueTableModel& model,
+                     int row, int col) {
+  return model.data(model.index(row, col)).toString().toStdString();
+}
+
+}  // namespace
+
+TEST(DObjectKeyValueTableModelTest, InsertRemoveRows) {
+  // Changes of the values are notified from the event loop
+  int argc = 1;
+  char arg0[] = "test";
+  char* argv[] = {arg0, nullptr};
+  QCoreApplication app(argc, argv);
+
+  auto session = dc::Session::Create();
+  auto base = session->CreateTopLevelObject("base", "base");
+  base->Put("c", "text");
+  auto top = session->CreateTopLevelObject("top", "top");
+  top->Put("b", 1);
+  top->Put("d", 2.5);
+  top->AddBase(base);
+
+  dq::DObjectKeyValueTableModel model(top);
+  ASSERT_EQ(model.columnCount(QModelIndex()), 2);
+  ASSERT_EQ(model.rowCount(QModelIndex()), 3);
+  ASSERT_EQ(CellText(model, 0, 0), "b");
+  ASSERT_EQ(CellText(model, 0, 1), "1");
+  ASSERT_EQ(CellText(model, 1, 0), "c");
+  ASSERT_EQ(CellText(model, 1, 1), "\"text\"");
+  ASSERT_EQ(CellText(model, 2, 1), "2.5");
+
+  std::vector<std::pair<int, int>> inserted;
+  std::vector<std::pair<int, int>> removed;
+  QObject::connect(&model, &QAbstractItemModel::rowsInserted,
+                   [&inserted](const QModelIndex&, int first, int last) {
+                     inserted.emplace_back(first, last);
+                   });
+  QObject::connect(&model, &QAbstractItemModel::rowsRemoved,
+                   [&removed](const QModelIndex&, int first, int last) {
+                     removed.emplace_back(first, last);
+                   });
+
+  top->Put("a", 3);
+  ASSERT_EQ(inserted.size(), 1u);
+  ASSERT_EQ(inserted[0], std::make_pair(0, 0));
+  ASSERT_EQ(model.rowCount(QModelIndex()), 4);
+  ASSERT_EQ(CellText(model, 0, 0), "a");
+  ASSERT_EQ(CellText(model, 1, 0), "b");
+
+  // Inherited keys stay in the rows
+  top->Put("c", 4);
+  ASSERT_EQ(inserted.size(), 1u);
+  ASSERT_EQ(CellText(model, 2, 1), "4");
+  top->RemoveKey("c");
+  ASSERT_TRUE(removed.empty());
+  ASSERT_EQ(CellText(model, 2, 1), "\"text\"");
+
+  top->RemoveKey("b");
+  ASSERT_EQ(removed.size(), 1u);
+  ASSERT_EQ(removed[0], std::make_pair(1, 1));
+  ASSERT_EQ(model.rowCount(QModelIndex()), 3);
+  ASSERT_EQ(CellText(model, 1, 0), "c");
+  ASSERT_EQ(CellText(model, 2, 0), "d");
+}
+
+TEST(DObjectKeyValueTableModelTest, DataChanged) {
+  int argc = 1;
+  char arg0[] = "test";
+  char* argv[] = {arg0, nullptr};
+  QCoreApplication app(argc, argv);
+
+  auto session = dc::Session::Create();
+  auto top = session->CreateTopLevelObject("top", "top");
+  top->PutMany({{"a", 1}, {"b", 2}, {"c", 3}, {"d", 4}});
+
+  dq::DObjectKeyValueTableModel model(top);
+  std::vector<std::tuple<int, int, int>> changed;
+  QObject::connect(&model, &QAbstractItemModel::dataChanged,
+                   [&changed](const QModelIndex& top_left,
+                              const QModelIndex& bottom_right) {
+                     changed.emplace_back(top_left.row(),
+                                          bottom_right.row(),
+                                          bottom_right.column());
+                   });
+
+  // The rows changed by a series of commands are notified at once
+  top->Put("b", 5);
+  top->Put("c", 6);
+  ASSERT_TRUE(changed.empty());
+  QCoreApplication::processEvents();
+  ASSERT_EQ(changed.size(), 1u);
+  ASSERT_EQ(changed[0], std::make_tuple(1, 2, 1));
+
+  // Notified before a row is inserted
+  top->Put("a", 7);
+  top->Put("e", 8);
+  ASSERT_EQ(changed.size(), 2u);
+  ASSERT_EQ(changed[1], std::make_tuple(0, 0, 1));
+  QCoreApplication::processEvents();
+  ASSERT_EQ(changed.size(), 2u);
+
+  model.SetEditable(true);
+  auto value_index = model.index(3, 1);
+  ASSERT_TRUE(model.flags(value_index).testFlag(Qt::ItemIsEditable));
+  ASSERT_FALSE(
+      model.flags(model.index(3, 0)).testFlag(Qt::ItemIsEditable));
+  ASSERT_TRUE(model.setData(value_index, "3.5"));
+  ASSERT_EQ(top->Get("d"), 3.5);
+  ASSERT_FALSE(model.setData(model.index(3, 0), "x"));
+}
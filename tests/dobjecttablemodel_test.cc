@@ -0,0 +1,95 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#include "dino/qt/dobjecttablemodel.h"
+
+#include <vector>
+#include <gtest/gtest.h>
+#include <fmt/format.h>
+
+#include "dino/core/session.h"
+#include "dino/core/dobject.h"
+#include "dino/qt/columninfo.h"
+
+namespace dc = dino::core;
+namespace dq = dino::qt;
+
+namespace {
+
+std::string RowName(const dq::DObjectTableModel& model, int row) {
+  return model.data(model.index(row, 0)).toString().toStdString();
+}
+
+}  // namespace
+
+TEST(DObjectTableModelTest, InsertRemoveRows) {
+  auto session = dc::Session::Create();
+  auto top = session->CreateTopLevelObject("top", "top");
+  for (int idx = 0; idx < 10; ++ idx)
+    top->CreateChild(fmt::format("c{:02}", idx), "child");
+
+  dq::DObjectTableModel model(top);
+  model.InsertColumns(
+      0, {dq::ColumnInfo("Name", dq::SourceTypeConst::kName, "")});
+  ASSERT_EQ(model.rowCount(), 10);
+  // Shown rows are cached
+  ASSERT_EQ(RowName(model, 2), "c02");
+  ASSERT_EQ(RowName(model, 3), "c03");
+
+  std::vector<std::pair<int, int>> inserted;
+  std::vector<std::pair<int, int>> removed;
+  QObject::connect(&model, &QAbstractItemModel::rowsInserted,
+                   [&inserted](const QModelIndex&, int first, int last) {
+                     inserted.emplace_back(first, last);
+                   });
+  QObject::connect(&model, &QAbstractItemModel::rowsRemoved,
+                   [&removed](const QModelIndex&, int first, int last) {
+                     removed.emplace_back(first, last);
+                   });
+
+  // Inserted in the middle of the rows
+  top->CreateChild("c02a", "child");
+  ASSERT_EQ(inserted.size(), 1u);
+  ASSERT_EQ(inserted[0], std::make_pair(3, 3));
+  ASSERT_EQ(model.rowCount(), 11);
+  ASSERT_EQ(RowName(model, 2), "c02");
+  ASSERT_EQ(RowName(model, 3), "c02a");
+  ASSERT_EQ(RowName(model, 4), "c03");
+  ASSERT_EQ(model.IndexToObject(model.index(4, 0))->Name(), "c03");
+
+  top->DeleteChild("c02");
+  ASSERT_EQ(removed.size(), 1u);
+  ASSERT_EQ(removed[0], std::make_pair(2, 2));
+  ASSERT_EQ(RowName(model, 2), "c02a");
+  ASSERT_EQ(RowName(model, 3), "c03");
+  ASSERT_EQ(model.ObjectToIndex(top->OpenChild("c03")).row(), 3);
+}
+
+TEST(DObjectTableModelTest, InsertAfterFetchedRows) {
+  auto session = dc::Session::Create();
+  auto top = session->CreateTopLevelObject("top", "top");
+  for (int idx = 0; idx < 300; ++ idx)
+    top->CreateChild(fmt::format("c{:03}", idx), "child");
+
+  dq::DObjectTableModel model(top);
+  model.InsertColumns(
+      0, {dq::ColumnInfo("Name", dq::SourceTypeConst::kName, "")});
+  ASSERT_EQ(model.rowCount(), model.FetchSize());
+  ASSERT_EQ(model.FetchSize(), 256);
+  ASSERT_TRUE(model.canFetchMore(QModelIndex()));
+
+  // Not notified until fetched
+  top->CreateChild("c260a", "child");
+  top->CreateChild("c255a", "child");
+  ASSERT_EQ(model.rowCount(), 256);
+  top->CreateChild("c100a", "child");
+  ASSERT_EQ(model.rowCount(), 257);
+  ASSERT_EQ(RowName(model, 101), "c100a");
+  ASSERT_EQ(RowName(model, 256), "c255");
+
+  model.fetchMore(QModelIndex());
+  ASSERT_EQ(model.rowCount(), 303);
+  ASSERT_FALSE(model.canFetchMore(QModelIndex()));
+  ASSERT_EQ(RowName(model, 257), "c255a");
+  ASSERT_EQ(RowName(model, 263), "c260a");
+}
@@ -0,0 +1,124 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#include "dino/qt/dobjecttreemodel.h"
+
+#include <vector>
+#include <gtest/gtest.h>
+#include <fmt/format.h>
+
+#include "dino/core/session.h"
+#include "dino/core/dobject.h"
+#include "dino/qt/columninfo.h"
+
+namespace dc = dino::core;
+namespace dq = dino::qt;
+
+namespace {
+
+std::string NameAt(const dq::DObjectTreeModel& model,
+                   int row, const QModelIndex& parent = QModelIndex()) {
+  return model.data(model.index(row, 0, parent)).toString().toStdString();
+}
+
+}  // namespace
+
+TEST(DObjectTreeModelTest, Indexes) {
+  auto session = dc::Session::Create();
+  auto top = session->CreateTopLevelObject("top", "top");
+  for (int idx = 0; idx < 5; ++ idx) {
+    auto child = top->CreateChild(fmt::format("c{}", idx), "child");
+    for (int sub_idx = 0; sub_idx < 3; ++ sub_idx)
+      child->CreateChild(fmt::format("g{}", sub_idx), "child");
+  }
+
+  dq::DObjectTreeModel model(top);
+  model.InsertColumn(
+      0, {dq::ColumnInfo("Name", dq::SourceTypeConst::kName, "")});
+  ASSERT_EQ(model.columnCount(QModelIndex()), 1);
+  ASSERT_EQ(model.rowCount(QModelIndex()), 5);
+  auto c2_index = model.index(2, 0);
+  ASSERT_EQ(NameAt(model, 2), "c2");
+  ASSERT_EQ(model.rowCount(c2_index), 3);
+  auto g1_index = model.index(1, 0, c2_index);
+  ASSERT_EQ(NameAt(model, 1, c2_index), "g1");
+  ASSERT_EQ(model.parent(g1_index), c2_index);
+  ASSERT_FALSE(model.parent(c2_index).isValid());
+  ASSERT_EQ(model.IndexToObject(g1_index)->Path(),
+            dc::DObjPath("top/c2/g1"));
+  ASSERT_EQ(model.IndexToObject(QModelIndex()), top);
+
+  // Objects not shown yet are added with their ancestors
+  auto g2 = top->OpenChild("c4")->OpenChild("g2");
+  auto g2_index = model.ObjectToIndex(g2);
+  ASSERT_EQ(g2_index.row(), 2);
+  ASSERT_EQ(model.parent(g2_index).row(), 4);
+  ASSERT_EQ(model.IndexToObject(g2_index)->Path(), g2->Path());
+  ASSERT_FALSE(model.index(3, 0, model.parent(g2_index)).isValid());
+}
+
+TEST(DObjectTreeModelTest, InsertRemoveRows) {
+  auto session = dc::Session::Create();
+  auto top = session->CreateTopLevelObject("top", "top");
+  for (int idx = 0; idx < 5; ++ idx) {
+    auto child = top->CreateChild(fmt::format("c{}", idx), "child");
+    for (int sub_idx = 0; sub_idx < 3; ++ sub_idx)
+      child->CreateChild(fmt::format("g{}", sub_idx), "child");
+  }
+  // The commands of the descendants are notified through the command stack
+  top->EnableCommandStack(true);
+
+  dq::DObjectTreeModel model(top);
+  model.InsertColumn(
+      0, {dq::ColumnInfo("Name", dq::SourceTypeConst::kName, "")});
+  auto c2_index = model.index(2, 0);
+  ASSERT_EQ(NameAt(model, 1, c2_index), "g1");
+  ASSERT_EQ(NameAt(model, 2, c2_index), "g2");
+
+  std::vector<std::pair<int, int>> inserted;
+  std::vector<std::pair<int, int>> removed;
+  std::vector<QModelIndex> parents;
+  QObject::connect(&model, &QAbstractItemModel::rowsInserted,
+                   [&inserted, &parents](
+                       const QModelIndex& parent, int first, int last) {
+                     inserted.emplace_back(first, last);
+                     parents.push_back(parent);
+                   });
+  QObject::connect(&model, &QAbstractItemModel::rowsRemoved,
+                   [&removed, &parents](
+                       const QModelIndex& parent, int first, int last) {
+                     removed.emplace_back(first, last);
+                     parents.push_back(parent);
+                   });
+
+  auto c2 = top->OpenChild("c2");
+  c2->CreateChild("g0a", "child");
+  ASSERT_EQ(inserted.size(), 1u);
+  ASSERT_EQ(inserted[0], std::make_pair(1, 1));
+  ASSERT_EQ(parents.back(), c2_index);
+  ASSERT_EQ(model.rowCount(c2_index), 4);
+  ASSERT_EQ(NameAt(model, 1, c2_index), "g0a");
+  ASSERT_EQ(NameAt(model, 2, c2_index), "g1");
+  ASSERT_EQ(model.ObjectToIndex(c2->OpenChild("g2")).row(), 3);
+
+  // Children of the objects not shown yet aren't notified
+  top->OpenChild("c3")->CreateChild("g3", "child");
+  ASSERT_EQ(inserted.size(), 1u);
+
+  top->DeleteChild("c1");
+  ASSERT_EQ(removed.size(), 1u);
+  ASSERT_EQ(removed[0], std::make_pair(1, 1));
+  ASSERT_FALSE(parents.back().isValid());
+  ASSERT_EQ(model.rowCount(QModelIndex()), 4);
+  ASSERT_EQ(NameAt(model, 1), "c2");
+  c2_index = model.ObjectToIndex(c2);
+  ASSERT_EQ(c2_index.row(), 1);
+  ASSERT_EQ(NameAt(model, 1, c2_index), "g0a");
+  ASSERT_EQ(model.rowCount(model.index(2, 0)), 4);
+
+  c2->DeleteChild("g1");
+  ASSERT_EQ(removed.size(), 2u);
+  ASSERT_EQ(removed[1], std::make_pair(2, 2));
+  ASSERT_EQ(parents.back(), c2_index);
+  ASSERT_EQ(NameAt(model, 2, c2_index), "g2");
+}
@@ -0,0 +1,71 @@
+// Copyright (c) 2019 Akihito Takeuchi
+// Distributed under the MIT License : http://opensource.org/licenses/MIT
+
+#include "dino/core/dobjpath.h"
+
+#include <unordered_map>
+
+#include <gtest/gtest.h>
+
+using DObjPath = dino::core::DObjPath;
+
+TEST(DObjPathTest, BasicTest) {
+  DObjPath path("top/child/grand_child");
+  ASSERT_EQ(path.String(), "top/child/grand_child");
+  ASSERT_EQ(path.Depth(), 3u);
+  ASSERT_EQ(path.TopName(), "top");
+  ASSERT_EQ(path.LeafName(), "grand_child");
+  ASSERT_EQ(path.Top(), DObjPath("top"));
+  ASSERT_EQ(path.Leaf(), DObjPath("grand_child"));
+  ASSERT_EQ(path.Tail(), DObjPath("child/grand_child"));
+  ASSERT_EQ(path.ParentPath(), DObjPath("top/child"));
+  ASSERT_EQ(path.AncestorAt(1), DObjPath("top"));
+  ASSERT_EQ(path.AncestorAt(2), DObjPath("top/child"));
+  ASSERT_EQ(path.AncestorAt(3), path);
+  ASSERT_EQ(path.DirPath(), dino::core::FsPath("top/child/grand_child"));
+  ASSERT_TRUE(path.IsValid());
+  ASSERT_FALSE(path.IsTop());
+  ASSERT_TRUE(path.Top().IsTop());
+  ASSERT_FALSE(path.Empty());
+
+  DObjPath empty_path;
+  ASSERT_TRUE(empty_path.Empty());
+  ASSERT_EQ(empty_path.Depth(), 0u);
+  ASSERT_EQ(empty_path.String(), "");
+  ASSERT_TRUE(DObjPath("top").ChildPath("").Empty());
+  ASSERT_FALSE(DObjPath("top/a-b").IsValid());
+}
+
+TEST(DObjPathTest, EqualityTest) {
+  DObjPath path1("top/child");
+  auto path2 = DObjPath("top").ChildPath("child");
+  auto path3 = DObjPath("top/child/grand_child").ParentPath();
+  ASSERT_EQ(path1, path2);
+  ASSERT_EQ(path1, path3);
+  ASSERT_EQ(path1.HashValue(), path2.HashValue());
+  ASSERT_NE(path1, DObjPath("top/child2"));
+  ASSERT_NE(path1, DObjPath("child/top"));
+  ASSERT_NE(path1, DObjPath("child"));
+
+  ASSERT_TRUE(path1.IsDescendantOf(DObjPath("top")));
+  ASSERT_FALSE(path1.IsDescendantOf(path2));
+  ASSERT_TRUE(path1.IsDescendantOf(path2, true));
+  ASSERT_FALSE(path1.IsDescendantOf(DObjPath("child")));
+
+  std::unordered_map<DObjPath, int, DObjPath::Hash> path_map;
+  path_map[path1] = 1;
+  path_map[DObjPath("top")] = 2;
+  ASSERT_EQ(path_map[path2], 1);
+  ASSERT_EQ(path_map[path3.ParentPath()], 2);
+}
+
+TEST(DObjPathTest, ReleaseTest) {
+  size_t hash = 0;
+  {
+    DObjPath path("released/child");
+    hash = path.HashValue();
+  }
+  DObjPath path("released/child");
+  ASSERT_EQ(path.HashValue(), hash);
+  ASSERT_EQ(path.String(), "released/child");
+}
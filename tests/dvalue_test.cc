@@ -1,13 +1,17 @@
 // Copyright (c) 2019 Akihito Takeuchi
 // Distributed under the MIT License : http://opensource.org/licenses/MIT
 
+#include <limits>
+
 #include "dino/core/dvalue.h"
+#include "dino/core/dcompactvalue.h"
 
 #include <gtest/gtest.h>
 
 auto& nil = dino::core::nil;
 using DValue = dino::core::DValue;
 using DValueArray = dino::core::DValueArray;
+using DCompactValue = dino::core::DCompactValue;
 
 TEST(DValueTest, IntTest) {
   DValue val(1);
@@ -61,3 +65,40 @@ TEST(DValueTest, VectorTest) {
   ASSERT_EQ(int_values[1], 5);
   ASSERT_EQ(int_values[2], 10);
 }
+
+TEST(DValueTest, CompactValueTest) {
+  ASSERT_EQ(sizeof(DCompactValue), 16u);
+
+  for (auto& value : {DValue(nil), DValue(true), DValue(10),
+                      DValue(std::numeric_limits<int>::min()),
+                      DValue(std::numeric_limits<int>::max()), DValue(1.5),
+                      DValue(std::string("short")),
+                      DValue(std::string("long string stored in a block"))}) {
+    DCompactValue compact_value(value);
+    ASSERT_TRUE(compact_value.Equals(value));
+    ASSERT_EQ(compact_value.ToDValue(), value);
+    ASSERT_EQ(DCompactValue(compact_value), compact_value);
+  }
+  ASSERT_FALSE(DCompactValue(1).Equals(1.0));
+  ASSERT_FALSE(DCompactValue("abc").Equals(std::string("abd")));
+  ASSERT_NE(DCompactValue("abc"), DCompactValue("abcd"));
+
+  DValueArray inner_values;
+  inner_values.push_back(2);
+  inner_values.push_back(std::string("inner"));
+  DValueArray values;
+  values.push_back(1);
+  values.push_back(inner_values);
+  DCompactValue compact_array{DValue(values)};
+  ASSERT_TRUE(compact_array.IsArray());
+  ASSERT_EQ(compact_array.ArraySize(), 2u);
+  ASSERT_EQ(compact_array.ArrayAt(1).ArraySize(), 2u);
+  ASSERT_TRUE(compact_array.Equals(values));
+  ASSERT_EQ(compact_array.ToDValue(), values);
+
+  auto copied_array = compact_array;
+  ASSERT_EQ(copied_array, compact_array);
+  inner_values.push_back(3);
+  values[1] = inner_values;
+  ASSERT_FALSE(compact_array.Equals(values));
+}
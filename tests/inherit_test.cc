@@ -6,6 +6,7 @@
 #include <gtest/gtest.h>
 #include <boost/filesystem.hpp>
 #include "dino/core/session.h"
+#include "dino/core/commandstack.h"
 #include "dino/core/dexception.h"
 
 namespace dc = dino::core;
@@ -749,3 +750,195 @@ TEST_F(InheritTest, DeepInheritance2) {
     ASSERT_THROW(c3->ChildCount(), dc::DException);
   }
 }
+
+TEST_F(InheritTest, InheritedKeyCache) {
+  auto session = dc::Session::Create();
+  auto top = session->CreateTopLevelObject(kTopName1, "test");
+  std::vector<dc::DObjectSp> chain;
+  for (auto name : {kChildName1, kChildName2, kChildName3,
+                    kChildName4, kChildName5}) {
+    auto obj = top->CreateChild(name, "test");
+    if (!chain.empty())
+      obj->AddBase(chain.back());
+    chain.push_back(obj);
+  }
+  auto& root = chain.front();
+  auto& mid = chain[2];
+  auto& leaf = chain.back();
+
+  root->Put("key", 1);
+  ASSERT_EQ(leaf->Get("key"), 1);
+  ASSERT_EQ(leaf->WhereIsKey("key"), root->Path());
+
+  root->Put("key", 2);
+  ASSERT_EQ(leaf->Get("key"), 2);
+
+  mid->Put("key", 3);
+  ASSERT_EQ(leaf->Get("key"), 3);
+  ASSERT_EQ(leaf->WhereIsKey("key"), mid->Path());
+  ASSERT_EQ(chain[1]->Get("key"), 2);
+
+  mid->RemoveKey("key");
+  ASSERT_EQ(leaf->Get("key"), 2);
+  ASSERT_EQ(leaf->WhereIsKey("key"), root->Path());
+
+  root->RemoveKey("key");
+  ASSERT_FALSE(leaf->HasKey("key"));
+  ASSERT_EQ(leaf->Get("key", 10), 10);
+  ASSERT_THROW(leaf->Get("key"), dc::DException);
+
+  root->Put("key", 4);
+  ASSERT_EQ(leaf->Get("key"), 4);
+  chain[3]->RemoveBase(mid);
+  ASSERT_FALSE(leaf->HasKey("key"));
+  chain[3]->AddBase(mid);
+  ASSERT_EQ(leaf->Get("key"), 4);
+}
+
+TEST_F(InheritTest, InheritedKeyCacheWithoutSignal) {
+  auto session = dc::Session::Create();
+  auto top = session->CreateTopLevelObject(kTopName1, "test");
+  auto a = top->CreateChild(kChildName1, "test");
+  auto b = top->CreateChild(kChildName2, "test");
+  auto d = top->CreateChild(kChildName3, "test");
+  b->AddBase(a);
+  d->AddBase(b);
+  a->Put("k", 1);
+  ASSERT_EQ(d->Get("k"), 1);
+  ASSERT_EQ(d->WhereIsKey("k"), a->Path());
+
+  b->DisableSignal();
+  b->Put("k", 2);
+  ASSERT_EQ(b->Get("k"), 2);
+  ASSERT_EQ(d->Get("k"), 2);
+  ASSERT_EQ(d->WhereIsKey("k"), b->Path());
+  b->Put("k", 3);
+  ASSERT_EQ(d->Get("k"), 3);
+  b->RemoveKey("k");
+  ASSERT_EQ(d->Get("k"), 1);
+  ASSERT_EQ(d->WhereIsKey("k"), a->Path());
+}
+
+TEST_F(InheritTest, InheritedKeySet) {
+  auto session = dc::Session::Create();
+  auto top = session->CreateTopLevelObject(kTopName1, "test");
+  auto c1 = top->CreateChild(kChildName1, "test");
+  auto c2 = top->CreateChild(kChildName2, "test");
+  auto c3 = top->CreateChild(kChildName3, "test");
+  c1->Put("a", 1);
+  c2->Put("b", 2);
+  c3->Put("c", 3);
+  c3->AddBase(c2);
+  ASSERT_EQ(c3->Keys(), (StringVector{"b", "c"}));
+  c2->AddBase(c1);
+  ASSERT_EQ(c3->Keys(), (StringVector{"a", "b", "c"}));
+  ASSERT_EQ(c3->Keys(true), StringVector{"c"});
+  ASSERT_TRUE(c3->HasNonLocalKey("a"));
+  ASSERT_FALSE(c3->HasNonLocalKey("c"));
+
+  StringVector keys;
+  for (auto& key : c3->KeyRange())
+    keys.push_back(key);
+  ASSERT_EQ(keys, (StringVector{"a", "b", "c"}));
+
+  c1->Put("d", 4);
+  ASSERT_EQ(c3->Keys(), (StringVector{"a", "b", "c", "d"}));
+  c3->Put("a", 5);
+  ASSERT_TRUE(c3->HasNonLocalKey("a"));
+  ASSERT_EQ(c3->Keys(true), (StringVector{"a", "c"}));
+
+  c2->Put("d", 6);
+  c1->RemoveKey("d");
+  ASSERT_TRUE(c3->HasNonLocalKey("d"));
+  c2->RemoveKey("d");
+  ASSERT_FALSE(c3->HasNonLocalKey("d"));
+  ASSERT_EQ(c3->Keys(), (StringVector{"a", "b", "c"}));
+
+  c2->RemoveBase(c1);
+  ASSERT_FALSE(c3->HasNonLocalKey("a"));
+  ASSERT_EQ(c3->Keys(), (StringVector{"a", "b", "c"}));
+  c3->RemoveKey("a");
+  ASSERT_EQ(c3->Keys(), (StringVector{"b", "c"}));
+  c3->RemoveBase(c2);
+  ASSERT_EQ(c3->Keys(), StringVector{"c"});
+}
+
+TEST_F(InheritTest, InheritedKeySetWithoutSignal) {
+  auto session = dc::Session::Create();
+  auto top = session->CreateTopLevelObject(kTopName1, "test");
+  auto c1 = top->CreateChild(kChildName1, "test");
+  auto c2 = top->CreateChild(kChildName2, "test");
+  auto c3 = top->CreateChild(kChildName3, "test");
+  c1->Put("a", 1);
+  c2->AddBase(c1);
+  c3->AddBase(c2);
+  ASSERT_EQ(c3->Keys(), StringVector{"a"});
+
+  c1->DisableSignal();
+  c2->DisableSignal();
+  c1->Put("n", 2);
+  ASSERT_TRUE(c3->HasKey("n"));
+  ASSERT_EQ(c3->Keys(), (StringVector{"a", "n"}));
+  c2->Put("m", 3);
+  ASSERT_EQ(c3->Keys(), (StringVector{"a", "m", "n"}));
+  ASSERT_TRUE(c3->HasNonLocalKey("m"));
+  c1->RemoveKey("n");
+  ASSERT_FALSE(c3->HasKey("n"));
+  ASSERT_EQ(c3->Keys(), (StringVector{"a", "m"}));
+}
+
+TEST_F(InheritTestWithCommandStack, PutMany) {
+  auto session = dc::Session::Create();
+  auto top = session->CreateTopLevelObject(kTopName1, "test");
+  auto stack = top->EnableCommandStack();
+  auto c1 = top->CreateChild(kChildName1, "test");
+  auto c2 = top->CreateChild(kChildName2, "test");
+  c2->AddBase(c1);
+  c1->Put("a", 1);
+  stack->Clear();
+
+  std::vector<dc::Command> c1_cmds, c2_cmds;
+  c1->AddListener([&c1_cmds](const dc::Command& cmd) {
+      c1_cmds.push_back(cmd);
+    }, dc::ListenerCallPoint::kPost);
+  c2->AddListener([&c2_cmds](const dc::Command& cmd) {
+      c2_cmds.push_back(cmd);
+    }, dc::ListenerCallPoint::kPost);
+
+  c1->PutMany({{"a", 2}, {"b", 3.5}, {"c", true}});
+  ASSERT_EQ(c1_cmds.size(), 1u);
+  ASSERT_EQ(c1_cmds[0].Type(), dc::CommandType::kValuesUpdate);
+  ASSERT_TRUE(c1_cmds[0].IsValueUpdate());
+  ASSERT_EQ(c1_cmds[0].Keys(), (StringVector{"a", "b", "c"}));
+  ASSERT_EQ(c1_cmds[0].PrevValues().size(), 1u);
+  ASSERT_EQ(c2_cmds.size(), 1u);
+  ASSERT_EQ(c2_cmds[0].ObjPath(), c2->Path());
+  ASSERT_EQ(c2->Keys(), (StringVector{"a", "b", "c"}));
+  ASSERT_EQ(c2->Get("a"), 2);
+
+  c1->PutMany({{"a", 2}});
+  ASSERT_EQ(c1_cmds.size(), 1u);
+
+  ASSERT_TRUE(stack->CanUndo());
+  stack->Undo();
+  ASSERT_FALSE(stack->CanUndo());
+  ASSERT_EQ(c1->Keys(), StringVector{"a"});
+  ASSERT_EQ(c1->Get("a"), 1);
+  ASSERT_EQ(c2->Keys(), StringVector{"a"});
+  stack->Redo();
+  ASSERT_EQ(c1->Keys(), (StringVector{"a", "b", "c"}));
+  ASSERT_EQ(c1->Get("a"), 2);
+  ASSERT_EQ(c1_cmds.size(), 3u);
+
+  ASSERT_THROW(c1->RemoveKeys({"a", "x"}), dc::DException);
+  ASSERT_EQ(c1->Keys(), (StringVector{"a", "b", "c"}));
+
+  c2->Put("b", 4);
+  c1->RemoveKeys({"a", "b"});
+  ASSERT_EQ(c1->Keys(), StringVector{"c"});
+  ASSERT_EQ(c2->Keys(), (StringVector{"b", "c"}));
+  ASSERT_EQ(c2_cmds.back().Keys(), StringVector{"a"});
+  stack->Undo();
+  ASSERT_EQ(c1->Keys(), (StringVector{"a", "b", "c"}));
+  ASSERT_EQ(c1->Get("a"), 2);
+}
@@ -3,11 +3,15 @@
 
 #include "dino/core/dobject.h"
 
+#include <sys/wait.h>
+#include <unistd.h>
 #include <gtest/gtest.h>
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string/join.hpp>
+#include <fmt/format.h>
 
 #include "dino/core/session.h"
+#include "dino/core/commandstack.h"
 #include "dino/core/dexception.h"
 
 namespace dc = dino::core;
@@ -23,6 +27,7 @@ const std::string kTopName4 = "top4";
 const std::string kTopName5 = "top5";
 const std::string kTopName6 = "top6";
 const std::string kTopName7 = "top7";
+const std::string kTopName8 = "top8";
 const std::string kChildName1 = "child1";
 const std::string kChildName2 = "child2";
 const std::string kChildName3 = "child3";
@@ -35,7 +40,7 @@ class ObjectTest : public ::testing::Test {
   virtual void SetUp() {
     for (auto dir_name
              : {kTopName1, kTopName2, kTopName3, kTopName4,
-               kTopName5, kTopName6, kTopName7,
+               kTopName5, kTopName6, kTopName7, kTopName8,
                 kChildName1, kChildName2, kChildName3, kChildName4})
       if (fs::exists(dir_name))
         fs::remove_all(dir_name);
@@ -438,6 +443,178 @@ TEST_F(ObjectTest, LockFile) {
   ASSERT_FALSE(fs::exists(kTopName5 + "/top.json.lock"));
 }
 
+TEST_F(ObjectTest, LockTable) {
+  auto session = dc::Session::Create();
+  session->SetLockMode(dc::LockMode::kLockTable);
+  auto top = session->CreateTopLevelObject(kTopName5, "top");
+  session->InitTopLevelObjectPath(kTopName5, kTopName5);
+  auto child1 = top->CreateChild(kChildName1, "child");
+  top->CreateChild(kChildName2, "child");
+  top->Save(true);
+  ASSERT_TRUE(fs::exists(kTopName5 + "/.dino_locks"));
+  ASSERT_FALSE(fs::exists(kTopName5 + "/top.json.lock"));
+  ASSERT_FALSE(fs::exists(kTopName5 + "/" + kChildName1 + "/child.json.lock"));
+
+  auto other_session = dc::Session::Create();
+  other_session->SetLockMode(dc::LockMode::kLockTable);
+  ASSERT_THROW(other_session->OpenTopLevelObject(
+      kTopName5, kTopName5, dc::OpenMode::kEditable), dc::DException);
+  auto other_top = other_session->OpenTopLevelObject(kTopName5, kTopName5);
+  ASSERT_THROW(other_top->OpenChild(kChildName2, dc::OpenMode::kEditable),
+               dc::DException);
+
+  // The lock of the subtree moves to the child still editable
+  top->SetReadOnly();
+  ASSERT_THROW(other_top->SetEditable(), dc::DException);
+  ASSERT_THROW(other_top->OpenChild(kChildName1, dc::OpenMode::kEditable),
+               dc::DException);
+  auto other_child2 = other_top->OpenChild(
+      kChildName2, dc::OpenMode::kEditable);
+  other_child2->Put("value", 1);
+
+  child1.reset();
+  top.reset();
+  session.reset();
+  other_child2.reset();
+  other_top->SetEditable();
+  ASSERT_TRUE(other_top->IsEditable());
+}
+
+TEST_F(ObjectTest, LockTableReadOnlyFile) {
+  auto session = dc::Session::Create();
+  session->SetLockMode(dc::LockMode::kLockTable);
+  auto top = session->CreateTopLevelObject(kTopName5, "top");
+  session->InitTopLevelObjectPath(kTopName5, kTopName5);
+  top->CreateChild(kChildName1, "child");
+  top->Save(true);
+  top.reset();
+
+  // Checked for the objects under the locked top level object, and
+  // cached only if writable
+  session = dc::Session::Create();
+  session->SetLockMode(dc::LockMode::kLockTable);
+  top = session->OpenTopLevelObject(
+      kTopName5, kTopName5, dc::OpenMode::kEditable);
+  auto data_file = fs::path(kTopName5) / kChildName1 / "child.json";
+  auto perms = fs::status(data_file).permissions();
+  fs::permissions(data_file, fs::owner_read | fs::group_read | fs::others_read);
+  ASSERT_THROW(top->OpenChild(kChildName1, dc::OpenMode::kEditable),
+               dc::DException);
+  fs::permissions(data_file, perms);
+  auto child = top->OpenChild(kChildName1, dc::OpenMode::kEditable);
+  ASSERT_TRUE(child->IsEditable());
+}
+
+TEST_F(ObjectTest, LockTableManyObjects) {
+  const int child_count = 50;
+  auto session = dc::Session::Create();
+  session->SetLockMode(dc::LockMode::kLockTable);
+  auto top = session->CreateTopLevelObject(kTopName5, "top");
+  session->InitTopLevelObjectPath(kTopName5, kTopName5);
+  for (int idx = 0; idx < child_count; ++ idx)
+    top->CreateChild(fmt::format("child{:02}", idx), "child");
+  top->Save(true);
+  top->SetReadOnly();
+
+  std::vector<dc::DObjectSp> children;
+  for (int idx = 0; idx < child_count; ++ idx)
+    children.emplace_back(top->OpenChild(fmt::format("child{:02}", idx),
+                                         dc::OpenMode::kEditable));
+  auto other_session = dc::Session::Create();
+  other_session->SetLockMode(dc::LockMode::kLockTable);
+  auto other_top = other_session->OpenTopLevelObject(kTopName5, kTopName5);
+  ASSERT_THROW(other_top->SetEditable(), dc::DException);
+
+  // The released slots are reused by the other session
+  for (int idx = 0; idx < child_count; idx += 2)
+    children[idx]->SetReadOnly();
+  std::vector<dc::DObjectSp> other_children;
+  for (int idx = 0; idx < child_count; ++ idx) {
+    auto name = fmt::format("child{:02}", idx);
+    if (idx % 2) {
+      ASSERT_THROW(other_top->OpenChild(name, dc::OpenMode::kEditable),
+                   dc::DException);
+    } else {
+      other_children.emplace_back(
+          other_top->OpenChild(name, dc::OpenMode::kEditable));
+    }
+  }
+  ASSERT_THROW(top->SetEditable(), dc::DException);
+  for (int idx = 0; idx < child_count; idx += 2)
+    ASSERT_THROW(children[idx]->SetEditable(), dc::DException);
+
+  other_children.clear();
+  children.clear();
+  top->SetEditable();
+  ASSERT_THROW(other_top->SetEditable(), dc::DException);
+}
+
+TEST_F(ObjectTest, LockTableOtherProcess) {
+  // Longer than a slot of the table
+  auto long_name1 = std::string(200, 'a');
+  auto long_name2 = std::string(200, 'b');
+  {
+    auto session = dc::Session::Create();
+    session->SetLockMode(dc::LockMode::kLockTable);
+    auto top = session->CreateTopLevelObject(kTopName5, "top");
+    session->InitTopLevelObjectPath(kTopName5, kTopName5);
+    top->CreateChild(long_name1, "child")->CreateChild(long_name2, "child");
+    top->CreateChild(kChildName1, "child");
+    top->Save(true);
+  }
+
+  int locked_pipe[2];
+  int exit_pipe[2];
+  ASSERT_EQ(pipe(locked_pipe), 0);
+  ASSERT_EQ(pipe(exit_pipe), 0);
+  auto pid = fork();
+  ASSERT_NE(pid, -1);
+  if (pid == 0) {
+    char c = 0;
+    try {
+      auto session = dc::Session::Create();
+      session->SetLockMode(dc::LockMode::kLockTable);
+      auto top = session->OpenTopLevelObject(kTopName5, kTopName5);
+      auto obj = top->OpenChild(long_name1)->OpenChild(
+          long_name2, dc::OpenMode::kEditable);
+      c = 1;
+      write(locked_pipe[1], &c, 1);
+      read(exit_pipe[0], &c, 1);
+    } catch (...) {
+      write(locked_pipe[1], &c, 1);
+    }
+    // Exits without unlocking
+    _exit(0);
+  }
+  char locked = 0;
+  ASSERT_EQ(read(locked_pipe[0], &locked, 1), 1);
+  ASSERT_EQ(locked, 1);
+
+  auto session = dc::Session::Create();
+  session->SetLockMode(dc::LockMode::kLockTable);
+  ASSERT_THROW(session->OpenTopLevelObject(
+      kTopName5, kTopName5, dc::OpenMode::kEditable), dc::DException);
+  auto top = session->OpenTopLevelObject(kTopName5, kTopName5);
+  auto child = top->OpenChild(long_name1);
+  ASSERT_THROW(child->SetEditable(), dc::DException);
+  ASSERT_THROW(child->OpenChild(long_name2, dc::OpenMode::kEditable),
+               dc::DException);
+  auto other_child = top->OpenChild(kChildName1, dc::OpenMode::kEditable);
+  ASSERT_TRUE(other_child->IsEditable());
+
+  write(exit_pipe[1], &locked, 1);
+  int status;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  for (auto fd : {locked_pipe[0], locked_pipe[1], exit_pipe[0], exit_pipe[1]})
+    close(fd);
+  auto grand_child = child->OpenChild(long_name2, dc::OpenMode::kEditable);
+  ASSERT_TRUE(grand_child->IsEditable());
+  grand_child.reset();
+  other_child.reset();
+  top->SetEditable();
+  ASSERT_TRUE(top->IsEditable());
+}
+
 TEST_F(ObjectTest, ExtraFileInObjectDir) {
   auto session = dc::Session::Create();
   auto top = session->CreateTopLevelObject(kTopName6, "top");
@@ -482,6 +659,7 @@ TEST_F(ObjectTest, StoreArray) {
     values.push_back(false);
     values.push_back(std::string("test"));
     values.push_back(nil);
+    values.push_back(dc::DValueArray({2, std::string("nested")}));
     auto child = top->CreateChild(kChildName1, "child");
     child->Put("test_key", values);
     child->Save();
@@ -496,6 +674,404 @@ TEST_F(ObjectTest, StoreArray) {
     ASSERT_EQ(values[2], false);
     ASSERT_EQ(values[3], std::string("test"));
     ASSERT_EQ(values[4], nil);
+    ASSERT_EQ(values[5], dc::DValueArray({2, std::string("nested")}));
   }
 }
 
+TEST_F(ObjectTest, ObjectId) {
+  auto session = dc::Session::Create();
+  dc::DObjPath top_path(kTopName8);
+  auto top = session->CreateTopLevelObject(kTopName8, "top");
+  auto child1 = top->CreateChild(kChildName1, "child");
+  auto child2 = top->CreateChild(kChildName2, "child");
+  session->InitTopLevelObjectPath(kTopName8, kTopName8);
+  top->Save(true);
+  auto top_id = top->ObjectId();
+  auto child1_id = child1->ObjectId();
+  auto child1_path = child1->Path();
+  ASSERT_NE(top_id, child1_id);
+  ASSERT_NE(child1_id, child2->ObjectId());
+  ASSERT_EQ(session->GetObjectById(child1_id)->Path(), child1->Path());
+
+  top.reset();
+  child1.reset();
+  child2.reset();
+  session->PurgeObject(top_path);
+  ASSERT_THROW(session->GetObjectById(child1_id), dc::DException);
+
+  top = session->OpenTopLevelObject(kTopName8, kTopName8);
+  child1 = top->OpenChild(kChildName1);
+  ASSERT_EQ(top->ObjectId(), top_id);
+  ASSERT_EQ(child1->ObjectId(), child1_id);
+  ASSERT_EQ(session->GetObjectById(top_id)->Path(), top_path);
+
+  // A new object at the path of a deleted one gets a new id
+  child1.reset();
+  session->DeleteObject(child1_path);
+  ASSERT_THROW(session->GetObjectById(child1_id), dc::DException);
+  top->SetEditable();
+  child1 = top->CreateChild(kChildName1, "child");
+  ASSERT_NE(child1->ObjectId(), child1_id);
+}
+
+TEST_F(ObjectTest, ManyChildren) {
+  auto session = dc::Session::Create();
+  auto top = session->CreateTopLevelObject(kTopName1, "top");
+  const int child_count = 500;
+  for (int idx = child_count - 1; idx >= 0; -- idx)
+    top->CreateChild(fmt::format("child{:04}", idx), "child");
+  ASSERT_EQ(top->ChildCount(), static_cast<size_t>(child_count));
+  auto children = top->Children();
+  for (int idx = 0; idx < child_count; ++ idx)
+    ASSERT_EQ(children[idx].Name(), fmt::format("child{:04}", idx));
+  ASSERT_TRUE(top->HasChild("child0123"));
+  ASSERT_EQ(top->ChildAt(123).Name(), "child0123");
+  ASSERT_EQ(top->ChildIndex("child0123"), 123u);
+  ASSERT_EQ(top->ChildIndex("no_child"), top->ChildCount());
+  ASSERT_THROW(top->ChildAt(child_count), dc::DException);
+  int visited = 0;
+  top->ForEachChild([&visited](auto& child_info) {
+      ASSERT_EQ(child_info.Name(), fmt::format("child{:04}", visited));
+      visited ++;
+    });
+  ASSERT_EQ(visited, child_count);
+  auto generation = top->ChildrenGeneration();
+  top->DeleteChild("child0123");
+  ASSERT_NE(top->ChildrenGeneration(), generation);
+  ASSERT_FALSE(top->HasChild("child0123"));
+  ASSERT_EQ(top->ChildCount(), static_cast<size_t>(child_count - 1));
+  ASSERT_EQ(top->Children()[123].Name(), "child0124");
+}
+
+TEST_F(ObjectTest, DeferNotifications) {
+  auto session = dc::Session::Create();
+  auto top = session->CreateTopLevelObject(kTopName1, "top");
+  auto child = top->CreateChild(kChildName1, "child");
+  top->Put("a", 1);
+  top->Put("b", 2);
+
+  int num_cmds = 0;
+  top->AddListener([&num_cmds](const dc::Command&) {
+      num_cmds ++;
+    }, dc::ListenerCallPoint::kPost);
+  std::vector<dc::ChangeSummary> summaries;
+  top->AddSummaryListener([&summaries](const dc::ChangeSummary& summary) {
+      summaries.push_back(summary);
+    });
+  int num_child_summaries = 0;
+  child->AddSummaryListener([&num_child_summaries](auto&) {
+      num_child_summaries ++;
+    });
+
+  top->Put("a", 3);
+  ASSERT_EQ(summaries.size(), 1u);
+  ASSERT_EQ(summaries[0].Commands().size(), 1u);
+  summaries.clear();
+
+  {
+    dc::Session::DeferNotifications defer(session);
+    for (int value = 10; value < 110; ++ value)
+      top->Put("a", value);
+    top->Put("c", 4);
+    top->RemoveKey("c");
+    top->RemoveKey("b");
+    top->CreateChild(kChildName2, "child");
+    {
+      dc::Session::DeferNotifications nested(session);
+      child->Put("x", 5);
+    }
+    ASSERT_TRUE(summaries.empty());
+    ASSERT_EQ(num_child_summaries, 0);
+  }
+  ASSERT_EQ(num_cmds, 105);
+  ASSERT_EQ(summaries.size(), 1u);
+  ASSERT_EQ(num_child_summaries, 1);
+  auto& summary = summaries[0];
+  ASSERT_EQ(summary.ObjPath(), top->Path());
+  ASSERT_EQ(summary.NumReceivedCommands(), 104u);
+  ASSERT_TRUE(summary.HasValueChanges());
+  ASSERT_TRUE(summary.HasChildListChanges());
+  ASSERT_FALSE(summary.HasBaseObjectListChanges());
+  auto& cmds = summary.Commands();
+  ASSERT_EQ(cmds.size(), 3u);
+  ASSERT_EQ(cmds[0].Type(), dc::CommandType::kValueUpdate);
+  ASSERT_EQ(cmds[0].Key(), "a");
+  ASSERT_EQ(cmds[0].PrevValue(), 3);
+  ASSERT_EQ(cmds[0].NewValue(), 109);
+  ASSERT_EQ(cmds[1].Type(), dc::CommandType::kValueDelete);
+  ASSERT_EQ(cmds[1].Key(), "b");
+  ASSERT_EQ(cmds[2].Type(), dc::CommandType::kAddChild);
+}
+
+TEST_F(ObjectTest, DeferNotificationsListenerError) {
+  auto session = dc::Session::Create();
+  auto top = session->CreateTopLevelObject(kTopName1, "top");
+  auto child = top->CreateChild(kChildName1, "child");
+  top->AddSummaryListener([](auto&) {
+      throw std::runtime_error("listener error");
+    });
+  int num_child_summaries = 0;
+  child->AddSummaryListener([&num_child_summaries](auto&) {
+      num_child_summaries ++;
+    });
+
+  {
+    dc::Session::DeferNotifications defer(session);
+    top->Put("a", 1);
+    child->Put("a", 1);
+    ASSERT_THROW(defer.End(), std::runtime_error);
+    ASSERT_EQ(num_child_summaries, 1);
+  }
+  ASSERT_EQ(num_child_summaries, 1);
+
+  // The exception is ignored when the scope ends without End()
+  {
+    dc::Session::DeferNotifications defer(session);
+    top->Put("a", 2);
+    child->Put("a", 2);
+  }
+  ASSERT_EQ(num_child_summaries, 2);
+}
+
+TEST_F(ObjectTest, ValueCommandTypeWithoutStack) {
+  auto session = dc::Session::Create();
+  auto top = session->CreateTopLevelObject(kTopName1, "top");
+  std::vector<dc::CommandType> cmd_types;
+  top->AddListener([&cmd_types](const dc::Command& cmd) {
+      cmd_types.push_back(cmd.Type());
+    }, dc::ListenerCallPoint::kPost);
+  top->Put("a", 1);
+  top->Put("a", 2);
+  top->RemoveKey("a");
+  ASSERT_EQ(cmd_types.size(), 3u);
+  ASSERT_EQ(cmd_types[0], dc::CommandType::kValueAdd);
+  ASSERT_EQ(cmd_types[1], dc::CommandType::kValueUpdate);
+  ASSERT_EQ(cmd_types[2], dc::CommandType::kValueDelete);
+}
+
+TEST_F(ObjectTest, HistoryLimit) {
+  auto session = dc::Session::Create();
+  auto top = session->CreateTopLevelObject(kTopName1, "top");
+  auto stack = top->EnableCommandStack();
+  stack->SetMaxEntries(5);
+  for (int value = 1; value <= 10; ++ value)
+    top->Put("a", value);
+  ASSERT_EQ(stack->EntryCount(), 5u);
+  for (int count = 0; count < 5; ++ count)
+    stack->Undo();
+  ASSERT_FALSE(stack->CanUndo());
+  ASSERT_EQ(top->Get("a"), 5);
+  stack->Clear();
+  stack->SetMaxEntries(0);
+
+  auto child = top->CreateChild(kChildName1, "child");
+  child->Put("x", std::string(100, 'x'));
+  child->CreateChild(kChildName2, "child")->Put("y", 1.5);
+  stack->Clear();
+  stack->EnableSpill();
+  stack->SetMaxBytes(4096);
+  const int num_puts = 50;
+  for (int idx = 1; idx <= num_puts; ++ idx)
+    top->Put("s", std::string(static_cast<size_t>(idx) * 20, 's'));
+  top->DeleteChild(kChildName1);
+  top->PutMany({{"b", dc::DValueArray{1, "two", 3.5}}, {"c", true}});
+  ASSERT_EQ(stack->EntryCount(), static_cast<size_t>(num_puts + 2));
+  ASSERT_LE(stack->ByteSize(), 4096u);
+
+  stack->Undo();
+  ASSERT_FALSE(top->HasKey("b"));
+  stack->Undo();
+  ASSERT_TRUE(top->HasChild(kChildName1));
+  child = top->OpenChild(kChildName1);
+  ASSERT_EQ(child->Get("x"), std::string(100, 'x'));
+  ASSERT_EQ(child->OpenChild(kChildName2)->Get("y"), 1.5);
+  for (int idx = num_puts; idx > 1; -- idx) {
+    ASSERT_EQ(top->Get("s"), std::string(static_cast<size_t>(idx) * 20, 's'));
+    stack->Undo();
+  }
+  stack->Undo();
+  ASSERT_FALSE(top->HasKey("s"));
+  ASSERT_FALSE(stack->CanUndo());
+  while (stack->CanRedo())
+    stack->Redo();
+  ASSERT_EQ(top->Get("s"), std::string(num_puts * 20, 's'));
+  ASSERT_FALSE(top->HasChild(kChildName1));
+  ASSERT_EQ(top->Get("b"), (dc::DValueArray{1, "two", 3.5}));
+
+  stack->Clean();
+  stack->EnableSpill(false);
+  ASSERT_LT(stack->EntryCount(), static_cast<size_t>(num_puts));
+  ASSERT_LE(stack->ByteSize(), 4096u);
+  ASSERT_TRUE(stack->IsClean());
+  stack->Undo();
+  top->Put("c", false);
+  stack->SetMaxEntries(1);
+  stack->Undo();
+  ASSERT_FALSE(stack->CanUndo());
+  ASSERT_FALSE(stack->IsClean());
+}
+
+TEST_F(ObjectTest, HistoryLimitRedo) {
+  auto session = dc::Session::Create();
+  auto top = session->CreateTopLevelObject(kTopName1, "top");
+  auto stack = top->EnableCommandStack();
+  stack->SetMaxEntries(5);
+  for (int value = 1; value <= 10; ++ value)
+    top->Put("a", value);
+  for (int count = 0; count < 4; ++ count)
+    stack->Undo();
+  ASSERT_EQ(top->Get("a"), 6);
+  stack->SetMaxEntries(3);
+  ASSERT_EQ(stack->EntryCount(), 3u);
+  stack->Redo();
+  stack->Redo();
+  ASSERT_EQ(top->Get("a"), 8);
+  ASSERT_FALSE(stack->CanRedo());
+  stack->Clear();
+  stack->SetMaxEntries(0);
+
+  stack->EnableSpill();
+  stack->SetMaxBytes(4096);
+  const int num_puts = 50;
+  for (int idx = 1; idx <= num_puts; ++ idx)
+    top->Put("s", std::string(static_cast<size_t>(idx) * 20, 's'));
+  while (stack->CanUndo())
+    stack->Undo();
+  ASSERT_FALSE(top->HasKey("s"));
+  ASSERT_LE(stack->ByteSize(), 4096u);
+  for (int idx = 1; idx <= num_puts; ++ idx) {
+    stack->Redo();
+    ASSERT_EQ(top->Get("s"), std::string(static_cast<size_t>(idx) * 20, 's'));
+  }
+  ASSERT_LE(stack->ByteSize(), 4096u);
+
+  for (int count = 0; count < 10; ++ count)
+    stack->Undo();
+  // Only the latest undo entry and the next redo entry fit
+  stack->EnableSpill(false);
+  ASSERT_EQ(stack->EntryCount(), 2u);
+  ASSERT_TRUE(stack->CanRedo());
+  ASSERT_TRUE(stack->CanUndo());
+  stack->Redo();
+  ASSERT_EQ(top->Get("s"), std::string((num_puts - 9) * 20, 's'));
+}
+
+TEST_F(ObjectTest, DetachOnDelete) {
+  auto session = dc::Session::Create();
+  auto top = session->CreateTopLevelObject(kTopName1, "top");
+  auto child1 = top->CreateChild(kChildName1, "child");
+  child1->Put("a", 1);
+  child1->CreateChild(kChildName2, "child")->Put("b", "text");
+  top->CreateChild(kChildName3, "child", true)->Put("c", 2.5);
+  session->InitTopLevelObjectPath(kTopName1, kTopName1);
+  top->Save(true);
+  auto stack = top->EnableCommandStack();
+  stack->EnableDetachOnDelete();
+  ASSERT_TRUE(stack->IsDetachOnDeleteEnabled());
+
+  auto child_dir = fs::path(kTopName1) / kChildName1;
+  auto trash_dir = fs::path(kTopName1) / ".dino_trash";
+  ASSERT_TRUE(fs::exists(child_dir));
+  top->DeleteChild(kChildName1);
+  ASSERT_FALSE(top->HasChild(kChildName1));
+  ASSERT_FALSE(fs::exists(child_dir));
+  ASSERT_TRUE(fs::is_directory(trash_dir));
+  ASSERT_TRUE(child1->IsExpired());
+  ASSERT_FALSE(session->IsOpened(dc::DObjPath(kTopName1 + "/" + kChildName1)));
+
+  stack->Undo();
+  ASSERT_TRUE(top->HasChild(kChildName1));
+  ASSERT_TRUE(fs::exists(child_dir));
+  ASSERT_FALSE(fs::exists(trash_dir));
+  ASSERT_FALSE(child1->IsExpired());
+  ASSERT_EQ(child1->Get("a"), 1);
+  child1->Put("a", 3);
+  ASSERT_EQ(child1->OpenChild(kChildName2)->Get("b"), "text");
+  ASSERT_EQ(top->OpenChild(kChildName1)->Get("a"), 3);
+
+  // Flattened children are copied
+  top->DeleteChild(kChildName3);
+  ASSERT_FALSE(top->HasChild(kChildName3));
+  stack->Undo();
+  ASSERT_EQ(top->OpenChild(kChildName3)->Get("c"), 2.5);
+
+  stack->Redo();
+  top->DeleteChild(kChildName1);
+  stack->Undo();
+  ASSERT_EQ(top->OpenChild(kChildName1)->Get("a"), 3);
+  stack->Redo();
+  ASSERT_FALSE(top->HasChild(kChildName1));
+  ASSERT_FALSE(top->HasChild(kChildName3));
+  ASSERT_FALSE(fs::exists(child_dir));
+  ASSERT_TRUE(fs::is_directory(trash_dir));
+  stack->Clear();
+  ASSERT_FALSE(fs::exists(trash_dir));
+  ASSERT_FALSE(fs::exists(child_dir));
+
+  // The detached data is counted, and is dropped since it can't be spilled
+  top->CreateChild(kChildName1, "child")->Put("x", std::string(8192, 'x'));
+  top->Save(true);
+  stack->Clear();
+  top->DeleteChild(kChildName1);
+  ASSERT_TRUE(fs::is_directory(trash_dir));
+  ASSERT_GT(stack->ByteSize(), 8192u);
+  stack->EnableSpill();
+  stack->SetMaxBytes(4096);
+  top->Put("a", 1);
+  ASSERT_EQ(stack->EntryCount(), 1u);
+  ASSERT_LE(stack->ByteSize(), 4096u);
+  ASSERT_FALSE(fs::exists(trash_dir));
+}
+
+TEST_F(ObjectTest, FilteredListener) {
+  auto session = dc::Session::Create();
+  auto top = session->CreateTopLevelObject(kTopName1, "top");
+  top->EnableCommandStack();
+  auto child1 = top->CreateChild(kChildName1, "child");
+  auto child2 = top->CreateChild(kChildName2, "child");
+
+  std::vector<dc::Command> key_cmds;
+  dc::ListenerFilter key_filter;
+  key_filter.command_type_mask =
+      static_cast<unsigned int>(dc::CommandType::kValueUpdateType);
+  key_filter.keys = {"a", "b"};
+  top->AddListener([&key_cmds](const dc::Command& cmd) {
+      key_cmds.push_back(cmd);
+    }, key_filter, dc::ListenerCallPoint::kPost);
+  std::vector<dc::Command> child_cmds;
+  dc::ListenerFilter path_filter;
+  path_filter.path_prefix = child1->Path();
+  top->AddListener([&child_cmds](const dc::Command& cmd) {
+      child_cmds.push_back(cmd);
+    }, path_filter, dc::ListenerCallPoint::kPost);
+  int num_list_cmds = 0;
+  dc::ListenerFilter list_filter;
+  list_filter.command_type_mask =
+      static_cast<unsigned int>(dc::CommandType::kChildListUpdateType);
+  auto list_conn = top->AddListener([&num_list_cmds](const dc::Command&) {
+      num_list_cmds ++;
+    }, list_filter, dc::ListenerCallPoint::kPost);
+
+  top->Put("a", 1);
+  top->Put("c", 2);
+  child1->Put("b", 3);
+  child2->Put("a", 4);
+  child2->Put("x", 5);
+  child1->PutMany({{"a", 6}, {"b", 7}, {"x", 8}});
+  child1->PutMany({{"x", 9}, {"y", 10}});
+  top->CreateChild(kChildName3, "child", true);
+
+  ASSERT_EQ(key_cmds.size(), 4u);
+  ASSERT_EQ(key_cmds[0].ObjPath(), top->Path());
+  ASSERT_EQ(key_cmds[1].Key(), "b");
+  ASSERT_EQ(key_cmds[2].ObjPath(), child2->Path());
+  ASSERT_EQ(key_cmds[3].Type(), dc::CommandType::kValuesUpdate);
+  ASSERT_EQ(child_cmds.size(), 3u);
+  for (auto& cmd : child_cmds)
+    ASSERT_EQ(cmd.ObjPath(), child1->Path());
+  ASSERT_EQ(num_list_cmds, 1);
+
+  list_conn.disconnect();
+  top->DeleteChild(kChildName3);
+  ASSERT_EQ(num_list_cmds, 1);
+}